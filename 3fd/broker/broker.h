@@ -7,6 +7,7 @@
 #define BROKER_H
 
 #include <3fd/core/preprocessing.h>
+#include <3fd/utils/coroutine.h>
 #include <cinttypes>
 #include <functional>
 #include <future>
@@ -57,6 +58,14 @@ namespace broker {
         virtual ~IAsyncDatabaseOperation() = default;
 
         virtual const char *description() const noexcept = 0;
+
+        /// <summary>
+        /// Subscribes a callback to be invoked once this operation completes (successfully or not),
+        /// in the thread that executes the operation, or right away if it has already completed.
+        /// The outcome must then be retrieved by <see cref="std::future{}::get"/>.
+        /// </summary>
+        /// <param name="callback">The callback, which must be quick and must not throw.</param>
+        virtual void OnCompletion(const std::function<void()> &callback) = 0;
     };
 
     typedef std::function<void(std::vector<std::string> &&)> CallbackReceiveMessages;
@@ -111,6 +120,23 @@ namespace broker {
         std::unique_ptr<IAsyncDatabaseOperation> WriteMessages(const std::vector<std::string> &messages);
     };
 
+#ifdef _3FD_HAS_COROUTINES
+    /// <summary>
+    /// Awaits an asynchronous broker operation without blocking a thread.
+    /// The awaiting coroutine is resumed in the framework thread pool.
+    /// </summary>
+    /// <param name="operation">The operation to await.</param>
+    inline utils::Task<void> AwaitAsync(IAsyncDatabaseOperation &operation)
+    {
+        co_await utils::AwaitCompletion([&operation](const std::function<void()> &callback)
+        {
+            operation.OnCompletion(callback);
+        });
+
+        operation.get(); // the outcome might take a moment to be set after the notification
+    }
+#endif
+
 }// end of namespace broker
 }// end of namespace _3fd
 
@@ -7,6 +7,7 @@
 #include "broker_impl.h"
 #include <3fd/core/configuration.h>
 #include <3fd/core/logger.h>
+#include <3fd/utils/retry.h>
 #include <3fd/utils/serialization.h>
 #include <3fd/utils/text.h>
 
@@ -118,6 +119,17 @@ namespace broker
     // DatabaseSession class
     /////////////////////////////////
 
+    /// <summary>
+    /// Gets how the connection to the database is retried,
+    /// according to the framework configuration file.
+    /// </summary>
+    static utils::RetryOptions GetDbConnRetryOptions()
+    {
+        using std::chrono::milliseconds;
+        const auto maxRetries = core::AppConfig::GetSettings().framework.broker.dbConnMaxRetries;
+        return utils::RetryOptions{ milliseconds(100), milliseconds(5000), maxRetries + 1, milliseconds(0) };
+    }
+
     /// <summary>
     /// Gets an ODBC database connection.
     /// Fails with an exception only after timeout and a number
@@ -128,7 +140,9 @@ namespace broker
     DatabaseSession::DatabaseSession(const std::string &connString)
         : m_connectionString(connString)
     {
-        uint32_t retryCount(1);
+        static utils::RetryPolicy retryPolicy("broker::DatabaseSession::DatabaseSession",
+                                              GetDbConnRetryOptions());
+        utils::Retrier retrier(retryPolicy);
 
         while (true)
         {
@@ -145,18 +159,19 @@ namespace broker
                 static const auto maxRetries =
                     core::AppConfig::GetSettings().framework.broker.dbConnMaxRetries;
 
-                if (retryCount > maxRetries)
+                if (retrier.GetNumAttempts() > maxRetries)
                     throw;
 
                 std::array<char, 128> bufErrMsg;
                 auto length = utils::SerializeTo(bufErrMsg,
                     "Could not connect to broker queue database - Attempt ",
-                    retryCount, " of ", maxRetries);
+                    retrier.GetNumAttempts(), " of ", maxRetries);
 
                 core::Logger::Write(std::string(bufErrMsg.data(), length), core::Logger::PRIO_WARNING);
-            }
 
-            ++retryCount;
+                if (!retrier.BackOff())
+                    throw;
+            }
         }
     }
 
@@ -175,15 +190,17 @@ namespace broker
         static const auto maxRetries =
             core::AppConfig::GetSettings().framework.broker.dbConnMaxRetries;
 
-        uint32_t retryCount(1);
+        static utils::RetryPolicy retryPolicy("broker::DatabaseSession::GetConnection",
+                                              GetDbConnRetryOptions());
+        utils::Retrier retrier(retryPolicy);
 
-        if (retryCount <= maxRetries)
+        if (maxRetries > 0)
         {
             std::array<char, 128> bufErrMsg;
 
             auto length = utils::SerializeTo(bufErrMsg,
                 "Connection to database is lost! Re-connection attempt ",
-                retryCount, " of ", maxRetries);
+                retrier.GetNumAttempts(), " of ", maxRetries);
 
             core::Logger::Write(std::string(bufErrMsg.data(), length), core::Logger::PRIO_WARNING);
         }
@@ -210,12 +227,9 @@ namespace broker
             }
             catch (nanodbc::database_error &)
             {
-                if (retryCount >= maxRetries)
+                if (retrier.GetNumAttempts() >= maxRetries || !retrier.BackOff())
                     throw;
             }
-
-            ++retryCount;
-
         }// end of loop
     }
 
@@ -242,13 +256,7 @@ namespace broker
     {
         // we have 1 lock per service and the ID is the URL,
         // because T-SQL is case insensitive, it is normalized here to lower case:
-        std::string id;
-        id.reserve(brokerSvcUrl.size());
-        std::transform(brokerSvcUrl.cbegin(),
-                       brokerSvcUrl.end(),
-                       std::back_inserter(id), [](char ch){ return tolower(ch); });
-
-        return Lock(m_cacheOfMutexes.GetObject(id));
+        return Lock(m_cacheOfMutexes.GetObject(utils::to_lower(brokerSvcUrl)));
     }
 
 }// end of namespace broker
@@ -9,6 +9,7 @@
 #include <3fd/core/exceptions.h>
 #include <3fd/core/logger.h>
 #include <3fd/utils/serialization.h>
+#include <3fd/utils/threadpool.h>
 
 #include <chrono>
 #include <sstream>
@@ -195,6 +196,7 @@ namespace broker
     private:
 
         DatabaseSession m_dbSession;
+        utils::CompletionNotifier m_completion;
         std::string m_brokerSvcUrl;
         nanodbc::statement m_stoProcExecStmt;
         CallbackReceiveMessages callbackReceiveMessages;
@@ -203,7 +205,16 @@ namespace broker
 
         AsyncReadImpl(const AsyncReadImpl &) = delete;
 
-        virtual ~AsyncReadImpl() = default;
+        /// <summary>
+        /// Finalizes an instance of the <see cref="AsyncReadImpl" /> class.
+        /// Unlike the future from std::async, the one from the thread pool does not block upon
+        /// destruction, so this waits for the asynchronous execution that references this object.
+        /// </summary>
+        virtual ~AsyncReadImpl()
+        {
+            if (valid())
+                wait();
+        }
 
         /// <summary>
         /// Initializes a new instance of the <see cref="AsyncReadImpl" /> class.
@@ -239,7 +250,20 @@ namespace broker
 
                 // make itself an asynchronous callback:
                 std::future<void>::operator=(
-                    std::async(std::launch::async, &AsyncReadImpl::ExtractMessages, this)
+                    utils::ThreadPool::GetInstance().Async([this]()
+                    {
+                        try
+                        {
+                            ExtractMessages();
+                        }
+                        catch (...)
+                        {
+                            m_completion.Notify();
+                            throw;
+                        }
+
+                        m_completion.Notify();
+                    })
                 );
             }
             catch_and_handle_exception("setting up to read messages asynchronously from broker queue")
@@ -281,6 +305,15 @@ namespace broker
             return "reading from broker queue";
         }
 
+        /// <summary>
+        /// Subscribes a callback to be invoked once this operation completes.
+        /// </summary>
+        /// <param name="callback">The callback.</param>
+        void OnCompletion(const std::function<void()> &callback) override
+        {
+            m_completion.Subscribe(callback);
+        }
+
     };// end of class AsyncReadImpl
 
     /// <summary>
@@ -9,6 +9,7 @@
 #include <3fd/core/exceptions.h>
 #include <3fd/core/logger.h>
 #include <3fd/utils/serialization.h>
+#include <3fd/utils/threadpool.h>
 #include <3fd/utils/text.h>
 
 #include <sstream>
@@ -247,6 +248,7 @@ namespace broker
     private:
 
         DatabaseSession m_dbSession;
+        utils::CompletionNotifier m_completion;
 
         nanodbc::statement m_stageInsertStatement;
         nanodbc::statement m_stoProcStatement;
@@ -255,7 +257,16 @@ namespace broker
 
         AsyncWriteImpl(const AsyncWriteImpl &) = delete;
 
-        virtual ~AsyncWriteImpl() = default;
+        /// <summary>
+        /// Finalizes an instance of the <see cref="AsyncWriteImpl" /> class.
+        /// Unlike the future from std::async, the one from the thread pool does not block upon
+        /// destruction, so this waits for the asynchronous execution that references this object.
+        /// </summary>
+        virtual ~AsyncWriteImpl()
+        {
+            if (valid())
+                wait();
+        }
 
         /// <summary>
         /// Initializes a new instance of the <see cref="AsyncWriteImpl" /> class.
@@ -280,6 +291,7 @@ namespace broker
                     std::packaged_task<void(long)> task([](long){});
                     std::future<void>::operator=(task.get_future());
                     task(0);
+                    m_completion.Notify();
                     return;
                 }
 
@@ -300,7 +312,20 @@ namespace broker
 
                 // make this operation an asynchronous one:
                 std::future<void>::operator=(
-                    std::async(std::launch::async, &AsyncWriteImpl::PutMessages, this, batchSize)
+                    utils::ThreadPool::GetInstance().Async([this, batchSize]()
+                    {
+                        try
+                        {
+                            PutMessages(batchSize);
+                        }
+                        catch (...)
+                        {
+                            m_completion.Notify();
+                            throw;
+                        }
+
+                        m_completion.Notify();
+                    })
                 );
             }
             catch_and_handle_exception("setting up to write messages into broker queue")
@@ -327,6 +352,15 @@ namespace broker
             return "writing into broker queue";
         }
 
+        /// <summary>
+        /// Subscribes a callback to be invoked once this operation completes.
+        /// </summary>
+        /// <param name="callback">The callback.</param>
+        void OnCompletion(const std::function<void()> &callback) override
+        {
+            m_completion.Subscribe(callback);
+        }
+
     };// end of AsyncWriteImpl class
 
     /// <summary>
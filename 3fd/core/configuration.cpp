@@ -348,11 +348,18 @@ namespace core
                     xml::QueryElement("stackTracing", xml::Optional, {
                         ParseKeyValue("stackLogInitialCap", settings.framework.stackTracing.stackLogInitialCap = 32)
                     }),
+                    // XPath /configuration/framework/threadPool:
+                    xml::QueryElement("threadPool", xml::Optional, {
+                        ParseKeyValue("numWorkers", settings.framework.threadPool.numWorkers = 0)
+                    }),
                     // XPath /configuration/framework/gc:
                     xml::QueryElement("gc", xml::Optional, {
                         ParseKeyValue("msgLoopSleepTimeoutMilisecs", settings.framework.gc.msgLoopSleepTimeoutMilisecs = 100),
                         ParseKeyValue("memoryBlocksPoolInitialSize", settings.framework.gc.memBlocksMemPool.initialSize = 128),
                         ParseKeyValue("memoryBlocksPoolGrowingFactor", settings.framework.gc.memBlocksMemPool.growingFactor = 1.0),
+                        ParseKeyValue("memoryBlocksPoolUseVirtualMemory", settings.framework.gc.memBlocksMemPool.useVirtualMemory = false),
+                        ParseKeyValue("memoryBlocksPoolUseHugePages", settings.framework.gc.memBlocksMemPool.useHugePages = false),
+                        ParseKeyValue("memoryBlocksPoolStatsLogIntervalSecs", settings.framework.gc.memBlocksMemPool.statsLogIntervalSecs = 0),
                         ParseKeyValue("sptrObjsHashTabInitSizeLog2", settings.framework.gc.sptrObjectsHashTable.initialSizeLog2 = 8),
                         ParseKeyValue("sptrObjsHashTabLoadFactorThreshold", settings.framework.gc.sptrObjectsHashTable.loadFactorThreshold = 0.7F)
                     }),
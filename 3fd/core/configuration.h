@@ -76,6 +76,11 @@ namespace core
                     uint32_t stackLogInitialCap;
                 } stackTracing;
 
+                struct
+                {
+                    uint32_t numWorkers;
+                } threadPool;
+
                 struct
                 {
                     uint32_t msgLoopSleepTimeoutMilisecs;
@@ -84,6 +89,9 @@ namespace core
                     {
                         uint32_t initialSize;
                         float    growingFactor;
+                        bool     useVirtualMemory;
+                        bool     useHugePages;
+                        uint32_t statsLogIntervalSecs;
                     } memBlocksMemPool;
                         
                     struct
@@ -42,7 +42,6 @@ namespace memory
         std::exception_ptr              m_error;
         MemoryDigraph                   m_memoryDigraph;
         utils::LockFreeQueue<IMessage>  m_messagesQueue;
-        utils::Event                    m_terminationEvent;
 
         GarbageCollector();
 
@@ -10,6 +10,7 @@
 #include <3fd/utils/memory.h>
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <condition_variable>
 #include <iomanip>
 #include <sstream>
@@ -131,8 +132,7 @@ namespace memory
     try : 
         m_error(nullptr), 
         m_memoryDigraph(), 
-        m_messagesQueue(), 
-        m_terminationEvent()
+        m_messagesQueue()
     {
         CALL_STACK_TRACE;
 
@@ -171,7 +171,7 @@ namespace memory
         try
         {
             // Signalizes termination for the message loop
-            m_terminationEvent.Signalize();
+            m_messagesQueue.InterruptWait();
 
             if( m_thread.joinable() )
                 m_thread.join();
@@ -197,6 +197,29 @@ namespace memory
         }
     }
 
+    /// <summary>
+    /// Logs the statistics of the pool of vertices.
+    /// </summary>
+    /// <param name="stats">The current statistics.</param>
+    /// <param name="previous">The statistics when last logged.</param>
+    /// <param name="elapsedSecs">The time elapsed since last logged, in seconds.</param>
+    static void LogVertexPoolStats(const utils::MemPoolStats &stats,
+                                   const utils::MemPoolStats &previous,
+                                   double elapsedSecs)
+    {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(1)
+            << "GC vertex pool: " << stats.numChunks << " chunks ("
+            << 100.0 * stats.GetFullyFreeChunksFraction() << "% fully free), "
+            << stats.numBytesReserved / 1024 << " KB reserved, "
+            << stats.numBytesInUse / 1024 << " KB in use (peak of "
+            << stats.numBytesInUseHighWaterMark / 1024 << " KB), "
+            << (stats.numAllocations - previous.numAllocations) / elapsedSecs << " allocations/s, "
+            << (stats.numDeallocations - previous.numDeallocations) / elapsedSecs << " deallocations/s";
+
+        core::Logger::Write(oss.str(), core::Logger::PRIO_INFORMATION);
+    }
+
     /// <summary>
     /// Executed by the GC dedicated thread.
     /// </summary>
@@ -206,28 +229,54 @@ namespace memory
 
         try
         {
+            using namespace std::chrono;
+
             bool terminate(false);
 
+            // Periodic optimization of the master table:
+            const milliseconds shrinkInterval(AppConfig::GetSettings().framework.gc.msgLoopSleepTimeoutMilisecs);
+            auto lastShrinkTime = steady_clock::now();
+
+            // Periodic logging of pool statistics (when enabled):
+            const seconds statsLogInterval(AppConfig::GetSettings().framework.gc.memBlocksMemPool.statsLogIntervalSecs);
+            auto lastStatsLogTime = steady_clock::now();
+            auto lastStats = m_memoryDigraph.GetVertexPoolStats();
+
             // The message loop:
             do
             {
-                // Wait for either the termination event or a timeout
-                terminate = m_terminationEvent.WaitFor(
-                    AppConfig::GetSettings().framework.gc.msgLoopSleepTimeoutMilisecs
-                );
+                // Wait for either new messages or termination
+                terminate = !m_messagesQueue.WaitForEntries();
 
                 // Consume the messages in the queue:
-                IMessage *message = m_messagesQueue.Remove();
-                while(message != nullptr)
+                m_messagesQueue.ForEachDrained([this](IMessage *msgPtr)
                 {
+                    std::unique_ptr<IMessage> message(msgPtr);
                     message->Execute(m_memoryDigraph);
-                    delete message;
-                    message = m_messagesQueue.Remove();
-                }
+                });
 
-                // If there is still work to do, optimize the master table
+                // If there is still work to do, optimize the master table (once per period)
                 if(terminate == false)
-                    m_memoryDigraph.ShrinkVertexPool();
+                {
+                    auto now = steady_clock::now();
+                    if (now - lastShrinkTime >= shrinkInterval)
+                    {
+                        m_memoryDigraph.ShrinkVertexPool();
+                        lastShrinkTime = now;
+                    }
+                }
+
+                if (statsLogInterval.count() > 0)
+                {
+                    auto now = steady_clock::now();
+                    if (now - lastStatsLogTime >= statsLogInterval)
+                    {
+                        auto stats = m_memoryDigraph.GetVertexPoolStats();
+                        LogVertexPoolStats(stats, lastStats, duration_cast<duration<double>>(now - lastStatsLogTime).count());
+                        lastStats = stats;
+                        lastStatsLogTime = now;
+                    }
+                }
             }
             while(terminate == false);
         }
@@ -15,6 +15,14 @@ namespace memory
         m_vertices.ShrinkPool();
     }
 
+    /// <summary>
+    /// Gets the statistics of the pool of vertices.
+    /// </summary>
+    utils::MemPoolStats MemoryDigraph::GetVertexPoolStats() const noexcept
+    {
+        return m_vertices.GetPoolStats();
+    }
+
     /// <summary>
     /// Sets the connection between a pointer and its referred memory address,
     /// creating an edge in the graph.
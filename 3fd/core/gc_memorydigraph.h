@@ -54,6 +54,8 @@ namespace memory
 
         void ShrinkVertexPool();
 
+        utils::MemPoolStats GetVertexPoolStats() const noexcept;
+
         void AddRegularVertex(void *memAddr, size_t blockSize, FreeMemProc freeMemCallback);
 
         void AddPointer(void *pointerAddr, void *pointedAddr);
@@ -8,6 +8,21 @@ namespace memory
 {
     using core::AppConfig;
 
+    /// <summary>
+    /// Gets the backing of the pool of <see cref="Vertex"/> objects, as configured.
+    /// </summary>
+    static utils::MemoryBacking GetMemBlocksPoolBacking()
+    {
+        auto &settings = AppConfig::GetSettings().framework.gc.memBlocksMemPool;
+
+        if (settings.useHugePages)
+            return utils::MemoryBacking::HugePages;
+        else if (settings.useVirtualMemory)
+            return utils::MemoryBacking::VirtualMemory;
+        else
+            return utils::MemoryBacking::Heap;
+    }
+
     /// <summary>
     /// Initializes a new instance of the <see cref="VertexStore"/> class.
     /// </summary>
@@ -15,7 +30,8 @@ namespace memory
         m_memBlocksPool(
             AppConfig::GetSettings().framework.gc.memBlocksMemPool.initialSize,
             sizeof(Vertex),
-            AppConfig::GetSettings().framework.gc.memBlocksMemPool.growingFactor
+            AppConfig::GetSettings().framework.gc.memBlocksMemPool.growingFactor,
+            GetMemBlocksPoolBacking()
         )
     {
         Vertex::SetMemoryPool(m_memBlocksPool);
@@ -29,6 +45,14 @@ namespace memory
         m_memBlocksPool.Shrink();
     }
 
+    /// <summary>
+    /// Gets the statistics of the pool of <see cref="Vertex"/> objects.
+    /// </summary>
+    utils::MemPoolStats VertexStore::GetPoolStats() const noexcept
+    {
+        return m_memBlocksPool.GetStats();
+    }
+
     /// <summary>
     /// Gets the vertex representing a given memory address.
     /// </summary>
@@ -40,6 +40,8 @@ namespace memory
 
         void ShrinkPool();
 
+        utils::MemPoolStats GetPoolStats() const noexcept;
+
         void AddVertex(void *memAddr, size_t blockSize, FreeMemProc freeMemCallback);
 
         void RemoveVertex(Vertex *memBlock);
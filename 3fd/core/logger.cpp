@@ -227,7 +227,7 @@ namespace core
         try
         {
             // Signalizes termination for the message loop
-            m_terminationEvent.Signalize();
+            m_eventsQueue.InterruptWait();
 
             if (m_logWriterThread.joinable())
                 m_logWriterThread.join();
@@ -394,31 +394,37 @@ namespace core
 
             do
             {
-                // Wait for queued messages:
-                terminate = m_terminationEvent.WaitFor(100);
+                // Wait for queued messages (or termination):
+                terminate = !m_eventsQueue.WaitForEntries();
 
                 // Write the queued messages in the text log file:
                 long estimateRoomForLogEvents(0);
-                while (!m_eventsQueue.IsEmpty())
+                auto &ofs = m_fileAccess->GetStream();
+                auto numEvents = m_eventsQueue.ForEachDrained([&ofs](LogEvent *evPtr)
                 {
-                    std::unique_ptr<LogEvent> ev(m_eventsQueue.Remove());
+                    std::unique_ptr<LogEvent> ev(evPtr);
 
                     // add the main details and message
-                    PrepareEventString(m_fileAccess->GetStream(), ev->time, ev->prio) << ev->what;
+                    PrepareEventString(ofs, ev->time, ev->prio) << ev->what;
 #   ifdef ENABLE_3FD_ERR_IMPL_DETAILS
                     if (ev->details.empty() == false) // add the details
-                        m_fileAccess->GetStream() << " - " << ev->details;
+                        ofs << " - " << ev->details;
 #   endif
 #   ifdef ENABLE_3FD_CST
                     if (ev->trace.empty() == false) // add the call stack trace
-                        m_fileAccess->GetStream() << _newLine_ _newLine_ "### CALL STACK TRACE ###" _newLine_ << ev->trace;
+                        ofs << _newLine_ _newLine_ "### CALL STACK TRACE ###" _newLine_ << ev->trace;
 #   endif
-                    m_fileAccess->GetStream() << std::endl << std::flush; // flush the content to the file
+                    ofs << '\n';
+                });
+
+                if (numEvents > 0)
+                {
+                    ofs << std::flush; // flush the content of the whole batch to the file
 
                     if (m_fileAccess->HasError())
                         throw AppException<std::runtime_error>("Failed to write in the log output file stream");
 
-                    --estimateRoomForLogEvents;
+                    estimateRoomForLogEvents -= static_cast<long> (numEvents);
                 }
 
                 // If the log file was supposed to reach its size limit now:
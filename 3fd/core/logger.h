@@ -111,8 +111,6 @@ namespace core
 
         std::thread m_logWriterThread;
 
-        utils::Event m_terminationEvent;
-
         utils::LockFreeQueue<LogEvent> m_eventsQueue;
 
         std::unique_ptr<ILogFileAccess> m_fileAccess;
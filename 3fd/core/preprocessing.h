@@ -27,6 +27,31 @@
 #   include <cassert>
 #endif
 
+// C++17 STL memory resources, when provided by the library (GCC 9+, Clang with libc++ 16+):
+#if !defined _3FD_HAS_STLOPTIMALLOC && defined __has_include
+#   if __has_include(<version>)
+#       include <version>
+#       if defined __cpp_lib_memory_resource && __cpp_lib_memory_resource >= 201603L
+#           define _3FD_HAS_STLOPTIMALLOC
+#       endif
+#   endif
+#endif
+
+// C++17 conversion of floating-point values by std::to_chars, when provided by the library (GCC 11+, MSVC 2019 16.4+):
+#if defined __has_include
+#   if __has_include(<version>)
+#       include <version>
+#       if defined __cpp_lib_to_chars && __cpp_lib_to_chars >= 201611L
+#           define _3FD_HAS_FLOAT_TO_CHARS
+#       endif
+#   endif
+#endif
+
+// C++20 coroutines, when enabled in the compiler:
+#if defined __cpp_impl_coroutine && __cpp_impl_coroutine >= 201902L
+#   define _3FD_HAS_COROUTINES
+#endif
+
 // Platform support for particular modules/features/resources:
 #ifdef _WIN32
 #   include <winapifamily.h>
@@ -4,6 +4,8 @@
 #include "gc.h"
 #include "logger.h"
 #include "runtime.h"
+#include <3fd/utils/threadpool.h>
+#include <3fd/utils/timerwheel.h>
 
 #ifdef _WIN32
 #   include <roapi.h>
@@ -182,6 +184,10 @@ namespace core
     /// </summary>
     FrameworkInstance::~FrameworkInstance()
     {
+        // timers feed the thread pool, whose pending tasks might still use the GC or write in the log:
+        utils::TimerWheel::Shutdown();
+        utils::ThreadPool::Shutdown();
+
         memory::GarbageCollector::Shutdown();
 
 #ifdef _WIN32
@@ -8,6 +8,7 @@
 
 #include <3fd/core/configuration.h>
 #include <3fd/core/logger.h>
+#include <3fd/utils/coroutine.h>
 
 #define CL_TARGET_OPENCL_VERSION 120
 #include <3fd/opencl/CL/cl.h>
@@ -15,6 +16,7 @@
 #include <array>
 #include <cstdint>
 #include <deque>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -387,8 +389,27 @@ namespace opencl
         void Detach();
 
         void Await();
+
+        void OnCompletion(const std::function<void()> &callback);
     };
 
+#ifdef _3FD_HAS_COROUTINES
+    /// <summary>
+    /// Awaits an asynchronous OpenCL command without blocking a thread.
+    /// The awaiting coroutine is resumed in the framework thread pool.
+    /// </summary>
+    /// <param name="action">The asynchronous action of the command.</param>
+    inline utils::Task<void> AwaitAsync(AsyncAction &action)
+    {
+        co_await utils::AwaitCompletion([&action](const std::function<void()> &callback)
+        {
+            action.OnCompletion(callback);
+        });
+
+        action.Await(); // does not block anymore, but raises the error of abnormal termination
+    }
+#endif
+
     class Kernel;
 
     /// <summary>
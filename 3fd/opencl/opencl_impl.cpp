@@ -427,6 +427,56 @@ namespace opencl
     }
 
 
+    /// <summary>
+    /// Called when a command awaited by <see cref="AsyncAction::OnCompletion"/> is completed.
+    /// </summary>
+    /// <param name="completedEvent">The completed command event.</param>
+    /// <param name="eventCommandExecStatus">The command execution status.</param>
+    /// <param name="args">The callback to invoke (heap allocated).</param>
+    /// <remarks>
+    /// This will be called asynchronously by OpenCL implementation. Thus, it MUST NOT throw unhandled exceptions.
+    /// </remarks>
+    static void CL_CALLBACK OnAsyncActionCompleted(cl_event completedEvent, cl_int eventCommandExecStatus, void *args)
+    {
+        std::unique_ptr<std::function<void()>> callback(static_cast<std::function<void()> *> (args));
+
+        try
+        {
+            (*callback)();
+        }
+        catch (core::IAppException &ex)
+        {
+            core::Logger::Write(ex, core::Logger::PRIO_ERROR);
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when invoking callback for completion of OpenCL command: " << ex.what();
+            core::Logger::Write(oss.str(), core::Logger::PRIO_ERROR);
+        }
+    }
+
+    /// <summary>
+    /// Subscribes a callback to be invoked when the asynchronous action completes (or terminates abnormally),
+    /// which allows for awaiting it without blocking a thread. After that, <see cref="Await"/> does not block.
+    /// </summary>
+    /// <param name="callback">The callback, which is invoked in a thread of the OpenCL implementation,
+    /// hence must be quick and must not make blocking calls to OpenCL.</param>
+    void AsyncAction::OnCompletion(const std::function<void()> &callback)
+    {
+        _ASSERTE(m_eventHandle != nullptr); // no event to await
+        CALL_STACK_TRACE;
+
+        std::unique_ptr<std::function<void()>> args(dbg_new std::function<void()>(callback));
+
+        OPENCL_IMPORT(clSetEventCallback);
+        cl_int status = clSetEventCallback(m_eventHandle, CL_COMPLETE, &OnAsyncActionCompleted, args.get());
+        openclErrors.RaiseExceptionWhen(status, "OpenCL API: clSetEventCallback");
+
+        args.release(); // now owned by the callback
+    }
+
+
     ////////////////////////
     //  Buffer Class
     ////////////////////////
@@ -6,11 +6,15 @@
 #ifndef SQLITE_H // header guard
 #define SQLITE_H
 
+#include <3fd/utils/coroutine.h>
+#include <3fd/utils/interning.h>
 #include <3fd/utils/lockfreequeue.h>
+#include <3fd/utils/retry.h>
 
 #include <atomic>
 #include <map>
 #include <string>
+#include <vector>
 
 class sqlite3;
 class sqlite3_stmt;
@@ -24,6 +28,10 @@ namespace sqlite
 {
     class PrepStatement; // forward class declaration
 
+    const utils::RetryOptions &GetLockRetryOptions();
+
+    utils::RetryBudget &GetLockRetryBudget();
+
     /// <summary>
     /// Represents a SQLite "connection" to a database.
     /// </summary>
@@ -70,10 +78,28 @@ namespace sqlite
         DatabaseConn &m_database;
         bool m_stepping;
 
-        std::map<string, int> m_columnIndexes;
+        // A name of column or parameter, which is owned by the statement because it comes from
+        // the query, and the interned name it was looked up with, so next lookups compare pointers.
+        struct Name
+        {
+            string text;
+            utils::InternedString interned;
+        };
+
+        // names of columns and parameters (by position)
+        std::vector<Name> m_columnNames;
+        std::vector<Name> m_paramNames;
 
         void CtorImpl(const char *query, size_t length);
 
+        static int FindName(std::vector<Name> &names, utils::InternedString name) noexcept;
+
+        int GetParamIndex(utils::InternedString paramName);
+
+        int GetColumnIndex(utils::InternedString columnName) noexcept;
+
+        void BindUtf8(utils::InternedString paramName, const char *text, size_t length);
+
     public:
         PrepStatement(DatabaseConn &database,
                         const string &query);
@@ -92,17 +118,17 @@ namespace sqlite
 
         string GetQuery() const;
 
-        void Bind(const string &paramName, int integer);
+        void Bind(utils::InternedString paramName, int integer);
 
-        void Bind(const string &paramName, long long integer);
+        void Bind(utils::InternedString paramName, long long integer);
 
-        void Bind(const string &paramName, double real);
+        void Bind(utils::InternedString paramName, double real);
 
-        void Bind(const string &paramName, const string &text);
+        void Bind(utils::InternedString paramName, const string &text);
 
-        void Bind(const string &paramName, const wstring &text);
+        void Bind(utils::InternedString paramName, const wstring &text);
 
-        void Bind(const string &paramName, const void *blob, int nBytes);
+        void Bind(utils::InternedString paramName, const void *blob, int nBytes);
 
         void ClearBindings();
 
@@ -112,19 +138,34 @@ namespace sqlite
 
         void Reset();
 
-        int GetColumnValueInteger(const string &columnName);
+        int GetColumnValueInteger(utils::InternedString columnName);
 
-        long long GetColumnValueInteger64(const string &columnName);
+        long long GetColumnValueInteger64(utils::InternedString columnName);
 
-        double GetColumnValueFloat64(const string &columnName);
+        double GetColumnValueFloat64(utils::InternedString columnName);
 
-        string GetColumnValueText(const string &columnName);
+        string GetColumnValueText(utils::InternedString columnName);
 
-        wstring GetColumnValueText16(const string &columnName);
+        wstring GetColumnValueText16(utils::InternedString columnName);
 
-        const void *GetColumnValueBlob(const string &columnName, int &nBytes);
+        const void *GetColumnValueBlob(utils::InternedString columnName, int &nBytes);
     };
 
+#ifdef _3FD_HAS_COROUTINES
+    /// <summary>
+    /// Steps a statement in the framework thread pool, so the awaiting coroutine does
+    /// not block its current thread. (SQLite has no asynchronous API of its own.)
+    /// The statement must not be used by anyone else until this completes.
+    /// </summary>
+    /// <param name="statement">The statement to step.</param>
+    /// <returns>The same as <see cref="PrepStatement::Step"/>.</returns>
+    inline utils::Task<int> StepAsync(PrepStatement &statement)
+    {
+        co_await utils::ScheduleOn(utils::ThreadPool::GetInstance());
+        co_return statement.Step();
+    }
+#endif
+
     class DbConnWrapper; // forward class declaration
 
     /// <summary>
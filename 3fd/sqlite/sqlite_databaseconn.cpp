@@ -19,6 +19,26 @@ namespace _3fd
 
     namespace sqlite
     {
+        /// <summary>
+        /// Gets how the operations retry when the database is busy or locked.
+        /// </summary>
+        const utils::RetryOptions &GetLockRetryOptions()
+        {
+            using std::chrono::milliseconds;
+            static const utils::RetryOptions options{ milliseconds(5), milliseconds(500), 0, milliseconds(60000) };
+            return options;
+        }
+
+        /// <summary>
+        /// Gets the budget of retries shared by all operations that retry when
+        /// the database is busy or locked, which limits a retry storm.
+        /// </summary>
+        utils::RetryBudget &GetLockRetryBudget()
+        {
+            static utils::RetryBudget budget(1000.0, 5000);
+            return budget;
+        }
+
         ///////////////////////////////
         // DatabaseConn Class
         ///////////////////////////////
@@ -7,14 +7,14 @@
 #include "sqlite.h"
 #include <3fd/core/exceptions.h>
 #include <3fd/core/logger.h>
-#include <3fd/utils/algorithms.h>
+#include <3fd/utils/retry.h>
+#include <3fd/utils/text.h>
 
 #include <sqlite3/sqlite3.h>
 #include <algorithm>
+#include <array>
 #include <cassert>
-#include <codecvt>
 #include <cstring>
-#include <locale>
 #include <sstream>
 
 #undef min
@@ -38,7 +38,10 @@ namespace _3fd
         {
             CALL_STACK_TRACE;
 
-            int attempts(0);
+            static utils::RetryPolicy retryPolicy("sqlite::PrepStatement::CtorImpl",
+                                                  GetLockRetryOptions(),
+                                                  &GetLockRetryBudget());
+            utils::Retrier retrier(retryPolicy);
 
             while (true)
             {
@@ -48,23 +51,21 @@ namespace _3fd
                                                 static_cast<int>(length + 1),
                                                 &m_stmtHandle,
                                                 nullptr);
-                ++attempts;
                 unsigned char primErrCode(status & 255);
 
                 if (status == SQLITE_OK)
                     break;
-                // Query preparation might fail if a shared lock could not be acquired:
-                else if (primErrCode == SQLITE_BUSY || primErrCode == SQLITE_LOCKED)
+                // Query preparation might fail if a shared lock could not be acquired,
+                // so wait a little for an opportunity of acquiring a lock (unless it gave up):
+                else if ((primErrCode == SQLITE_BUSY || primErrCode == SQLITE_LOCKED) && retrier.BackOff())
                 {
-                    // Wait a little for an opportunity of acquiring a lock:
-                    std::this_thread::sleep_for(
-                        utils::CalcExponentialBackOff(attempts, std::chrono::milliseconds(5)));
+                    continue;
                 }
                 else // However, if it fails for any other reason:
                 {
                     // Write in the log about the attempts:
                     ostringstream oss;
-                    oss << "Failed to prepare SQLite statement after " << attempts
+                    oss << "Failed to prepare SQLite statement after " << retrier.GetNumAttempts()
                         << " attempt(s): " << sqlite3_errstr(status);
 
                     core::Logger::Write(oss.str(), core::Logger::PRIO_ERROR);
@@ -83,11 +84,17 @@ namespace _3fd
             int numColumns = sqlite3_column_count(m_stmtHandle);
 
             // Get the names of the columns:
+            m_columnNames.reserve(numColumns);
             for (int index = 0; index < numColumns; ++index)
+                m_columnNames.push_back(Name{ sqlite3_column_name(m_stmtHandle, index), utils::InternedString() });
+
+            // Get the names of the parameters (those without a name are left empty):
+            int numParams = sqlite3_bind_parameter_count(m_stmtHandle);
+            m_paramNames.reserve(numParams);
+            for (int index = 1; index <= numParams; ++index)
             {
-                m_columnIndexes.emplace(
-                    string(sqlite3_column_name(m_stmtHandle, index)),
-                    index);
+                auto paramName = sqlite3_bind_parameter_name(m_stmtHandle, index);
+                m_paramNames.push_back(Name{ paramName != nullptr ? paramName : "", utils::InternedString() });
             }
         }
 
@@ -145,7 +152,7 @@ namespace _3fd
         /// </summary>
         /// <param name="ob">The object whose resources will be moved.</param>
         PrepStatement::PrepStatement(PrepStatement &&ob) noexcept
-            : m_stmtHandle(ob.m_stmtHandle), m_database(ob.m_database), m_columnIndexes(std::move(ob.m_columnIndexes)), m_stepping(ob.m_stepping)
+            : m_stmtHandle(ob.m_stmtHandle), m_database(ob.m_database), m_stepping(ob.m_stepping), m_columnNames(std::move(ob.m_columnNames)), m_paramNames(std::move(ob.m_paramNames))
         {
             ob.m_stmtHandle = nullptr;
         }
@@ -173,29 +180,63 @@ namespace _3fd
         }
 
         /// <summary>
-        /// Gets the index of a parameter in a SQLite statement.
+        /// Finds a name of column or parameter. Once found, the interned name is kept
+        /// along, so the next lookups with it only compare pointers.
+        /// </summary>
+        /// <param name="names">The names to search.</param>
+        /// <param name="name">The name to find.</param>
+        /// <returns>The position of the name, or -1 if not found.</returns>
+        int PrepStatement::FindName(std::vector<Name> &names, utils::InternedString name) noexcept
+        {
+            for (size_t index = 0; index < names.size(); ++index)
+            {
+                if (names[index].interned == name && !name.null())
+                    return static_cast<int> (index);
+            }
+
+            for (size_t index = 0; index < names.size(); ++index)
+            {
+                if (!names[index].text.empty() && names[index].text == name.str())
+                {
+                    names[index].interned = name;
+                    return static_cast<int> (index);
+                }
+            }
+
+            return -1;
+        }
+
+        /// <summary>
+        /// Gets the index of a parameter in this statement.
         /// </summary>
-        /// <param name="stmtHandle">The statement handle.</param>
         /// <param name="paramName">Name of the parameter.</param>
-        /// <returns>The parameter index.</returns>
-        static int GetParamIndex(sqlite3_stmt *stmtHandle, const string &paramName)
+        /// <returns>The parameter index, or zero if not found.</returns>
+        int PrepStatement::GetParamIndex(utils::InternedString paramName)
         {
-            int paramIndex = sqlite3_bind_parameter_index(stmtHandle, paramName.c_str());
+            int position = FindName(m_paramNames, paramName);
+            if (position >= 0)
+                return position + 1;
 
 #ifndef NDEBUG
+            CALL_STACK_TRACE;
+            ostringstream oss;
+            oss << "SQLite API: 'sqlite3_bind_parameter_index' - The parameter \'" << paramName.c_str()
+                << "\' was not found int the query. Please check SQLite documentation. Query was {" << sqlite3_sql(m_stmtHandle) << '}';
 
-            if (paramIndex == 0)
-            {
-                CALL_STACK_TRACE;
-                ostringstream oss;
-                oss << "SQLite API: 'sqlite3_bind_parameter_index' - The parameter \'" << paramName
-                    << "\' was not found int the query. Please check SQLite documentation. Query was {" << sqlite3_sql(stmtHandle) << '}';
-
-                throw core::AppException<std::runtime_error>("Could not find parameter in SQLite statement", oss.str());
-            }
+            throw core::AppException<std::runtime_error>("Could not find parameter in SQLite statement", oss.str());
+#else
+            return 0;
 #endif
+        }
 
-            return paramIndex;
+        /// <summary>
+        /// Gets the index of a column in the result set of this statement.
+        /// </summary>
+        /// <param name="columnName">Name of the column.</param>
+        /// <returns>The column index, or -1 if not found.</returns>
+        int PrepStatement::GetColumnIndex(utils::InternedString columnName) noexcept
+        {
+            return FindName(m_columnNames, columnName);
         }
 
         /// <summary>
@@ -203,10 +244,10 @@ namespace _3fd
         /// </summary>
         /// <param name="paramName">Name of the parameter.</param>
         /// <param name="integer">The integer value.</param>
-        void PrepStatement::Bind(const string &paramName, int integer)
+        void PrepStatement::Bind(utils::InternedString paramName, int integer)
         {
             int status = sqlite3_bind_int(m_stmtHandle,
-                                          GetParamIndex(m_stmtHandle, paramName),
+                                          GetParamIndex(paramName),
                                           integer);
             if (status != SQLITE_OK)
             {
@@ -214,7 +255,7 @@ namespace _3fd
                 ostringstream oss;
                 oss << "SQLite API error code " << status
                     << " - 'sqlite3_bind_int' reported: " << sqlite3_errstr(status)
-                    << ". Parameter was \'" << paramName
+                    << ". Parameter was \'" << paramName.c_str()
                     << "\' and the query was {" << sqlite3_sql(m_stmtHandle) << '}';
 
                 throw core::AppException<std::runtime_error>("Failed to bind integer value to the SQLite statement parameter", oss.str());
@@ -226,10 +267,10 @@ namespace _3fd
         /// </summary>
         /// <param name="paramName">Name of the parameter.</param>
         /// <param name="integer">The integer value.</param>
-        void PrepStatement::Bind(const string &paramName, long long integer)
+        void PrepStatement::Bind(utils::InternedString paramName, long long integer)
         {
             int status = sqlite3_bind_int64(m_stmtHandle,
-                                            GetParamIndex(m_stmtHandle, paramName),
+                                            GetParamIndex(paramName),
                                             integer);
             if (status != SQLITE_OK)
             {
@@ -237,7 +278,7 @@ namespace _3fd
                 ostringstream oss;
                 oss << "SQLite API error code " << status
                     << " - 'sqlite3_bind_int64' reported: " << sqlite3_errstr(status)
-                    << ". Parameter was \'" << paramName
+                    << ". Parameter was \'" << paramName.c_str()
                     << "\' and the query was {" << sqlite3_sql(m_stmtHandle) << '}';
 
                 throw core::AppException<std::runtime_error>("Failed to bind integer value to the SQLite statement parameter", oss.str());
@@ -249,10 +290,10 @@ namespace _3fd
         /// </summary>
         /// <param name="paramName">Name of the parameter.</param>
         /// <param name="real">The real number.</param>
-        void PrepStatement::Bind(const string &paramName, double real)
+        void PrepStatement::Bind(utils::InternedString paramName, double real)
         {
             int status = sqlite3_bind_double(m_stmtHandle,
-                                             GetParamIndex(m_stmtHandle, paramName),
+                                             GetParamIndex(paramName),
                                              real);
             if (status != SQLITE_OK)
             {
@@ -260,7 +301,7 @@ namespace _3fd
                 ostringstream oss;
                 oss << "SQLite API error code " << status
                     << " - 'sqlite3_bind_double' reported: " << sqlite3_errstr(status)
-                    << ". Parameter was \'" << paramName
+                    << ". Parameter was \'" << paramName.c_str()
                     << "\' and the query was {" << sqlite3_sql(m_stmtHandle) << '}';
 
                 throw core::AppException<std::runtime_error>("Failed to bind floating point value to the SQLite statement parameter", oss.str());
@@ -272,12 +313,23 @@ namespace _3fd
         /// </summary>
         /// <param name="paramName">Name of the parameter.</param>
         /// <param name="text">The text content.</param>
-        void PrepStatement::Bind(const string &paramName, const string &text)
+        void PrepStatement::Bind(utils::InternedString paramName, const string &text)
+        {
+            BindUtf8(paramName, text.data(), text.size());
+        }
+
+        /// <summary>
+        /// Binds the specified parameter to a text value (UTF-8 encoded).
+        /// </summary>
+        /// <param name="paramName">Name of the parameter.</param>
+        /// <param name="text">The text value (UTF-8 encoded).</param>
+        /// <param name="length">The length of the text, in bytes.</param>
+        void PrepStatement::BindUtf8(utils::InternedString paramName, const char *text, size_t length)
         {
             int status = sqlite3_bind_text(m_stmtHandle,
-                                           GetParamIndex(m_stmtHandle, paramName),
-                                           text.data(),
-                                           static_cast<int>(text.size()),
+                                           GetParamIndex(paramName),
+                                           text,
+                                           static_cast<int>(length),
                                            SQLITE_TRANSIENT);
             if (status != SQLITE_OK)
             {
@@ -285,7 +337,7 @@ namespace _3fd
                 ostringstream oss;
                 oss << "SQLite API error code " << status
                     << " - 'sqlite3_bind_text' reported: " << sqlite3_errstr(status)
-                    << ". Parameter was \'" << paramName
+                    << ". Parameter was \'" << paramName.c_str()
                     << "\' and the query was {" << sqlite3_sql(m_stmtHandle) << '}';
 
                 throw core::AppException<std::runtime_error>("Failed to bind text content to the SQLite statement parameter", oss.str());
@@ -297,18 +349,21 @@ namespace _3fd
         /// </summary>
         /// <param name="paramName">Name of the parameter.</param>
         /// <param name="text">The text value (UCS-2 encoded).</param>
-        void PrepStatement::Bind(const string &paramName, const wstring &text)
+        void PrepStatement::Bind(utils::InternedString paramName, const wstring &text)
         {
             CALL_STACK_TRACE;
 
             try
             {
-                // Transcode UCS-2 into UTF-8:
-                std::wstring_convert<std::codecvt_utf8<wchar_t>> transcoder;
-                auto textAsUTF8 = transcoder.to_bytes(text);
-
-                // Always store text as UTF-8:
-                Bind(paramName, textAsUTF8);
+                // Always store text as UTF-8 (transcoded in the stack, unless too long):
+                std::array<char, 1024> buffer;
+                if (utils::GetMaxUtf8Length(text.size()) <= buffer.size())
+                {
+                    auto length = utils::to_utf8(text, buffer.data(), buffer.size());
+                    BindUtf8(paramName, buffer.data(), length);
+                }
+                else
+                    Bind(paramName, utils::to_utf8(text));
             }
             catch (core::IAppException &)
             {
@@ -327,10 +382,10 @@ namespace _3fd
         /// </summary>
         /// <param name="paramName">Name of the parameter.</param>
         /// <param name="blob">The blob value.</param>
-        void PrepStatement::Bind(const string &paramName, const void *blob, int nBytes)
+        void PrepStatement::Bind(utils::InternedString paramName, const void *blob, int nBytes)
         {
             int status = sqlite3_bind_blob(m_stmtHandle,
-                                           GetParamIndex(m_stmtHandle, paramName),
+                                           GetParamIndex(paramName),
                                            blob,
                                            nBytes,
                                            SQLITE_TRANSIENT);
@@ -340,7 +395,7 @@ namespace _3fd
                 ostringstream oss;
                 oss << "SQLite API error code " << status
                     << " - 'sqlite3_bind_blob' reported: " << sqlite3_errstr(status)
-                    << ". Parameter was \'" << paramName
+                    << ". Parameter was \'" << paramName.c_str()
                     << "\' and the query was {" << sqlite3_sql(m_stmtHandle) << '}';
 
                 throw core::AppException<std::runtime_error>("Failed to bind text content to the SQLite statement parameter", oss.str());
@@ -375,13 +430,15 @@ namespace _3fd
         {
             CALL_STACK_TRACE;
 
-            int attempts(0);
+            static utils::RetryPolicy retryPolicy("sqlite::PrepStatement::Step",
+                                                  GetLockRetryOptions(),
+                                                  &GetLockRetryBudget());
+            utils::Retrier retrier(retryPolicy);
 
             while (true)
             {
                 int status = sqlite3_step(m_stmtHandle);
 
-                ++attempts;
                 unsigned char primErrCode(status & 255);
 
                 // Succesfully issue a row of the result set:
@@ -397,12 +454,10 @@ namespace _3fd
                     Reset();
                     return status;
                 }
-                // Failed because it could not get a lock:
-                else if (primErrCode == SQLITE_BUSY || primErrCode == SQLITE_LOCKED)
+                // Failed because it could not get a lock, so wait a little before retrying (unless it gave up):
+                else if ((primErrCode == SQLITE_BUSY || primErrCode == SQLITE_LOCKED) && retrier.BackOff())
                 {
-                    // Wait a little before retrying the lock:
-                    std::this_thread::sleep_for(
-                        utils::CalcExponentialBackOff(attempts, std::chrono::milliseconds(5)));
+                    continue;
                 }
                 else // However, when it fails for any other reason:
                 {
@@ -410,7 +465,7 @@ namespace _3fd
                     {
                         // Write in the log about the attempts:
                         ostringstream oss;
-                        oss << "Failed to execute step of SQLite statement after " << attempts
+                        oss << "Failed to execute step of SQLite statement after " << retrier.GetNumAttempts()
                             << " attempt(s): " << sqlite3_errstr(status);
 
                         core::Logger::Write(oss.str(), core::Logger::PRIO_ERROR, true);
@@ -499,22 +554,22 @@ namespace _3fd
         /// </summary>
         /// <param name="columnName">Name of the column.</param>
         /// <returns>The column value.</returns>
-        int PrepStatement::GetColumnValueInteger(const string &columnName)
+        int PrepStatement::GetColumnValueInteger(utils::InternedString columnName)
         {
             _ASSERTE(m_stepping == true); // Cannot retrieve a value before stepping into the query execution
 
-            auto iter = m_columnIndexes.find(columnName);
+            int columnIndex = GetColumnIndex(columnName);
 
-            if (m_columnIndexes.end() != iter)
+            if (columnIndex >= 0)
             {
-                _ASSERTE(sqlite3_column_type(m_stmtHandle, iter->second) == SQLITE_INTEGER); // Fires if the specified column does not hold an integer number as value
-                return sqlite3_column_int(m_stmtHandle, iter->second);
+                _ASSERTE(sqlite3_column_type(m_stmtHandle, columnIndex) == SQLITE_INTEGER); // Fires if the specified column does not hold an integer number as value
+                return sqlite3_column_int(m_stmtHandle, columnIndex);
             }
             else
             {
                 CALL_STACK_TRACE;
                 ostringstream oss;
-                oss << "SQLite wrapper error: the column \'" << columnName
+                oss << "SQLite wrapper error: the column \'" << columnName.c_str()
                     << "\' does not belong to the output row. Query was {" << sqlite3_sql(m_stmtHandle) << '}';
 
                 throw core::AppException<std::runtime_error>("Failed to get integer value from SQLite query result", oss.str());
@@ -526,22 +581,22 @@ namespace _3fd
         /// </summary>
         /// <param name="columnName">Name of the column.</param>
         /// <returns>The column value.</returns>
-        long long PrepStatement::GetColumnValueInteger64(const string &columnName)
+        long long PrepStatement::GetColumnValueInteger64(utils::InternedString columnName)
         {
             _ASSERTE(m_stepping == true); // Cannot retrieve a value before stepping into the query execution
 
-            auto iter = m_columnIndexes.find(columnName);
+            int columnIndex = GetColumnIndex(columnName);
 
-            if (m_columnIndexes.end() != iter)
+            if (columnIndex >= 0)
             {
-                _ASSERTE(sqlite3_column_type(m_stmtHandle, iter->second) == SQLITE_INTEGER); // Fires if the specified column does not hold an integer number as value
-                return sqlite3_column_int64(m_stmtHandle, iter->second);
+                _ASSERTE(sqlite3_column_type(m_stmtHandle, columnIndex) == SQLITE_INTEGER); // Fires if the specified column does not hold an integer number as value
+                return sqlite3_column_int64(m_stmtHandle, columnIndex);
             }
             else
             {
                 CALL_STACK_TRACE;
                 ostringstream oss;
-                oss << "SQLite wrapper error: the column \'" << columnName
+                oss << "SQLite wrapper error: the column \'" << columnName.c_str()
                     << "\' does not belong to the output row. Query was {" << sqlite3_sql(m_stmtHandle) << '}';
 
                 throw core::AppException<std::runtime_error>("Failed to get integer value from SQLite query result", oss.str());
@@ -553,22 +608,22 @@ namespace _3fd
         /// </summary>
         /// <param name="columnName">Name of the column.</param>
         /// <returns>The column value.</returns>
-        double PrepStatement::GetColumnValueFloat64(const string &columnName)
+        double PrepStatement::GetColumnValueFloat64(utils::InternedString columnName)
         {
             _ASSERTE(m_stepping == true); // Cannot retrieve a value before stepping into the query execution
 
-            auto iter = m_columnIndexes.find(columnName);
+            int columnIndex = GetColumnIndex(columnName);
 
-            if (m_columnIndexes.end() != iter)
+            if (columnIndex >= 0)
             {
-                _ASSERTE(sqlite3_column_type(m_stmtHandle, iter->second) == SQLITE_FLOAT); // Fires if the specified column does not hold a floating point number as value
-                return sqlite3_column_double(m_stmtHandle, iter->second);
+                _ASSERTE(sqlite3_column_type(m_stmtHandle, columnIndex) == SQLITE_FLOAT); // Fires if the specified column does not hold a floating point number as value
+                return sqlite3_column_double(m_stmtHandle, columnIndex);
             }
             else
             {
                 CALL_STACK_TRACE;
                 ostringstream oss;
-                oss << "SQLite wrapper error: the column \'" << columnName
+                oss << "SQLite wrapper error: the column \'" << columnName.c_str()
                     << "\' does not belong to the output row. Query was {" << sqlite3_sql(m_stmtHandle) << '}';
 
                 throw core::AppException<std::runtime_error>("Failed to get floating point value from SQLite query result", oss.str());
@@ -580,22 +635,22 @@ namespace _3fd
         /// </summary>
         /// <param name="columnName">Name of the column.</param>
         /// <returns>The column value.</returns>
-        string PrepStatement::GetColumnValueText(const string &columnName)
+        string PrepStatement::GetColumnValueText(utils::InternedString columnName)
         {
             _ASSERTE(m_stepping == true); // Cannot retrieve a value before stepping into the query execution
 
-            auto iter = m_columnIndexes.find(columnName);
+            int columnIndex = GetColumnIndex(columnName);
 
-            if (m_columnIndexes.end() != iter)
+            if (columnIndex >= 0)
             {
-                _ASSERTE(sqlite3_column_type(m_stmtHandle, iter->second) == SQLITE_TEXT); // Fires if the specified column does not hold text content
-                return reinterpret_cast<const char *>(sqlite3_column_text(m_stmtHandle, iter->second));
+                _ASSERTE(sqlite3_column_type(m_stmtHandle, columnIndex) == SQLITE_TEXT); // Fires if the specified column does not hold text content
+                return reinterpret_cast<const char *>(sqlite3_column_text(m_stmtHandle, columnIndex));
             }
             else
             {
                 CALL_STACK_TRACE;
                 ostringstream oss;
-                oss << "SQLite wrapper error: the column \'" << columnName
+                oss << "SQLite wrapper error: the column \'" << columnName.c_str()
                     << "\' does not belong to the output row. Query was {" << sqlite3_sql(m_stmtHandle) << '}';
 
                 throw core::AppException<std::runtime_error>("Failed to get text content from SQLite query result", oss.str());
@@ -607,22 +662,28 @@ namespace _3fd
         /// </summary>
         /// <param name="columnName">Name of the column.</param>
         /// <returns>The column value (UTF-16 encoded).</returns>
-        wstring PrepStatement::GetColumnValueText16(const string &columnName)
+        wstring PrepStatement::GetColumnValueText16(utils::InternedString columnName)
         {
             _ASSERTE(m_stepping == true); // Cannot retrieve a value before stepping into the query execution
 
-            auto iter = m_columnIndexes.find(columnName);
+            int columnIndex = GetColumnIndex(columnName);
 
-            if (m_columnIndexes.end() != iter)
+            if (columnIndex >= 0)
             {
-                _ASSERTE(sqlite3_column_type(m_stmtHandle, iter->second) == SQLITE_TEXT); // Fires if the specified column does not hold text content
-                return reinterpret_cast<const wchar_t *>(sqlite3_column_text16(m_stmtHandle, iter->second));
+                _ASSERTE(sqlite3_column_type(m_stmtHandle, columnIndex) == SQLITE_TEXT); // Fires if the specified column does not hold text content
+#   ifdef _WIN32
+                return reinterpret_cast<const wchar_t *>(sqlite3_column_text16(m_stmtHandle, columnIndex));
+#   else
+                // wide characters are not UTF-16 here:
+                auto text = reinterpret_cast<const char *>(sqlite3_column_text(m_stmtHandle, columnIndex));
+                return utils::to_ucs2(std::string_view(text, sqlite3_column_bytes(m_stmtHandle, columnIndex)));
+#   endif
             }
             else
             {
                 CALL_STACK_TRACE;
                 ostringstream oss;
-                oss << "SQLite wrapper error: the column \'" << columnName
+                oss << "SQLite wrapper error: the column \'" << columnName.c_str()
                     << "\' does not belong to the output row. Query was {" << sqlite3_sql(m_stmtHandle) << '}';
 
                 throw core::AppException<std::runtime_error>("Failed to get text content from SQLite query result", oss.str());
@@ -634,24 +695,24 @@ namespace _3fd
         /// </summary>
         /// <param name="columnName">Name of the column.</param>
         /// <returns>The column value.</returns>
-        const void *PrepStatement::GetColumnValueBlob(const string &columnName, int &nBytes)
+        const void *PrepStatement::GetColumnValueBlob(utils::InternedString columnName, int &nBytes)
         {
             _ASSERTE(m_stepping == true); // Cannot retrieve a value before stepping into the query execution
 
-            auto iter = m_columnIndexes.find(columnName);
+            int columnIndex = GetColumnIndex(columnName);
 
-            if (m_columnIndexes.end() != iter)
+            if (columnIndex >= 0)
             {
-                _ASSERTE(sqlite3_column_type(m_stmtHandle, iter->second) == SQLITE_BLOB); // Fires if the specified column does not hold blob content
-                auto blob = sqlite3_column_blob(m_stmtHandle, iter->second);
-                nBytes = sqlite3_column_bytes(m_stmtHandle, iter->second);
+                _ASSERTE(sqlite3_column_type(m_stmtHandle, columnIndex) == SQLITE_BLOB); // Fires if the specified column does not hold blob content
+                auto blob = sqlite3_column_blob(m_stmtHandle, columnIndex);
+                nBytes = sqlite3_column_bytes(m_stmtHandle, columnIndex);
                 return blob;
             }
             else
             {
                 CALL_STACK_TRACE;
                 ostringstream oss;
-                oss << "SQLite wrapper error: the column \'" << columnName
+                oss << "SQLite wrapper error: the column \'" << columnName.c_str()
                     << "\' does not belong to the output row. Query was {" << sqlite3_sql(m_stmtHandle) << '}';
 
                 throw core::AppException<std::runtime_error>("Failed to get blob content from SQLite query result", oss.str());
@@ -7,7 +7,7 @@
 #include "sqlite.h"
 #include <3fd/core/exceptions.h>
 #include <3fd/core/logger.h>
-#include <3fd/utils/algorithms.h>
+#include <3fd/utils/retry.h>
 
 #include <sqlite3/sqlite3.h>
 #include <cassert>
@@ -63,33 +63,18 @@ namespace _3fd
         {
             CALL_STACK_TRACE;
 
-            auto commit = m_conn.Get().CreateStatement("COMMIT TRANSACTION;");
-            int status, attempts(1);
+            // Step retries on lock conflict (with the shared lock retry policy), so there is a single layer of retries:
+            int status = m_conn.Get().CreateStatement("COMMIT TRANSACTION;").Step(false);
 
-            while ((status = commit.TryStep(false)) != SQLITE_DONE) // It does not throw exceptions because the status must first be analysed
+            if (status != SQLITE_DONE)
             {
-                unsigned char primErrCode(status & 255);
-
-                // When the commit phase of a transaction fails because it cannot get an exclusive lock:
-                if (primErrCode == SQLITE_BUSY || primErrCode == SQLITE_LOCKED)
-                {
-                    // Wait a little for an eventual ongoing WAL checkpoint operation:
-                    std::this_thread::sleep_for(
-                        utils::CalcExponentialBackOff(attempts, std::chrono::milliseconds(5)));
-                }
-                else // However, when it fails for any other reason:
-                {
-                    ostringstream oss;
-                    oss << "Failed to commit SQLite transaction after " << attempts
-                        << " attempt(s) with error code " << status
-                        << ": " << sqlite3_errstr(status);
+                ostringstream oss;
+                oss << "Failed to commit SQLite transaction with error code " << status
+                    << ": " << sqlite3_errstr(status);
 
-                    core::Logger::Write(oss.str(), core::Logger::PRIO_ERROR, true);
-                    return; // abort
-                }
-
-                ++attempts;
-            } // loop: retry the commit
+                core::Logger::Write(oss.str(), core::Logger::PRIO_ERROR, true);
+                return; // abort
+            }
 
             m_committed = true;
         }
@@ -102,31 +87,34 @@ namespace _3fd
             CALL_STACK_TRACE;
 
             auto rollback = m_conn.Get().CreateStatement("ROLLBACK TRANSACTION;");
-            int status, attempts(1);
+
+            // Nothing else would roll back the transaction, so it never gives up on lock conflict:
+            using std::chrono::milliseconds;
+            static const utils::RetryOptions retryOptions{ GetLockRetryOptions().baseDelay, GetLockRetryOptions().maxDelay, 0, milliseconds(0) };
+            static utils::RetryPolicy retryPolicy("sqlite::Transaction::RollBack", retryOptions);
+            utils::Retrier retrier(retryPolicy);
+            int status;
 
             while ((status = rollback.TryStep(false)) != SQLITE_DONE) // It does not throw exceptions because it might be called by the destructor:
             {
                 unsigned char primErrCode(status & 255);
 
                 // When the transaction rollback fails because it cannot get a shared lock:
-                if (primErrCode == SQLITE_BUSY || primErrCode == SQLITE_LOCKED)
+                // wait a little for an eventual pending read operation:
+                if ((primErrCode == SQLITE_BUSY || primErrCode == SQLITE_LOCKED) && retrier.BackOff())
                 {
-                    // Wait a little for an eventual pending read operation:
-                    std::this_thread::sleep_for(
-                        utils::CalcExponentialBackOff(attempts, std::chrono::milliseconds(5)));
+                    continue;
                 }
                 else // However, when it fails for any other reason:
                 {
                     ostringstream oss;
-                    oss << "Failed to rollback SQLite transaction after " << attempts
+                    oss << "Failed to rollback SQLite transaction after " << retrier.GetNumAttempts()
                         << " attempt(s) with error code " << status
                         << ": " << sqlite3_errstr(status);
 
                     core::Logger::Write(oss.str(), core::Logger::PRIO_CRITICAL, true);
                     return; // abort
                 }
-
-                ++attempts;
             } // loop: retry the rollback
         }
 
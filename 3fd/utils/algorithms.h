@@ -6,30 +6,121 @@
 #ifndef UTILS_ALGORITHMS_H // header guard
 #define UTILS_ALGORITHMS_H
 
+#include <3fd/core/preprocessing.h>
+
 #include <chrono>
+#include <cinttypes>
 #include <cmath>
 #include <cstdlib>
 #include <functional>
 #include <iterator>
+#include <memory>
+#include <vector>
 #include <algorithm>
 
+#ifdef _MSC_VER
+#   include <intrin.h>
+#endif
+
 namespace _3fd
 {
 namespace utils
 {
+    /// <summary>
+    /// Hints the processor to bring into cache the memory at a given address.
+    /// </summary>
+    inline void PrefetchForRead(const void *addr) noexcept
+    {
+#   if defined __GNUC__ || defined __clang__
+        __builtin_prefetch(addr, 0, 3);
+#   elif defined _M_X64 || defined _M_IX86
+        _mm_prefetch(static_cast<const char *> (addr), _MM_HINT_T0);
+#   else
+        (void)addr;
+#   endif
+    }
+
+    /// <summary>
+    /// Finds the first position in a sorted range whose key is not less than the searched one.
+    /// The loop has a fixed amount of iterations for a given length and no branch depending on
+    /// the comparison (compiled to conditional moves), so it suffers no misprediction, and the
+    /// positions visited in the next iteration are prefetched.
+    /// </summary>
+    /// <param name="begin">A random access iterator to the first position of the range.</param>
+    /// <param name="end">A random access iterator to one past the last position of the range.</param>
+    /// <param name="searchKey">The key to search for.</param>
+    /// <param name="getKey">A functor that retrieves the key for an object.</param>
+    /// <param name="lessThan">A functor that evaluates when a key value is less than another.</param>
+    /// <returns>An iterator to the lower bound, or 'end' if all keys are less.</returns>
+    template <typename IterType, typename SearchKeyType, typename GetKeyFnType, typename LessFnType>
+    IterType BranchlessLowerBound(IterType begin,
+                                  IterType end,
+                                  const SearchKeyType &searchKey,
+                                  GetKeyFnType getKey,
+                                  LessFnType lessThan) noexcept
+    {
+        auto length = std::distance(begin, end);
+        if (length == 0)
+            return end;
+
+        auto base = begin;
+        while (length > 1)
+        {
+            auto half = length / 2;
+            PrefetchForRead(std::addressof(*(base + half / 2)));
+            PrefetchForRead(std::addressof(*(base + half + half / 2)));
+            base = lessThan(getKey(*(base + (half - 1))), searchKey) ? base + half : base;
+            length -= half;
+        }
+
+        return base + (lessThan(getKey(*base), searchKey) ? 1 : 0);
+    }
+
+    /// <summary>
+    /// Finds the first position in a sorted range whose key is greater than the searched one.
+    /// Like <see cref="BranchlessLowerBound"/>, has no branch depending on the comparison.
+    /// </summary>
+    /// <param name="begin">A random access iterator to the first position of the range.</param>
+    /// <param name="end">A random access iterator to one past the last position of the range.</param>
+    /// <param name="searchKey">The key to search for.</param>
+    /// <param name="getKey">A functor that retrieves the key for an object.</param>
+    /// <param name="lessThan">A functor that evaluates when a key value is less than another.</param>
+    /// <returns>An iterator to the upper bound, or 'end' if no key is greater.</returns>
+    template <typename IterType, typename SearchKeyType, typename GetKeyFnType, typename LessFnType>
+    IterType BranchlessUpperBound(IterType begin,
+                                  IterType end,
+                                  const SearchKeyType &searchKey,
+                                  GetKeyFnType getKey,
+                                  LessFnType lessThan) noexcept
+    {
+        auto length = std::distance(begin, end);
+        if (length == 0)
+            return end;
+
+        auto base = begin;
+        while (length > 1)
+        {
+            auto half = length / 2;
+            PrefetchForRead(std::addressof(*(base + half / 2)));
+            PrefetchForRead(std::addressof(*(base + half + half / 2)));
+            base = lessThan(searchKey, getKey(*(base + (half - 1)))) ? base : base + half;
+            length -= half;
+        }
+
+        return base + (lessThan(searchKey, getKey(*base)) ? 0 : 1);
+    }
+
     /// <summary>
     /// Binary search in sub-range of vector containing map cases entries.
     /// </summary>
     /// <param name="begin">An iterator to the first position of the sub-range.
-    /// In the end, this parameter keeps the beginning of the last sub-range this
-    /// iterative algorithm has delved into.</param>
-    /// <param name="begin">An iterator to one past the last position of the sub-range.
-    /// In the end, this parameter keeps the end of the last sub-range this iterative
-    /// algorithm has delved into.</param>
+    /// If there is no match, receives the position where the key was supposed to be found.</param>
+    /// <param name="end">An iterator to one past the last position of the sub-range.
+    /// If there is no match, receives the position where the key was supposed to be found.</param>
     /// <param name="searchKey">The key to search for.</param>
     /// <param name="getKey">A functor that retrieves the key for an object.</param>
     /// <param name="lessThan">A functor that evaluates when a key value is less than another.</param>
-    /// <returns>An iterator to the found entry. If there was no match,
+    /// <returns>An iterator to the first matching entry. If there was no match,
     /// 'begin == end' in the position it was supposed to be found.</returns>
     template <typename IterType, typename SearchKeyType, typename GetKeyFnType, typename LessFnType>
     IterType BinarySearch(IterType &begin,
@@ -38,38 +129,12 @@ namespace utils
                           GetKeyFnType getKey,
                           LessFnType lessThan) noexcept
     {
-        auto length = std::distance(begin, end);
+        auto iter = BranchlessLowerBound(begin, end, searchKey, getKey, lessThan);
 
-        if (length > 7)
-        {
-            while (begin != end)
-            {
-                auto middle = begin + std::distance(begin, end) / 2;
-
-                if (lessThan(getKey(*middle), searchKey))
-                    begin = middle + 1;
-                else if (lessThan(searchKey, getKey(*middle)))
-                    end = middle;
-                else
-                    return middle;
-            }
-
-            return begin;
-        }
-
-        // Linear search when container is small:
+        if (iter == end || lessThan(searchKey, getKey(*iter)))
+            return begin = end = iter;
 
-        while (begin != end)
-        {
-            if (lessThan(getKey(*begin), searchKey))
-                ++begin;
-            else if (lessThan(searchKey, getKey(*begin)))
-                return end = begin;
-            else
-                return begin;
-        }
-
-        return begin;
+        return iter;
     }
 
     template <typename IterType1,
@@ -91,7 +156,9 @@ namespace utils
     }
 
     /// <summary>
-    /// Gets the sub range of entries that match the given key (using binary search).
+    /// Gets the sub range of entries that match the given key. The search is a single
+    /// pass of binary search until a match, which then splits in the (branchless) search
+    /// of the lower bound at the left and the upper bound at the right.
     /// </summary>
     /// <param name="subRangeBegin">An iterator to the first position of
     /// the range to search, and receives the same for the found sub-range.</param>
@@ -110,50 +177,174 @@ namespace utils
                            GetKeyFnType getKey,
                            LessFnType lessThan) noexcept
     {
-        auto firstMatch = BinarySearch(subRangeBegin,
-                                       subRangeEnd,
-                                       searchKey,
-                                       getKey,
-                                       lessThan);
+        auto first = subRangeBegin;
+        auto length = std::distance(subRangeBegin, subRangeEnd);
+
+        while (length > 0)
+        {
+            auto half = length / 2;
+            auto middle = first + half;
+
+            if (lessThan(getKey(*middle), searchKey))
+            {
+                first = middle + 1;
+                length -= half + 1;
+            }
+            else if (lessThan(searchKey, getKey(*middle)))
+            {
+                length = half;
+            }
+            else
+            {
+                subRangeBegin = BranchlessLowerBound(first, middle, searchKey, getKey, lessThan);
+                subRangeEnd = BranchlessUpperBound(middle + 1, first + length, searchKey, getKey, lessThan);
+                return true;
+            }
+        }
+
+        // no match:
+        subRangeBegin = subRangeEnd = first;
+        return false;
+    }
+
+    /// <summary>
+    /// Counts the trailing zero bits of a (non-zero) value.
+    /// </summary>
+    inline uint32_t CountTrailingZeros(uint64_t value) noexcept
+    {
+#   ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return index;
+#   else
+        return __builtin_ctzll(value);
+#   endif
+    }
+
+    /// <summary>
+    /// A static sorted array for read-mostly lookup tables, stored in the order of
+    /// a breadth-first traversal of the implicit binary search tree (Eytzinger layout).
+    /// The first levels of the tree share a few cache lines, the descendants of a node
+    /// some levels below are contiguous and can be prefetched, and the search has no
+    /// branch depending on comparison, so lookups in large tables are much faster than
+    /// binary search over the sorted order.
+    /// </summary>
+    /// <remarks>
+    /// The element type must be default constructible.
+    /// Compare with a transparent functor, such as std::less&lt;&gt;,
+    /// to search for keys of another type.
+    /// </remarks>
+    template <typename ValueType, typename LessFnType = std::less<>>
+    class EytzingerArray
+    {
+    private:
 
-        // no match?
-        if (subRangeBegin == subRangeEnd)
-            return false;
+        // position 0 is unused, so the children of position k are in 2k & 2k+1:
+        std::vector<ValueType> m_elements;
 
-        auto end = firstMatch;
+        LessFnType m_lessThan;
 
-        do // iterate to find lower bound:
+        template <typename IterType>
+        void Fill(IterType &iter, size_t pos)
         {
-            // search another match in the left partition:
-            end = BinarySearch(subRangeBegin,
-                               end,
-                               searchKey,
-                               getKey,
-                               lessThan);
+            if (pos < m_elements.size())
+            {
+                Fill(iter, 2 * pos);
+                m_elements[pos] = *iter++;
+                Fill(iter, 2 * pos + 1);
+            }
+        }
 
-        } while (subRangeBegin != end);
+    public:
 
-        /* Now go back to the partition at the right of the first
-        match, and start looking for the end of the range: */
+        /// <summary>
+        /// Initializes a new instance of the <see cref="EytzingerArray"/> class.
+        /// </summary>
+        /// <param name="begin">An iterator to the first position of a sorted range.</param>
+        /// <param name="end">An iterator to one past the last position of the sorted range.</param>
+        /// <param name="lessThan">The functor that evaluates when an element is less than another.</param>
+        template <typename IterType>
+        EytzingerArray(IterType begin, IterType end, LessFnType lessThan = LessFnType())
+            : m_elements(std::distance(begin, end) + 1)
+            , m_lessThan(lessThan)
+        {
+            _ASSERTE(std::is_sorted(begin, end, lessThan));
+            Fill(begin, 1);
+        }
 
-        auto begin = firstMatch;
+        /// <summary>
+        /// Gets the amount of elements.
+        /// </summary>
+        size_t GetSize() const noexcept { return m_elements.size() - 1; }
 
-        do  // iterate to find upper bound:
+        /// <summary>
+        /// Finds the least element that is not less than the searched key.
+        /// </summary>
+        /// <param name="searchKey">The key to search for.</param>
+        /// <returns>A pointer to the found element, or null if all elements are less.</returns>
+        template <typename SearchKeyType>
+        const ValueType *LowerBound(const SearchKeyType &searchKey) const noexcept
         {
-            // search another match in the right partition:
-            begin = BinarySearch(begin + 1,
-                                 subRangeEnd,
-                                 searchKey,
-                                 getKey,
-                                 lessThan);
+            // amount of descendants in a cache line, 4 levels below:
+            constexpr size_t prefetchDistance = 16;
+
+            const auto size = m_elements.size();
+            const auto elements = m_elements.data();
+
+            size_t pos(1);
+            while (pos < size)
+            {
+                if (prefetchDistance * pos < size)
+                    PrefetchForRead(elements + prefetchDistance * pos);
+
+                pos = 2 * pos + (m_lessThan(elements[pos], searchKey) ? 1 : 0);
+            }
+
+            // undo the moves to the right made after the last move to the left:
+            pos >>= CountTrailingZeros(~static_cast<uint64_t> (pos)) + 1;
+            return pos != 0 ? elements + pos : nullptr;
+        }
 
-        } while (begin != subRangeEnd);
+        /// <summary>
+        /// Finds an element equivalent to the searched key.
+        /// </summary>
+        /// <param name="searchKey">The key to search for.</param>
+        /// <returns>A pointer to the found element, or null if there was no match.</returns>
+        template <typename SearchKeyType>
+        const ValueType *Find(const SearchKeyType &searchKey) const noexcept
+        {
+            auto element = LowerBound(searchKey);
+            return (element != nullptr && !m_lessThan(searchKey, *element)) ? element : nullptr;
+        }
+    };
 
-        return true;
+    /// <summary>
+    /// Generates a pseudo-random number (xorshift64*) from a state local to the
+    /// calling thread, hence thread-safe without any lock. Not for cryptography.
+    /// </summary>
+    inline uint64_t GenerateThreadLocalRandom() noexcept
+    {
+        thread_local uint64_t state(0);
+
+        // seed from the clock and the address of the state, which differs among threads:
+        if (state == 0)
+        {
+            state = static_cast<uint64_t> (std::chrono::steady_clock::now().time_since_epoch().count())
+                ^ (reinterpret_cast<uintptr_t> (&state) * 0x9E3779B97F4A7C15ULL);
+
+            if (state == 0)
+                state = 0x9E3779B97F4A7C15ULL;
+        }
+
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
     }
 
     /// <summary>
     /// Calculates the exponential back off given the attempt and time slot.
+    /// For retry loops, prefer <see cref="RetryPolicy"/>.
     /// </summary>
     /// <param name="attempt">The attempt (base 0).</param>
     /// <param name="timeSlot">The time slot.</param>
@@ -162,16 +353,9 @@ namespace utils
     std::chrono::duration<RepType, PeriodType> CalcExponentialBackOff(unsigned int attempt,
                                                                       std::chrono::duration<RepType, PeriodType> timeSlot)
     {
-        static bool first(true);
-
-        if (first)
-        {
-            srand(static_cast<uint32_t>(time(nullptr)));
-            first = false;
-        }
-
+        // random amount of slots in [0, 2^attempt - 1]:
         auto k = static_cast<unsigned int> (
-            std::abs(1.0F * rand() / RAND_MAX) * ((1 << attempt) - 1)
+            GenerateThreadLocalRandom() % (static_cast<uint64_t> (1) << std::min(attempt, 31U))
         );
 
         return timeSlot * k;
@@ -0,0 +1,122 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include "memory.h"
+#include <3fd/core/exceptions.h>
+
+#ifdef _3FD_HAS_STLOPTIMALLOC
+
+#include <algorithm>
+#include <cassert>
+
+#undef min
+#undef max
+
+namespace _3fd
+{
+namespace utils
+{
+    // the size of the buffer header, keeping the memory that follows it aligned
+    static const size_t bufferHeaderSize = alignof(std::max_align_t) > 16 ? alignof(std::max_align_t) : 16;
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="MonotonicArenaResource"/> class.
+    /// No memory is allocated before the first request.
+    /// </summary>
+    /// <param name="initialSize">The size of the first buffer. The next ones grow geometrically.</param>
+    /// <param name="upstream">The memory resource that provides the buffers.</param>
+    MonotonicArenaResource::MonotonicArenaResource(size_t initialSize, std::pmr::memory_resource *upstream)
+        : m_upstream(upstream)
+        , m_buffers(nullptr)
+        , m_current(0)
+        , m_end(0)
+        , m_nextBufferSize(std::max(initialSize, static_cast<size_t> (256)))
+    {
+        static_assert(sizeof(Buffer) <= bufferHeaderSize, "buffer header does not fit in the reserved space");
+        _ASSERTE(upstream != nullptr);
+    }
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="MonotonicArenaResource"/> class.
+    /// </summary>
+    MonotonicArenaResource::~MonotonicArenaResource()
+    {
+        while (m_buffers != nullptr)
+        {
+            auto next = m_buffers->next;
+            m_upstream->deallocate(m_buffers, m_buffers->size, alignof(std::max_align_t));
+            m_buffers = next;
+        }
+    }
+
+    /// <summary>
+    /// Gets a new buffer from upstream and makes it the current one.
+    /// </summary>
+    /// <param name="minSize">The minimum amount of usable bytes in the new buffer.</param>
+    void MonotonicArenaResource::AddBuffer(size_t minSize)
+    {
+        auto size = std::max(m_nextBufferSize, bufferHeaderSize + minSize);
+
+        void *mem;
+        try
+        {
+            mem = m_upstream->allocate(size, alignof(std::max_align_t));
+        }
+        catch (std::bad_alloc &)
+        {
+            throw core::AppException<std::runtime_error>("Failed to allocate memory for arena");
+        }
+
+        m_buffers = new (mem) Buffer{ m_buffers, size };
+        m_current = reinterpret_cast<uintptr_t> (mem) + bufferHeaderSize;
+        m_end = reinterpret_cast<uintptr_t> (mem) + size;
+        m_nextBufferSize = size * 2;
+    }
+
+    /// <summary>
+    /// Allocates memory by bumping the pointer in the current buffer.
+    /// </summary>
+    void * MonotonicArenaResource::do_allocate(size_t numBytes, size_t alignment)
+    {
+        auto addr = (m_current + alignment - 1) & ~(alignment - 1);
+
+        if (m_buffers == nullptr || addr + numBytes > m_end)
+        {
+            AddBuffer(numBytes + alignment);
+            addr = (m_current + alignment - 1) & ~(alignment - 1);
+        }
+
+        m_current = addr + numBytes;
+        return reinterpret_cast<void *> (addr);
+    }
+
+    /// <summary>
+    /// Releases at once all the memory allocated from the arena, but keeps its
+    /// largest buffer (the newest) for reuse. Objects allocated in the arena
+    /// must no longer be in use.
+    /// </summary>
+    void MonotonicArenaResource::Reset() noexcept
+    {
+        if (m_buffers == nullptr)
+            return;
+
+        auto older = m_buffers->next;
+        while (older != nullptr)
+        {
+            auto next = older->next;
+            m_upstream->deallocate(older, older->size, alignof(std::max_align_t));
+            older = next;
+        }
+
+        m_buffers->next = nullptr;
+        m_current = reinterpret_cast<uintptr_t> (m_buffers) + bufferHeaderSize;
+        m_end = reinterpret_cast<uintptr_t> (m_buffers) + m_buffers->size;
+    }
+
+} // end of namespace utils
+} // end of namespace _3fd
+
+#endif // _3FD_HAS_STLOPTIMALLOC
@@ -5,18 +5,19 @@
 //
 #include "pch.h"
 #include "concurrency.h"
+#include "threadpool.h"
 #include <3fd/core/exceptions.h>
 #include <3fd/core/logger.h>
 
 #include <sstream>
-#include <thread>
 
 namespace _3fd
 {
 namespace utils
 {
     /// <summary>
-    /// Invokes a callback asynchronously and leaves without waiting for termination.
+    /// Invokes a callback asynchronously (in the framework thread pool)
+    /// and leaves without waiting for termination.
     /// </summary>
     /// <param name="callback">The callback.</param>
     void Asynchronous::InvokeAndLeave(const std::function<void()> &callback)
@@ -25,44 +26,94 @@ namespace utils
 
         try
         {
-            // Launch asynchronous execution of callback and then a little housekeeping:
-            std::thread thread([callback]()
+            // Exceptions escaping the callback are logged by the pool:
+            ThreadPool::GetInstance().Submit(callback);
+        }
+        catch (core::IAppException &ex)
+        {
+            throw core::AppException<std::runtime_error>("Failed to start new asynchronous execution", ex);
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when starting new asynchronous execution: " << ex.what();
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+    /// <summary>
+    /// Subscribes a callback to be invoked upon completion of the operation.
+    /// If that has already happened, the callback is invoked right away.
+    /// </summary>
+    /// <param name="callback">The callback, which is invoked in the thread that
+    /// completes the operation, hence must be quick and not throw.</param>
+    void CompletionNotifier::Subscribe(const std::function<void()> &callback)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
             {
-                try
-                {
-                    callback(); // invoke the callback
-                }
-                catch (core::IAppException &ex)
-                {
-                    core::Logger::Write(ex, core::Logger::PRIO_ERROR);
-                }
-                catch (std::exception &ex)
-                {
-                    std::ostringstream oss;
-                    oss << "Generic failure when executing callback asynchronously: " << ex.what();
-                    core::Logger::Write(oss.str(), core::Logger::PRIO_ERROR);
-                }
-                catch (...)
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                if (!m_completed)
                 {
-                    std::ostringstream oss;
-                    oss << "Unexpected exception during asynchronous execution of callback";
-                    core::Logger::Write(oss.str(), core::Logger::PRIO_ERROR);
+                    m_callbacks.push_back(callback);
+                    return;
                 }
-            });
+            }
 
-            thread.detach();
+            callback();
         }
         catch (std::system_error &ex)
         {
             std::ostringstream oss;
-            oss << "System failure when starting new asynchronous execution: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            oss << "Failed to acquire lock when subscribing for completion: " << core::StdLibExt::GetDetailsFromSystemError(ex);
             throw core::AppException<std::runtime_error>(oss.str());
         }
-        catch (std::exception &ex)
+        catch (std::bad_alloc &)
+        {
+            throw core::AppException<std::runtime_error>("Failed to allocate memory when subscribing for completion");
+        }
+    }
+
+    /// <summary>
+    /// Signals completion of the operation, invoking the subscribed callbacks.
+    /// </summary>
+    void CompletionNotifier::Notify() noexcept
+    {
+        std::vector<std::function<void()>> callbacks;
+
+        try
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_completed = true;
+            callbacks.swap(m_callbacks);
+        }
+        catch (std::system_error &ex)
         {
             std::ostringstream oss;
-            oss << "Generic failure when starting new asynchronous execution: " << ex.what();
-            throw core::AppException<std::runtime_error>(oss.str());
+            oss << "Failed to acquire lock when notifying completion: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            core::Logger::Write(oss.str(), core::Logger::PRIO_CRITICAL);
+            return;
+        }
+
+        for (auto &callback : callbacks)
+        {
+            try
+            {
+                callback();
+            }
+            catch (core::IAppException &ex)
+            {
+                core::Logger::Write(ex, core::Logger::PRIO_ERROR);
+            }
+            catch (std::exception &ex)
+            {
+                std::ostringstream oss;
+                oss << "Generic failure when invoking callback for completion: " << ex.what();
+                core::Logger::Write(oss.str(), core::Logger::PRIO_ERROR);
+            }
         }
     }
 
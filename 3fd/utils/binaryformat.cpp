@@ -0,0 +1,153 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include "binaryformat.h"
+#include <3fd/core/exceptions.h>
+
+#include <cassert>
+#include <sstream>
+
+namespace _3fd
+{
+namespace utils
+{
+    /////////////////////////////
+    // BinaryWriter Class
+    /////////////////////////////
+
+    /// <summary>
+    /// Starts a record: the values written until <see cref="EndRecord"/> belong to it.
+    /// </summary>
+    void BinaryWriter::BeginRecord()
+    {
+        WriteType(BinaryType::Record);
+        m_openRecords.push_back(m_buffer.size());
+        m_buffer.insert(m_buffer.end(), sizeof(uint32_t), 0); // length is known only at the end
+    }
+
+    /// <summary>
+    /// Ends the record started last.
+    /// </summary>
+    void BinaryWriter::EndRecord()
+    {
+        _ASSERTE(!m_openRecords.empty()); // fires if no record has been started
+
+        auto lengthPos = m_openRecords.back();
+        m_openRecords.pop_back();
+
+        auto length = m_buffer.size() - lengthPos - sizeof(uint32_t);
+        if (length > UINT32_MAX)
+            throw core::AppException<std::length_error>("Failed to write record in binary format: it is too long!");
+
+        auto length32 = static_cast<uint32_t> (length);
+        memcpy(&m_buffer[lengthPos], &length32, sizeof length32);
+    }
+
+    /////////////////////////////
+    // BinaryReader Class
+    /////////////////////////////
+
+    void BinaryReader::ThrowUnexpectedType(BinaryType expected, BinaryType actual)
+    {
+        std::ostringstream oss;
+        oss << "Expected type " << static_cast<int> (expected) << ", but found " << static_cast<int> (actual);
+        throw core::AppException<std::runtime_error>("Failed to read binary data: unexpected type", oss.str());
+    }
+
+    void BinaryReader::ThrowTruncated()
+    {
+        throw core::AppException<std::runtime_error>("Failed to read binary data: it is truncated!");
+    }
+
+    /// <summary>
+    /// Reads a variable-length integer (LEB128).
+    /// </summary>
+    uint64_t BinaryReader::ReadVarUInt()
+    {
+        uint64_t value(0);
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            CheckAvailable(1);
+            uint8_t byte = *m_iter++;
+            value |= static_cast<uint64_t> (byte & 0x7F) << shift;
+
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+
+        throw core::AppException<std::runtime_error>("Failed to read binary data: integer is too long!");
+    }
+
+    bool BinaryReader::ReadBool()
+    {
+        auto type = PeekType();
+        if (type != BinaryType::True && type != BinaryType::False)
+            ThrowUnexpectedType(BinaryType::True, type);
+
+        ++m_iter;
+        return type == BinaryType::True;
+    }
+
+    /// <summary>
+    /// Reads a record.
+    /// </summary>
+    /// <returns>A reader for the values in the record, which refers to the original bytes.</returns>
+    BinaryReader BinaryReader::ReadRecord()
+    {
+        ReadType(BinaryType::Record);
+        CheckAvailable(sizeof(uint32_t));
+
+        uint32_t length;
+        memcpy(&length, m_iter, sizeof length);
+        m_iter += sizeof length;
+
+        CheckAvailable(length);
+        BinaryReader record(m_iter, length);
+        m_iter += length;
+        return record;
+    }
+
+    /// <summary>
+    /// Skips the next value (and the whole content of a record).
+    /// </summary>
+    void BinaryReader::Skip()
+    {
+        switch (PeekType())
+        {
+        case BinaryType::Null:
+        case BinaryType::False:
+        case BinaryType::True:
+            ++m_iter;
+            break;
+
+        case BinaryType::UInt:
+        case BinaryType::SInt:
+            ++m_iter;
+            ReadVarUInt();
+            break;
+
+        case BinaryType::Double:
+            ReadDouble();
+            break;
+
+        case BinaryType::String:
+        case BinaryType::Blob:
+            ReadLengthPrefixed(PeekType());
+            break;
+
+        case BinaryType::Record:
+            ReadRecord();
+            break;
+
+        default:
+            std::ostringstream oss;
+            oss << "Type " << static_cast<int> (*m_iter) << " is unknown";
+            throw core::AppException<std::runtime_error>("Failed to read binary data: unexpected type", oss.str());
+        }
+    }
+
+}// end of namespace utils
+}// end of namespace _3fd
@@ -0,0 +1,300 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#ifndef UTILS_BINARYFORMAT_H // header guard
+#define UTILS_BINARYFORMAT_H
+
+#include <cinttypes>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace _3fd
+{
+namespace utils
+{
+    /* A compact binary format without schema: every value starts with a byte that tells
+    its type, followed by the payload. Integers are encoded as variable-length integers
+    (LEB128, signed ones in zig-zag encoding), floating-point numbers take 8 bytes,
+    strings and blobs are prefixed by their length (as variable-length integer), and
+    records (a sequence of values, possibly nested) are prefixed by their length in
+    bytes (as 32-bit integer), so a reader can skip them without parsing. All numbers
+    are little-endian, as in all supported platforms. */
+
+    /// <summary>
+    /// The types of value in the binary format.
+    /// </summary>
+    enum class BinaryType : uint8_t
+    {
+        Null = 0,
+        False,
+        True,
+        UInt, // unsigned variable-length integer
+        SInt, // signed variable-length integer (zig-zag)
+        Double,
+        String, // UTF-8
+        Blob,
+        Record
+    };
+
+    /// <summary>
+    /// Refers to a sequence of bytes without taking ownership.
+    /// </summary>
+    struct BinaryBlob
+    {
+        const uint8_t *data;
+        size_t size;
+    };
+
+    /// <summary>
+    /// Writes values in binary format, appending them to a buffer that can be reused.
+    /// </summary>
+    class BinaryWriter
+    {
+    private:
+
+        std::vector<uint8_t> m_buffer;
+
+        // positions where the length of the open records has to be written
+        std::vector<size_t> m_openRecords;
+
+        void WriteType(BinaryType type)
+        {
+            m_buffer.push_back(static_cast<uint8_t> (type));
+        }
+
+        void WriteVarUInt(uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                m_buffer.push_back(static_cast<uint8_t> (value | 0x80));
+                value >>= 7;
+            }
+
+            m_buffer.push_back(static_cast<uint8_t> (value));
+        }
+
+        void WriteBytes(const void *data, size_t size)
+        {
+            auto bytes = static_cast<const uint8_t *> (data);
+            m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+        }
+
+    public:
+
+        BinaryWriter() = default;
+
+        BinaryWriter(const BinaryWriter &) = delete;
+
+        /// <summary>
+        /// Gets the bytes written so far.
+        /// </summary>
+        BinaryBlob GetBytes() const noexcept
+        {
+            return BinaryBlob{ m_buffer.data(), m_buffer.size() };
+        }
+
+        /// <summary>
+        /// Discards the bytes written so far, but keeps the memory for reuse.
+        /// </summary>
+        void Clear() noexcept
+        {
+            m_buffer.clear();
+            m_openRecords.clear();
+        }
+
+        void WriteNull()
+        {
+            WriteType(BinaryType::Null);
+        }
+
+        void Write(bool value)
+        {
+            WriteType(value ? BinaryType::True : BinaryType::False);
+        }
+
+        /// <summary>
+        /// Writes an integer (of any size).
+        /// </summary>
+        template <typename IntType>
+        typename std::enable_if<std::is_integral<IntType>::value>::type Write(IntType value)
+        {
+            if constexpr (std::is_signed<IntType>::value)
+            {
+                WriteType(BinaryType::SInt);
+                auto wide = static_cast<int64_t> (value);
+                WriteVarUInt((static_cast<uint64_t> (wide) << 1) ^ static_cast<uint64_t> (wide >> 63));
+            }
+            else
+            {
+                WriteType(BinaryType::UInt);
+                WriteVarUInt(value);
+            }
+        }
+
+        void Write(double value)
+        {
+            WriteType(BinaryType::Double);
+            WriteBytes(&value, sizeof value);
+        }
+
+        void Write(std::string_view value)
+        {
+            WriteType(BinaryType::String);
+            WriteVarUInt(value.size());
+            WriteBytes(value.data(), value.size());
+        }
+
+        void Write(const char *value)
+        {
+            Write(std::string_view(value));
+        }
+
+        void WriteBlob(const void *data, size_t size)
+        {
+            WriteType(BinaryType::Blob);
+            WriteVarUInt(size);
+            WriteBytes(data, size);
+        }
+
+        void BeginRecord();
+
+        void EndRecord();
+    };
+
+    /// <summary>
+    /// Reads values in binary format, without copying strings and blobs:
+    /// they refer to the original bytes, which must outlive them.
+    /// </summary>
+    class BinaryReader
+    {
+    private:
+
+        const uint8_t *m_iter;
+        const uint8_t *m_end;
+
+        [[noreturn]] static void ThrowUnexpectedType(BinaryType expected, BinaryType actual);
+
+        [[noreturn]] static void ThrowTruncated();
+
+        void CheckAvailable(size_t size) const
+        {
+            if (static_cast<size_t> (m_end - m_iter) < size)
+                ThrowTruncated();
+        }
+
+        void ReadType(BinaryType expected)
+        {
+            CheckAvailable(1);
+            auto actual = static_cast<BinaryType> (*m_iter);
+            if (actual != expected)
+                ThrowUnexpectedType(expected, actual);
+            ++m_iter;
+        }
+
+        uint64_t ReadVarUInt();
+
+        BinaryBlob ReadLengthPrefixed(BinaryType type)
+        {
+            ReadType(type);
+            auto size = ReadVarUInt();
+            CheckAvailable(size);
+            BinaryBlob blob{ m_iter, static_cast<size_t> (size) };
+            m_iter += size;
+            return blob;
+        }
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="BinaryReader"/> class.
+        /// </summary>
+        /// <param name="data">The bytes to read, which must outlive the reader.</param>
+        /// <param name="size">How many bytes to read.</param>
+        BinaryReader(const void *data, size_t size) noexcept
+            : m_iter(static_cast<const uint8_t *> (data))
+            , m_end(m_iter + size)
+        {
+        }
+
+        explicit BinaryReader(BinaryBlob blob) noexcept
+            : BinaryReader(blob.data, blob.size)
+        {
+        }
+
+        /// <summary>
+        /// Tells whether all values have been read.
+        /// </summary>
+        bool AtEnd() const noexcept
+        {
+            return m_iter == m_end;
+        }
+
+        /// <summary>
+        /// Gets the type of the next value, without reading it.
+        /// </summary>
+        BinaryType PeekType() const
+        {
+            CheckAvailable(1);
+            return static_cast<BinaryType> (*m_iter);
+        }
+
+        void ReadNull()
+        {
+            ReadType(BinaryType::Null);
+        }
+
+        bool ReadBool();
+
+        uint64_t ReadUInt()
+        {
+            ReadType(BinaryType::UInt);
+            return ReadVarUInt();
+        }
+
+        int64_t ReadInt()
+        {
+            ReadType(BinaryType::SInt);
+            auto zigzag = ReadVarUInt();
+            return static_cast<int64_t> (zigzag >> 1) ^ -static_cast<int64_t> (zigzag & 1);
+        }
+
+        double ReadDouble()
+        {
+            ReadType(BinaryType::Double);
+            CheckAvailable(sizeof(double));
+            double value;
+            memcpy(&value, m_iter, sizeof value);
+            m_iter += sizeof value;
+            return value;
+        }
+
+        /// <summary>
+        /// Reads a string, which refers to the original bytes.
+        /// </summary>
+        std::string_view ReadString()
+        {
+            auto blob = ReadLengthPrefixed(BinaryType::String);
+            return std::string_view(reinterpret_cast<const char *> (blob.data), blob.size);
+        }
+
+        /// <summary>
+        /// Reads a blob, which refers to the original bytes.
+        /// </summary>
+        BinaryBlob ReadBlob()
+        {
+            return ReadLengthPrefixed(BinaryType::Blob);
+        }
+
+        BinaryReader ReadRecord();
+
+        void Skip();
+    };
+
+}// end of namespace utils
+}// end of namespace _3fd
+
+#endif // end of header guard
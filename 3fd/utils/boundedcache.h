@@ -0,0 +1,657 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#ifndef UTILS_BOUNDEDCACHE_H // header guard
+#define UTILS_BOUNDEDCACHE_H
+
+#include <3fd/utils/concurrency.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#   include <time.h>
+#endif
+
+namespace _3fd
+{
+namespace utils
+{
+    /// <summary>
+    /// A clock that is cheap to read, at the cost of a resolution
+    /// in the order of milliseconds. Good enough for expiration of cache entries.
+    /// </summary>
+    struct CoarseClock
+    {
+        /// <summary>
+        /// Gets the time elapsed since an arbitrary (but fixed) point in the past.
+        /// </summary>
+        /// <returns>The time in milliseconds.</returns>
+        static int64_t NowMillis() noexcept
+        {
+#   ifdef _WIN32
+            return static_cast<int64_t> (GetTickCount64());
+#   elif defined CLOCK_MONOTONIC_COARSE
+            timespec now;
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+            return static_cast<int64_t> (now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+#   else
+            using namespace std::chrono;
+            return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+#   endif
+        }
+    };
+
+    /// <summary>
+    /// Probabilistic counter of how often keys have been seen recently (count-min sketch),
+    /// which ages by halving all counters once many accesses have been sampled.
+    /// </summary>
+    class FrequencySketch
+    {
+    private:
+
+        static const uint32_t numRows = 4;
+        static const uint8_t maxCount = 15;
+
+        std::vector<uint8_t> m_counters;
+        uint64_t m_widthMask;
+        uint64_t m_numSamples;
+        uint64_t m_sampleSize;
+
+        size_t GetIndex(uint64_t hash, uint32_t row) const noexcept
+        {
+            // derive a different hash for each row:
+            hash = (hash + row) * (0x9E3779B97F4A7C15ULL ^ (static_cast<uint64_t> (row) << 32));
+            return row * (m_widthMask + 1) + ((hash >> 32) & m_widthMask);
+        }
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="FrequencySketch"/> class.
+        /// </summary>
+        /// <param name="capacity">The amount of entries in the cache.</param>
+        explicit FrequencySketch(size_t capacity)
+            : m_numSamples(0)
+        {
+            uint64_t width(16);
+            while (width < capacity)
+                width <<= 1;
+
+            m_counters.resize(numRows * width, 0);
+            m_widthMask = width - 1;
+            m_sampleSize = 10 * width;
+        }
+
+        /// <summary>
+        /// Records an access to a key.
+        /// </summary>
+        /// <param name="hash">The hash of the key.</param>
+        void Increment(uint64_t hash) noexcept
+        {
+            for (uint32_t row = 0; row < numRows; ++row)
+            {
+                auto &counter = m_counters[GetIndex(hash, row)];
+                if (counter < maxCount)
+                    ++counter;
+            }
+
+            if (++m_numSamples == m_sampleSize)
+            {
+                for (auto &counter : m_counters)
+                    counter >>= 1;
+
+                m_numSamples /= 2;
+            }
+        }
+
+        /// <summary>
+        /// Estimates how often a key has been accessed recently.
+        /// </summary>
+        /// <param name="hash">The hash of the key.</param>
+        uint8_t Estimate(uint64_t hash) const noexcept
+        {
+            uint8_t estimate(maxCount);
+            for (uint32_t row = 0; row < numRows; ++row)
+                estimate = std::min(estimate, m_counters[GetIndex(hash, row)]);
+
+            return estimate;
+        }
+    };
+
+    /// <summary>
+    /// The policy for eviction of entries from <see cref="BoundedCache"/>.
+    /// </summary>
+    enum class EvictionPolicy : uint8_t
+    {
+        /// <summary>Evicts the least recently used entry.</summary>
+        LRU,
+
+        /// <summary>
+        /// Segmented LRU: new entries are probationary, and only move to the protected segment
+        /// (80% of the capacity) when used again. A scan of many keys used only once cannot
+        /// flush the protected entries.
+        /// </summary>
+        SegmentedLRU,
+
+        /// <summary>
+        /// Segmented LRU with admission by frequency: when the cache is full, a new entry
+        /// only displaces the eviction candidate if its key has been requested more often.
+        /// </summary>
+        TinyLFU
+    };
+
+    /// <summary>
+    /// Options for <see cref="BoundedCache"/>.
+    /// </summary>
+    struct BoundedCacheOptions
+    {
+        size_t maxNumEntries = 1024; // zero means no limit
+        size_t maxNumBytes = 0; // zero means no limit, otherwise requires a weigher
+        std::chrono::milliseconds timeToLive = std::chrono::milliseconds(0); // zero means no expiration
+        EvictionPolicy evictionPolicy = EvictionPolicy::SegmentedLRU;
+        uint32_t numShards = 8;
+    };
+
+    /// <summary>
+    /// Counters of <see cref="BoundedCache"/>.
+    /// </summary>
+    struct BoundedCacheStats
+    {
+        uint64_t numHits = 0;
+        uint64_t numMisses = 0;
+        uint64_t numLoads = 0; // invocations of the loader
+        uint64_t numCoalescedLoads = 0; // misses that awaited the load started by another
+        uint64_t numEvictions = 0;
+        uint64_t numExpirations = 0;
+        uint64_t numRejections = 0; // new entries not admitted by TinyLFU
+
+        double GetHitRatio() const noexcept
+        {
+            return numHits + numMisses > 0 ? static_cast<double> (numHits) / (numHits + numMisses) : 0.0;
+        }
+    };
+
+    /// <summary>
+    /// A concurrent cache bounded in amount of entries and/or bytes, with selectable
+    /// policy of eviction and optional expiration of entries. Values missing in cache are
+    /// produced by a loader, and concurrent misses for the same key run the loader only once.
+    /// The cache is split in shards (selected by hash of the key) with independent locks,
+    /// and the bounds apply to every shard proportionally.
+    /// </summary>
+    template <typename KeyType, typename ValueType>
+    class BoundedCache
+    {
+    public:
+
+        typedef std::function<ValueType (const KeyType &)> Loader;
+
+        typedef std::function<size_t (const KeyType &, const ValueType &)> Weigher;
+
+    private:
+
+        enum class Segment : uint8_t { Probation, Protected };
+
+        struct Entry
+        {
+            KeyType key;
+            ValueType value;
+            int64_t expiryTime; // zero when it never expires
+            size_t weight;
+            Segment segment;
+        };
+
+        typedef std::list<Entry> EntryList;
+
+        // a load in progress
+        struct Loading
+        {
+            std::shared_future<ValueType> future;
+            bool superseded; // by a put or an invalidation, so the loaded value is not cached
+        };
+
+        struct alignas(cacheLineSize) Shard
+        {
+            std::mutex mutex;
+            std::unordered_map<KeyType, typename EntryList::iterator> index;
+            std::unordered_map<KeyType, Loading> loading;
+
+            EntryList probation; // the only segment in use by plain LRU
+            EntryList protectedEntries;
+            size_t weightProbation = 0;
+            size_t weightProtected = 0;
+
+            std::unique_ptr<FrequencySketch> sketch; // only for TinyLFU
+
+            BoundedCacheStats stats;
+        };
+
+        const BoundedCacheOptions m_options;
+        const Loader m_loader;
+        const Weigher m_weigher;
+
+        // bounds per shard (zero means no limit):
+        size_t m_maxEntriesPerShard;
+        size_t m_maxBytesPerShard;
+
+        std::unique_ptr<Shard[]> m_shards;
+
+        static uint64_t GetHash(const KeyType &key)
+        {
+            // mix the bits, because some hashes (as for integers) are identity:
+            return static_cast<uint64_t> (std::hash<KeyType>()(key)) * 0x9E3779B97F4A7C15ULL;
+        }
+
+        Shard &GetShard(uint64_t hash) const noexcept
+        {
+            return m_shards[(hash >> 32) % m_options.numShards];
+        }
+
+        bool IsSegmented() const noexcept
+        {
+            return m_options.evictionPolicy != EvictionPolicy::LRU;
+        }
+
+        bool IsOverBounds(size_t numEntries, size_t numBytes, double fraction) const noexcept
+        {
+            return (m_maxEntriesPerShard > 0 && numEntries > m_maxEntriesPerShard * fraction)
+                || (m_maxBytesPerShard > 0 && numBytes > m_maxBytesPerShard * fraction);
+        }
+
+        // gets the entry to evict next, or a null pointer if empty
+        static Entry *GetEvictionCandidate(Shard &shard) noexcept
+        {
+            if (!shard.probation.empty())
+                return &shard.probation.back();
+            else if (!shard.protectedEntries.empty())
+                return &shard.protectedEntries.back();
+            else
+                return nullptr;
+        }
+
+        static void Remove(Shard &shard, typename EntryList::iterator iter)
+        {
+            if (iter->segment == Segment::Probation)
+            {
+                shard.weightProbation -= iter->weight;
+                shard.index.erase(iter->key);
+                shard.probation.erase(iter);
+            }
+            else
+            {
+                shard.weightProtected -= iter->weight;
+                shard.index.erase(iter->key);
+                shard.protectedEntries.erase(iter);
+            }
+        }
+
+        // promotes an entry upon a hit
+        void Touch(Shard &shard, typename EntryList::iterator iter)
+        {
+            if (!IsSegmented())
+            {
+                shard.probation.splice(shard.probation.begin(), shard.probation, iter);
+                return;
+            }
+
+            if (iter->segment == Segment::Protected)
+            {
+                shard.protectedEntries.splice(shard.protectedEntries.begin(), shard.protectedEntries, iter);
+                return;
+            }
+
+            // move from probation to the protected segment:
+            iter->segment = Segment::Protected;
+            shard.weightProbation -= iter->weight;
+            shard.weightProtected += iter->weight;
+            shard.protectedEntries.splice(shard.protectedEntries.begin(), shard.probation, iter);
+
+            // demote to probation the excess of the protected segment:
+            while (shard.protectedEntries.size() > 1
+                   && IsOverBounds(shard.protectedEntries.size(), shard.weightProtected, 0.8))
+            {
+                auto demoted = std::prev(shard.protectedEntries.end());
+                demoted->segment = Segment::Probation;
+                shard.weightProtected -= demoted->weight;
+                shard.weightProbation += demoted->weight;
+                shard.probation.splice(shard.probation.begin(), shard.protectedEntries, demoted);
+            }
+        }
+
+        // inserts a new entry (whose key is not in the shard) and evicts the excess
+        void Insert(Shard &shard, uint64_t hash, const KeyType &key, const ValueType &value)
+        {
+            auto weight = m_weigher ? m_weigher(key, value) : 1;
+
+            // an entry that alone exceeds the bounds is never admitted:
+            if (IsOverBounds(1, weight, 1.0))
+            {
+                ++shard.stats.numRejections;
+                return;
+            }
+
+            auto numEntries = shard.index.size() + 1;
+            auto numBytes = shard.weightProbation + shard.weightProtected + weight;
+
+            // with TinyLFU, admit only if more frequent than the eviction candidate:
+            if (m_options.evictionPolicy == EvictionPolicy::TinyLFU && IsOverBounds(numEntries, numBytes, 1.0))
+            {
+                auto candidate = GetEvictionCandidate(shard);
+                if (candidate != nullptr
+                    && shard.sketch->Estimate(hash) <= shard.sketch->Estimate(GetHash(candidate->key)))
+                {
+                    ++shard.stats.numRejections;
+                    return;
+                }
+            }
+
+            int64_t expiryTime = 0;
+            if (m_options.timeToLive.count() > 0)
+                expiryTime = CoarseClock::NowMillis() + m_options.timeToLive.count();
+
+            shard.probation.push_front(Entry{ key, value, expiryTime, weight, Segment::Probation });
+            shard.weightProbation += weight;
+            shard.index.emplace(key, shard.probation.begin());
+
+            while (IsOverBounds(shard.index.size(), shard.weightProbation + shard.weightProtected, 1.0))
+            {
+                auto candidate = GetEvictionCandidate(shard);
+                auto &list = (candidate->segment == Segment::Probation) ? shard.probation : shard.protectedEntries;
+                Remove(shard, std::prev(list.end()));
+                ++shard.stats.numEvictions;
+            }
+        }
+
+        // looks up an entry alive in cache (must be called within the lock of the shard)
+        bool Lookup(Shard &shard, const KeyType &key, ValueType &value)
+        {
+            auto iter = shard.index.find(key);
+            if (iter == shard.index.end())
+                return false;
+
+            auto entryIter = iter->second;
+            if (entryIter->expiryTime != 0 && entryIter->expiryTime <= CoarseClock::NowMillis())
+            {
+                Remove(shard, entryIter);
+                ++shard.stats.numExpirations;
+                return false;
+            }
+
+            Touch(shard, entryIter);
+            value = entryIter->value;
+            return true;
+        }
+
+        // keeps a load in progress from caching a value older than the current state (must be called within the lock of the shard)
+        static void SupersedeLoading(Shard &shard, const KeyType &key)
+        {
+            auto iter = shard.loading.find(key);
+            if (iter != shard.loading.end())
+                iter->second.superseded = true;
+        }
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="BoundedCache"/> class.
+        /// </summary>
+        /// <param name="options">The options.</param>
+        /// <param name="loader">Produces the values missing in cache. Exceptions
+        /// are forwarded to all the callers awaiting the value.</param>
+        /// <param name="weigher">Tells the size in bytes of an entry. Required to
+        /// bound the cache in bytes.</param>
+        BoundedCache(const BoundedCacheOptions &options,
+                     const Loader &loader,
+                     const Weigher &weigher = Weigher())
+            : m_options(options)
+            , m_loader(loader)
+            , m_weigher(weigher)
+            , m_maxEntriesPerShard(0)
+            , m_maxBytesPerShard(0)
+        {
+            _ASSERTE(options.numShards > 0);
+            _ASSERTE(options.maxNumBytes == 0 || weigher); // bounds in bytes require a weigher
+
+            if (options.maxNumEntries > 0)
+                m_maxEntriesPerShard = (options.maxNumEntries + options.numShards - 1) / options.numShards;
+
+            if (options.maxNumBytes > 0)
+                m_maxBytesPerShard = (options.maxNumBytes + options.numShards - 1) / options.numShards;
+
+            m_shards.reset(dbg_new Shard[options.numShards]);
+
+            if (options.evictionPolicy == EvictionPolicy::TinyLFU)
+            {
+                for (uint32_t idx = 0; idx < options.numShards; ++idx)
+                {
+                    m_shards[idx].sketch.reset(
+                        dbg_new FrequencySketch(m_maxEntriesPerShard > 0 ? m_maxEntriesPerShard : 1024)
+                    );
+                }
+            }
+        }
+
+        BoundedCache(const BoundedCache &) = delete;
+
+        /// <summary>
+        /// Gets a value from cache, or loads it when missing.
+        /// </summary>
+        /// <param name="key">The key.</param>
+        /// <returns>The cached value.</returns>
+        ValueType Get(const KeyType &key)
+        {
+            auto hash = GetHash(key);
+            auto &shard = GetShard(hash);
+
+            std::promise<ValueType> promise;
+            std::shared_future<ValueType> future;
+            bool mustLoad(false);
+
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+
+                if (shard.sketch)
+                    shard.sketch->Increment(hash);
+
+                ValueType value;
+                if (Lookup(shard, key, value))
+                {
+                    ++shard.stats.numHits;
+                    return value;
+                }
+
+                ++shard.stats.numMisses;
+
+                // coalesce with a load already in progress:
+                auto iter = shard.loading.find(key);
+                if (iter != shard.loading.end())
+                {
+                    future = iter->second.future;
+                    ++shard.stats.numCoalescedLoads;
+                }
+                else
+                {
+                    future = promise.get_future().share();
+                    shard.loading.emplace(key, Loading{ future, false });
+                    ++shard.stats.numLoads;
+                    mustLoad = true;
+                }
+            }
+
+            if (!mustLoad)
+                return future.get();
+
+            try
+            {
+                ValueType value = m_loader(key);
+
+                {
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+
+                    // a put or an invalidation during the load is newer than the loaded value:
+                    auto loadingIter = shard.loading.find(key);
+                    bool superseded = loadingIter->second.superseded;
+                    shard.loading.erase(loadingIter);
+
+                    if (!superseded)
+                    {
+                        auto iter = shard.index.find(key);
+                        if (iter != shard.index.end())
+                            Remove(shard, iter->second);
+
+                        Insert(shard, hash, key, value);
+                    }
+                }
+
+                promise.set_value(value);
+                return value;
+            }
+            catch (...)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    shard.loading.erase(key);
+                }
+
+                promise.set_exception(std::current_exception());
+                throw;
+            }
+        }
+
+        /// <summary>
+        /// Gets a value from cache, without loading it when missing.
+        /// </summary>
+        /// <param name="key">The key.</param>
+        /// <param name="value">Receives the cached value.</param>
+        /// <returns>Whether the value was found in cache.</returns>
+        bool TryGet(const KeyType &key, ValueType &value)
+        {
+            auto hash = GetHash(key);
+            auto &shard = GetShard(hash);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            if (shard.sketch)
+                shard.sketch->Increment(hash);
+
+            bool found = Lookup(shard, key, value);
+            ++(found ? shard.stats.numHits : shard.stats.numMisses);
+            return found;
+        }
+
+        /// <summary>
+        /// Puts a value in cache, replacing any previous one for the same key.
+        /// </summary>
+        /// <param name="key">The key.</param>
+        /// <param name="value">The value.</param>
+        void Put(const KeyType &key, const ValueType &value)
+        {
+            auto hash = GetHash(key);
+            auto &shard = GetShard(hash);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            if (shard.sketch)
+                shard.sketch->Increment(hash);
+
+            SupersedeLoading(shard, key);
+
+            auto iter = shard.index.find(key);
+            if (iter != shard.index.end())
+                Remove(shard, iter->second);
+
+            Insert(shard, hash, key, value);
+        }
+
+        /// <summary>
+        /// Removes an entry from cache.
+        /// </summary>
+        /// <param name="key">The key.</param>
+        /// <returns>Whether the entry was found in cache.</returns>
+        bool Invalidate(const KeyType &key)
+        {
+            auto &shard = GetShard(GetHash(key));
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            SupersedeLoading(shard, key);
+
+            auto iter = shard.index.find(key);
+            if (iter == shard.index.end())
+                return false;
+
+            Remove(shard, iter->second);
+            return true;
+        }
+
+        /// <summary>
+        /// Removes all entries from cache.
+        /// </summary>
+        void Clear()
+        {
+            for (uint32_t idx = 0; idx < m_options.numShards; ++idx)
+            {
+                auto &shard = m_shards[idx];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+
+                for (auto &pair : shard.loading)
+                    pair.second.superseded = true;
+
+                shard.index.clear();
+                shard.probation.clear();
+                shard.protectedEntries.clear();
+                shard.weightProbation = shard.weightProtected = 0;
+            }
+        }
+
+        /// <summary>
+        /// Counts the entries in cache, including the expired ones not yet removed.
+        /// </summary>
+        size_t GetNumEntries()
+        {
+            size_t count(0);
+            for (uint32_t idx = 0; idx < m_options.numShards; ++idx)
+            {
+                auto &shard = m_shards[idx];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                count += shard.index.size();
+            }
+
+            return count;
+        }
+
+        /// <summary>
+        /// Gets the counters of the cache.
+        /// </summary>
+        BoundedCacheStats GetStats()
+        {
+            BoundedCacheStats total;
+            for (uint32_t idx = 0; idx < m_options.numShards; ++idx)
+            {
+                auto &shard = m_shards[idx];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                total.numHits += shard.stats.numHits;
+                total.numMisses += shard.stats.numMisses;
+                total.numLoads += shard.stats.numLoads;
+                total.numCoalescedLoads += shard.stats.numCoalescedLoads;
+                total.numEvictions += shard.stats.numEvictions;
+                total.numExpirations += shard.stats.numExpirations;
+                total.numRejections += shard.stats.numRejections;
+            }
+
+            return total;
+        }
+    };
+
+}// end of namespace utils
+}// end of namespace _3fd
+
+#endif // end of header guard
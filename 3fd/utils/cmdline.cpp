@@ -1158,7 +1158,7 @@ namespace core
     /// <param name="ch">Receives the parsed character that labels the option.</param>
     /// <param name="value">Receives the parsed value (as string) for the option.</param>
     /// <returns>Whether the argument was successfully parsed.</returns>
-    static bool PreParseArgument(char *argument,
+    static bool PreParseArgument(const char *argument,
                                  CommandLineArguments::ArgOptionSign optionSign,
                                  CommandLineArguments::ArgValSeparator valSeparator,
                                  char &ch,
@@ -1189,14 +1189,9 @@ namespace core
 
         if (sscanf(argument, format, &ch, &count) > 0 && argument[count] == 0)
         {
-            char *ctx;
-            const char *token;
-            const char delimiter[2] = { static_cast<char>(valSeparator), '\0' };
-            token = strtok_x(argument, delimiter, &ctx);
-            _ASSERTE(token != nullptr);
-            token = strtok_x(nullptr, delimiter, &ctx);
-            _ASSERTE(token != nullptr);
-            *value = token;
+            // the value is the rest of the argument after the label:
+            auto pieces = utils::split(std::string_view(argument), static_cast<char>(valSeparator)).begin();
+            *value = (++pieces).rest().data;
             return true;
         }
 
@@ -1213,13 +1208,13 @@ namespace core
     /// <param name="label">Receives the parsed name label for the option.</param>
     /// <param name="value">Receives the parsed value (as string) for the option.</param>
     /// <returns>Whether the argument was successfully parsed.</returns>
-    static bool PreParseArgument(char *argument,
+    static bool PreParseArgument(const char *argument,
                                  CommandLineArguments::ArgOptionSign optionSign,
                                  CommandLineArguments::ArgValSeparator valSeparator,
-                                 const char **label,
+                                 std::string_view *label,
                                  const char **value)
     {
-        *label = nullptr;
+        *label = std::string_view();
         *value = nullptr;
 
         int count(0);
@@ -1240,7 +1235,7 @@ namespace core
 
         if (sscanf(argument, format, &count) == 0 && argument[count] == 0)
         {
-            *label = argument + skip;
+            *label = std::string_view(argument + skip);
             matchesSwitch = true;
         }
         else
@@ -1268,12 +1263,11 @@ namespace core
 
         if (sscanf(argument, format, &count) == 0 && argument[count] == 0)
         {
-            char *ctx;
-            const char delimiter[2] = { static_cast<char>(valSeparator), '\0' };
-            *label = strtok_x(argument + skip, delimiter, &ctx);
-            _ASSERTE(*label != nullptr);
-            *value = strtok_x(nullptr, delimiter, &ctx);
-            _ASSERTE(*value != nullptr);
+            // the label is the first piece, and the value is the rest of the argument:
+            auto pieces = utils::split(std::string_view(argument + skip), static_cast<char>(valSeparator)).begin();
+            auto labelPiece = *pieces;
+            *label = std::string_view(labelPiece.data, labelPiece.lenBytes);
+            *value = (++pieces).rest().data;
             return true;
         }
 
@@ -1312,7 +1306,7 @@ namespace core
                 char *arg = arguments[idx];
                 uint16_t argId;
                 const char *optValue;
-                const char *optName;
+                std::string_view optName;
                 char optChar;
 
                 // does the argument looks like an option with single char label?
@@ -1333,7 +1327,7 @@ namespace core
                 else if (PreParseArgument(arg, m_optionSign, m_argValSeparator, &optName, &optValue))
                 {
                     auto iter = m_argsByNameLabel.find(
-                        m_isOptCaseSensitive ? std::string(optName) : utils::to_lower(optName)
+                        m_isOptCaseSensitive ? std::string(optName) : utils::to_lower(std::string(optName))
                     );
                     if (m_argsByNameLabel.end() == iter)
                     {
@@ -0,0 +1,387 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include "memory.h"
+#include <3fd/core/exceptions.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <sstream>
+
+namespace _3fd
+{
+namespace utils
+{
+    /// <summary>
+    /// A fixed capacity stack of free blocks.
+    /// </summary>
+    struct Magazine
+    {
+        static const uint32_t capacity = 64;
+
+        uint32_t numRounds;
+        std::array<void *, capacity> rounds;
+
+        Magazine() noexcept
+            : numRounds(0) {}
+
+        bool IsEmpty() const noexcept { return numRounds == 0; }
+
+        bool IsFull() const noexcept { return numRounds == capacity; }
+
+        void *Pop() noexcept { return rounds[--numRounds]; }
+
+        void Push(void *block) noexcept { rounds[numRounds++] = block; }
+    };
+
+    /// <summary>
+    /// The state shared by all threads using a <see cref="ConcurrentDynamicMemPool"/>: the
+    /// backing (single-threaded) pool and the magazines not in use by any thread.
+    /// </summary>
+    struct ConcurrentDynamicMemPool::Depot
+    {
+        std::mutex mutex;
+        DynamicMemPool backingPool;
+        std::vector<Magazine *> fullMagazines;
+        std::vector<Magazine *> emptyMagazines;
+
+        // set when the owner pool object is gone, so the thread caches let it go
+        std::atomic<bool> retired;
+
+        Depot(uint16_t initialSize, uint16_t blockSize, float growingFactor)
+            : backingPool(initialSize, blockSize, growingFactor)
+            , retired(false)
+        {
+        }
+
+        Depot(const Depot &) = delete;
+
+        ~Depot()
+        {
+            ReleaseMagazines(fullMagazines);
+            ReleaseMagazines(emptyMagazines);
+        }
+
+        /// <summary>
+        /// Returns the blocks in a magazine to the backing pool.
+        /// (The lock must be held by the caller.)
+        /// </summary>
+        void Drain(Magazine &magazine)
+        {
+            while (!magazine.IsEmpty())
+                backingPool.ReturnBlock(magazine.Pop());
+        }
+
+        /// <summary>
+        /// Drains and deletes magazines. (The lock must be held by the caller.)
+        /// </summary>
+        void ReleaseMagazines(std::vector<Magazine *> &magazines)
+        {
+            for (auto magazine : magazines)
+            {
+                Drain(*magazine);
+                delete magazine;
+            }
+
+            magazines.clear();
+        }
+
+        /// <summary>
+        /// Gets an empty magazine from the depot, or a new one.
+        /// (The lock must be held by the caller.)
+        /// </summary>
+        Magazine *TakeEmptyMagazine()
+        {
+            if (emptyMagazines.empty())
+                return dbg_new Magazine();
+
+            auto magazine = emptyMagazines.back();
+            emptyMagazines.pop_back();
+            return magazine;
+        }
+    };
+
+    /// <summary>
+    /// The cache of free blocks kept by a thread for a given pool.
+    /// </summary>
+    class ThreadCache
+    {
+    private:
+
+        std::shared_ptr<ConcurrentDynamicMemPool::Depot> m_depot;
+        std::unique_ptr<Magazine> m_loaded;
+        std::unique_ptr<Magazine> m_previous;
+
+    public:
+
+        explicit ThreadCache(const std::shared_ptr<ConcurrentDynamicMemPool::Depot> &depot)
+            : m_depot(depot)
+            , m_loaded(dbg_new Magazine())
+            , m_previous(dbg_new Magazine())
+        {
+        }
+
+        ThreadCache(const ThreadCache &) = delete;
+
+        /// <summary>
+        /// Finalizes an instance of the <see cref="ThreadCache"/> class.
+        /// The remaining free blocks go back to the depot.
+        /// </summary>
+        ~ThreadCache()
+        {
+            std::lock_guard<std::mutex> lock(m_depot->mutex);
+            m_depot->Drain(*m_loaded);
+            m_depot->Drain(*m_previous);
+        }
+
+        ConcurrentDynamicMemPool::Depot *GetDepot() const noexcept { return m_depot.get(); }
+
+        /// <summary>
+        /// Gets a free block, preferably without synchronization.
+        /// </summary>
+        void *GetFreeBlock()
+        {
+            if (!m_loaded->IsEmpty())
+                return m_loaded->Pop();
+
+            if (!m_previous->IsEmpty())
+            {
+                m_loaded.swap(m_previous);
+                return m_loaded->Pop();
+            }
+
+            // both magazines are empty, so resort to the depot:
+
+            std::lock_guard<std::mutex> lock(m_depot->mutex);
+
+            if (!m_depot->fullMagazines.empty())
+            {
+                auto fullMagazine = m_depot->fullMagazines.back();
+                m_depot->emptyMagazines.push_back(m_previous.get());
+                m_previous.release();
+                m_depot->fullMagazines.pop_back();
+                m_previous.swap(m_loaded);
+                m_loaded.reset(fullMagazine);
+            }
+            else
+            {// no full magazines in the depot, so take half a magazine from the backing pool:
+                while (m_loaded->numRounds < Magazine::capacity / 2)
+                    m_loaded->Push(m_depot->backingPool.GetFreeBlock());
+            }
+
+            return m_loaded->Pop();
+        }
+
+        /// <summary>
+        /// Returns a block, preferably without synchronization.
+        /// </summary>
+        void ReturnBlock(void *block)
+        {
+            if (!m_loaded->IsFull())
+            {
+                m_loaded->Push(block);
+                return;
+            }
+
+            if (!m_previous->IsFull())
+            {
+                m_loaded.swap(m_previous);
+                m_loaded->Push(block);
+                return;
+            }
+
+            // both magazines are full, so hand one of them to the depot:
+
+            std::lock_guard<std::mutex> lock(m_depot->mutex);
+
+            std::unique_ptr<Magazine> emptyMagazine(m_depot->TakeEmptyMagazine());
+            m_depot->fullMagazines.push_back(m_previous.get());
+            m_previous.release();
+            m_previous.swap(m_loaded);
+            m_loaded.swap(emptyMagazine);
+
+            m_loaded->Push(block);
+        }
+    };
+
+    /// <summary>
+    /// Holds the caches of the calling thread (one per pool it has used).
+    /// </summary>
+    struct ThreadCacheRegistry
+    {
+        std::vector<std::unique_ptr<ThreadCache>> caches;
+        ThreadCache *lastUsed = nullptr;
+
+        /// <summary>
+        /// Finds the cache for the given depot, and creates it if not found.
+        /// </summary>
+        ThreadCache &Find(const std::shared_ptr<ConcurrentDynamicMemPool::Depot> &depot)
+        {
+            if (lastUsed != nullptr && lastUsed->GetDepot() == depot.get())
+                return *lastUsed;
+
+            auto iter = std::find_if(caches.begin(), caches.end(),
+                [&depot](const std::unique_ptr<ThreadCache> &cache)
+                {
+                    return cache->GetDepot() == depot.get();
+                });
+
+            if (iter == caches.end())
+            {
+                // slow path: the chance to let go of caches for pools no longer alive
+                Purge(nullptr);
+                caches.emplace_back(dbg_new ThreadCache(depot));
+                iter = caches.end() - 1;
+            }
+
+            lastUsed = iter->get();
+            return *lastUsed;
+        }
+
+        /// <summary>
+        /// Removes the caches for retired pools and the cache for the given depot.
+        /// </summary>
+        void Purge(ConcurrentDynamicMemPool::Depot *depot)
+        {
+            lastUsed = nullptr;
+
+            caches.erase(
+                std::remove_if(caches.begin(), caches.end(),
+                    [depot](const std::unique_ptr<ThreadCache> &cache)
+                    {
+                        return cache->GetDepot() == depot
+                            || cache->GetDepot()->retired.load(std::memory_order_acquire);
+                    }),
+                caches.end()
+            );
+        }
+    };
+
+    static thread_local ThreadCacheRegistry threadCacheRegistry;
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="ConcurrentDynamicMemPool"/> class.
+    /// </summary>
+    /// <param name="initialSize">The initial size.</param>
+    /// <param name="blockSize">Size of the block.</param>
+    /// <param name="growingFactor">The factor for growing size of the pool.</param>
+    ConcurrentDynamicMemPool::ConcurrentDynamicMemPool(uint16_t initialSize, uint16_t blockSize, float growingFactor)
+    try
+        : m_depot(std::make_shared<Depot>(initialSize, blockSize, growingFactor))
+    {
+    }
+    catch (std::bad_alloc &)
+    {
+        throw core::AppException<std::runtime_error>("Failed to allocate memory for concurrent memory pool");
+    }
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="ConcurrentDynamicMemPool"/> class.
+    /// Other threads release their caches for this pool the next time they create a
+    /// cache for another pool or when they terminate, so the memory stays reserved until then.
+    /// </summary>
+    ConcurrentDynamicMemPool::~ConcurrentDynamicMemPool()
+    {
+        m_depot->retired.store(true, std::memory_order_release);
+        threadCacheRegistry.Purge(m_depot.get());
+    }
+
+    /// <summary>
+    /// Gets a free block of memory.
+    /// </summary>
+    /// <returns>The address of the block.</returns>
+    void * ConcurrentDynamicMemPool::GetFreeBlock()
+    {
+        try
+        {
+            return threadCacheRegistry.Find(m_depot).GetFreeBlock();
+        }
+        catch (core::IAppException &)
+        {
+            throw; // just forward errors known to have been previously handled
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to acquire lock of concurrent memory pool: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::bad_alloc &)
+        {
+            throw core::AppException<std::runtime_error>("Failed to allocate memory for concurrent memory pool");
+        }
+    }
+
+    /// <summary>
+    /// Returns a block of memory.
+    /// </summary>
+    /// <param name="object">The address of the object to return.</param>
+    void ConcurrentDynamicMemPool::ReturnBlock(void *object)
+    {
+        try
+        {
+            threadCacheRegistry.Find(m_depot).ReturnBlock(object);
+        }
+        catch (core::IAppException &)
+        {
+            throw; // just forward errors known to have been previously handled
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to acquire lock of concurrent memory pool: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::bad_alloc &)
+        {
+            throw core::AppException<std::runtime_error>("Failed to allocate memory for concurrent memory pool");
+        }
+    }
+
+    /// <summary>
+    /// Returns the blocks in the full magazines of the depot to the backing
+    /// pool, then shrinks it. Blocks cached by the threads are not affected.
+    /// </summary>
+    void ConcurrentDynamicMemPool::Shrink()
+    {
+        try
+        {
+            std::lock_guard<std::mutex> lock(m_depot->mutex);
+            m_depot->ReleaseMagazines(m_depot->fullMagazines);
+            m_depot->ReleaseMagazines(m_depot->emptyMagazines);
+            m_depot->backingPool.Shrink();
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to acquire lock of concurrent memory pool: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+    /// <summary>
+    /// Gets the statistics of the backing pool. Blocks cached by the threads count as in use.
+    /// </summary>
+    /// <returns>The current statistics.</returns>
+    MemPoolStats ConcurrentDynamicMemPool::GetStats()
+    {
+        try
+        {
+            std::lock_guard<std::mutex> lock(m_depot->mutex);
+            return m_depot->backingPool.GetStats();
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to acquire lock of concurrent memory pool: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+} // end of namespace utils
+} // end of namespace _3fd
@@ -8,6 +8,8 @@
 
 #include <3fd/core/exceptions.h>
 
+#include <array>
+#include <atomic>
 #include <cinttypes>
 #include <condition_variable>
 #include <functional>
@@ -16,15 +18,18 @@
 #include <mutex>
 #include <shared_mutex>
 #include <unordered_map>
-
-#ifdef _3FD_PLATFORM_WINRT
-#   include <3fd/utils/lockfreequeue.h>
-#endif
+#include <vector>
 
 namespace _3fd
 {
 namespace utils
 {
+    /// <summary>
+    /// The assumed size of a cache line, used to keep apart data
+    /// written by different threads and avoid false sharing.
+    /// </summary>
+    constexpr size_t cacheLineSize(64);
+
     /// <summary>
     /// Implements an event for thread synchronization making 
     /// use of a lightweight mutex and a condition variable.
@@ -48,6 +53,83 @@ namespace utils
         bool WaitFor(unsigned long millisecs);
     };
 
+    /// <summary>
+    /// Implements an event count, which lets a consumer block until a condition
+    /// (usually evaluated lock-free) is satisfied, while the producers only pay
+    /// for an atomic load when there is no one waiting.
+    /// </summary>
+    /// <remarks>
+    /// The waiter must follow the protocol:
+    ///     auto key = eventCount.PrepareWait();
+    ///     if (condition) eventCount.CancelWait(); else eventCount.Wait(key);
+    /// whereas the producer makes the condition true, then calls <see cref="Notify"/>.
+    /// </remarks>
+    class EventCount
+    {
+    private:
+
+        std::atomic<uint32_t> m_epoch;
+        std::atomic<uint32_t> m_numWaiters;
+
+#ifndef __linux__ // no futex, so fall back to mutex & condition variable:
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+#endif
+        void WakeWaiters(bool all) noexcept;
+
+    public:
+
+        typedef uint32_t Key;
+
+        EventCount();
+
+        EventCount(const EventCount &) = delete;
+
+        /// <summary>
+        /// Registers the caller as a waiter. From now on, any notification
+        /// will cause the wait using the returned key not to block.
+        /// </summary>
+        /// <returns>The key to provide for the wait.</returns>
+        Key PrepareWait() noexcept
+        {
+            m_numWaiters.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return m_epoch.load(std::memory_order_acquire);
+        }
+
+        /// <summary>
+        /// Unregisters the caller as a waiter, because the condition was satisfied.
+        /// </summary>
+        void CancelWait() noexcept
+        {
+            m_numWaiters.fetch_sub(1, std::memory_order_seq_cst);
+        }
+
+        void Wait(Key key) noexcept;
+
+        bool WaitFor(Key key, unsigned long millisecs) noexcept;
+
+        /// <summary>
+        /// Wakes all the waiters, if any.
+        /// </summary>
+        void Notify() noexcept
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_numWaiters.load(std::memory_order_relaxed) != 0)
+                WakeWaiters(true);
+        }
+
+        /// <summary>
+        /// Wakes at least one of the waiters, if any.
+        /// </summary>
+        void NotifyOne() noexcept
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_numWaiters.load(std::memory_order_relaxed) != 0)
+                WakeWaiters(false);
+        }
+    };
+
     /// <summary>
     /// Provides helpers for asynchronous callbacks.
     /// </summary>
@@ -58,6 +140,29 @@ namespace utils
         static void InvokeAndLeave(const std::function<void()> &callback);
     };
 
+    /// <summary>
+    /// Keeps the callbacks to invoke once an asynchronous operation completes.
+    /// </summary>
+    class CompletionNotifier
+    {
+    private:
+
+        std::mutex m_mutex;
+        std::vector<std::function<void()>> m_callbacks;
+        bool m_completed;
+
+    public:
+
+        CompletionNotifier()
+            : m_completed(false) {}
+
+        CompletionNotifier(const CompletionNotifier &) = delete;
+
+        void Subscribe(const std::function<void()> &callback);
+
+        void Notify() noexcept;
+    };
+
 #ifdef _WIN32
 
     /// <summary>
@@ -94,51 +199,65 @@ namespace utils
 
     /// <summary>
     /// Caches resources that are supposed to be used simultaneously by many.
+    /// The cache is split in shards (selected by hash of the key) with independent
+    /// locks, and a hit takes only the shared lock of its shard. Entries whose
+    /// objects have expired are cleaned up a few buckets at a time upon insertion.
     /// </summary>
-    template <typename KeyType, typename CachedType>
+    template <typename KeyType, typename CachedType, size_t t_numShards = 16>
     class CacheForSharedResources
     {
     private:
 
-        std::shared_mutex m_accessToMapMutex;
+        static_assert(t_numShards > 0, "cache must have at least one shard");
 
         typedef std::unordered_map<KeyType, std::weak_ptr<CachedType>> Dictionary;
 
-        Dictionary m_objects;
+        struct alignas(cacheLineSize) Shard
+        {
+            std::shared_mutex mutex;
+            Dictionary objects;
+            size_t cleanUpBucket = 0; // where the next clean-up step starts
+        };
+
+        std::array<Shard, t_numShards> m_shards;
 
         typedef std::function<CachedType *(void)> Factory;
 
         Factory createObject;
 
         /// <summary>
-        /// Decides whether cache should be cleaned up.
+        /// Gets the shard responsible for a key.
         /// </summary>
-        bool ShouldCleanUpCache()
+        Shard &GetShard(const KeyType &key)
         {
-            // get a random object:
-            auto iter = m_objects.begin();
-            if (iter == m_objects.end())
-                return false;
-
-            // rolled the dice... if dead, clean it up:
-            return (iter->second.use_count() == 0);
+            // mix the bits, because some hashes (as for integers) are identity:
+            auto hash = static_cast<uint64_t> (std::hash<KeyType>()(key)) * 0x9E3779B97F4A7C15ULL;
+            return m_shards[(hash >> 32) % t_numShards];
         }
 
         /// <summary>
-        /// MAY ONLY BE CALLED WITHIN EXCLUSIVE LOCK!!!
-        /// Clean up cache from already deallocated objects.
+        /// MAY ONLY BE CALLED WITHIN EXCLUSIVE LOCK OF THE SHARD!!!
+        /// Removes from some buckets of the shard the entries whose objects have expired.
         /// </summary>
-        void CleanUpCache()
+        static void CleanUpIncrementally(Shard &shard)
         {
-            Dictionary temp;
+            const size_t numBucketsPerStep(2);
+
+            std::vector<KeyType> expiredKeys;
 
-            for (auto &pair : m_objects)
+            for (size_t count = 0; count < numBucketsPerStep; ++count)
             {
-                if (pair.second.use_count() > 0)
-                    temp.insert(std::make_pair(pair.first, pair.second));
+                auto bucket = shard.cleanUpBucket++ % shard.objects.bucket_count();
+
+                for (auto iter = shard.objects.begin(bucket); iter != shard.objects.end(bucket); ++iter)
+                {
+                    if (iter->second.expired())
+                        expiredKeys.push_back(iter->first);
+                }
             }
 
-            temp.swap(m_objects);
+            for (auto &key : expiredKeys)
+                shard.objects.erase(key);
         }
 
     public:
@@ -164,39 +283,60 @@ namespace utils
         CacheForSharedResources(const CacheForSharedResources &) = delete;
 
         /// <summary>
-        /// Constructor for <see cref="CacheForSharedResources"/>.
+        /// Retrieves an object from cache, or creates it when not available.
+        /// Concurrent requests for the same key always get the same object.
         /// </summary>
         /// <param name="key">
         /// Key for identification of the object to retrieve (or create, when not available.)
         /// </param>
         std::shared_ptr<CachedType> GetObject(const KeyType &key)
         {
-            bool foundObjectDeadInCache(false);
+            auto &shard = GetShard(key);
 
-            {// object found in cache:
-                std::shared_lock<std::shared_mutex> readLock(m_accessToMapMutex);
-                auto iter = m_objects.find(key);
-                if (iter != m_objects.end())
+            {// object found alive in cache:
+                std::shared_lock<std::shared_mutex> readLock(shard.mutex);
+                auto iter = shard.objects.find(key);
+                if (iter != shard.objects.end())
                 {
-                    foundObjectDeadInCache = (iter->second.use_count() == 0);
-                    if (!foundObjectDeadInCache)
-                        return iter->second.lock();
+                    auto object = iter->second.lock();
+                    if (object)
+                        return object;
                 }
             }
-            
-            {// object not available OR alive in cache
-                std::unique_lock<std::shared_mutex> writeLock(m_accessToMapMutex);
 
-                if (foundObjectDeadInCache && ShouldCleanUpCache())
-                    CleanUpCache();
+            {// object not available OR dead in cache
+                std::unique_lock<std::shared_mutex> writeLock(shard.mutex);
+
+                // another thread might have created it in the meantime:
+                auto &entry = shard.objects[key];
+                auto object = entry.lock();
+                if (object)
+                    return object;
 
-                std::shared_ptr<CachedType> newObject(createObject());
-                m_objects[key] = newObject;
-                return newObject;
+                object.reset(createObject());
+                entry = object;
+
+                CleanUpIncrementally(shard);
+                return object;
             }
         }
 
-    }; // end of class CacheDictionary
+        /// <summary>
+        /// Counts the entries in cache, including those of expired objects not yet cleaned up.
+        /// </summary>
+        size_t GetNumEntries()
+        {
+            size_t count(0);
+            for (auto &shard : m_shards)
+            {
+                std::shared_lock<std::shared_mutex> readLock(shard.mutex);
+                count += shard.objects.size();
+            }
+
+            return count;
+        }
+
+    }; // end of class CacheForSharedResources
 
 }// end of namespace utils
 }// end of namespace _3fd
@@ -0,0 +1,597 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#ifndef UTILS_CONCURRENTHASHMAP_H // header guard
+#define UTILS_CONCURRENTHASHMAP_H
+
+#include <3fd/utils/concurrency.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace _3fd
+{
+namespace utils
+{
+    /// <summary>
+    /// Defers the destruction of objects removed from a concurrent data structure until no
+    /// reader can hold a reference to them anymore (epoch based reclamation). Readers only
+    /// touch a counter of the current epoch, so they never wait for each other or for writers.
+    /// </summary>
+    class EpochBasedReclaimer
+    {
+    private:
+
+        static constexpr uint32_t numReaderSlots = 16;
+
+        // readers of different threads count in different slots, to spare cache lines:
+        struct alignas(cacheLineSize) ReaderSlot
+        {
+            std::atomic<uint64_t> counters[2];
+        };
+
+        struct RetiredObject
+        {
+            void *object;
+            void (*deleter)(void *);
+        };
+
+        std::atomic<uint64_t> m_epoch;
+
+        std::array<ReaderSlot, numReaderSlots> m_readerSlots;
+
+        std::mutex m_retiredMutex;
+
+        std::vector<RetiredObject> m_retiredObjects[2];
+
+        static uint32_t GetReaderSlotIndex() noexcept
+        {
+            static std::atomic<uint32_t> nextIndex(0);
+            thread_local uint32_t index = nextIndex.fetch_add(1, std::memory_order_relaxed) % numReaderSlots;
+            return index;
+        }
+
+        static void DeleteAll(std::vector<RetiredObject> &retiredObjects) noexcept
+        {
+            for (auto &retired : retiredObjects)
+                retired.deleter(retired.object);
+
+            retiredObjects.clear();
+        }
+
+        // moves to the next epoch once the readers of the previous one are gone,
+        // then deletes what was retired in the previous epoch (must be called within the lock)
+        void TryAdvanceEpoch() noexcept
+        {
+            auto epoch = m_epoch.load();
+            auto parity = (epoch + 1) & 1;
+
+            for (auto &slot : m_readerSlots)
+            {
+                if (slot.counters[parity].load() != 0)
+                    return;
+            }
+
+            DeleteAll(m_retiredObjects[parity]);
+            m_epoch.store(epoch + 1);
+        }
+
+    public:
+
+        /// <summary>
+        /// Marks a reading section, during which objects reachable
+        /// from the data structure are not destroyed.
+        /// </summary>
+        class Guard
+        {
+        private:
+
+            std::atomic<uint64_t> *m_counter;
+
+        public:
+
+            explicit Guard(EpochBasedReclaimer &reclaimer) noexcept
+            {
+                auto &slot = reclaimer.m_readerSlots[GetReaderSlotIndex()];
+
+                // retry if the epoch moves before the reader is counted in it:
+                while (true)
+                {
+                    auto epoch = reclaimer.m_epoch.load();
+                    m_counter = &slot.counters[epoch & 1];
+                    m_counter->fetch_add(1);
+
+                    if (reclaimer.m_epoch.load() == epoch)
+                        break;
+
+                    m_counter->fetch_sub(1);
+                }
+            }
+
+            ~Guard()
+            {
+                m_counter->fetch_sub(1);
+            }
+
+            Guard(const Guard &) = delete;
+        };
+
+        EpochBasedReclaimer() noexcept
+            : m_epoch(0)
+        {
+            for (auto &slot : m_readerSlots)
+            {
+                slot.counters[0].store(0, std::memory_order_relaxed);
+                slot.counters[1].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        EpochBasedReclaimer(const EpochBasedReclaimer &) = delete;
+
+        /// <summary>
+        /// Finalizes an instance of the <see cref="EpochBasedReclaimer"/> class.
+        /// There must be no readers left.
+        /// </summary>
+        ~EpochBasedReclaimer()
+        {
+            DeleteAll(m_retiredObjects[0]);
+            DeleteAll(m_retiredObjects[1]);
+        }
+
+        /// <summary>
+        /// Schedules the destruction of an object already unreachable for new readers.
+        /// </summary>
+        /// <param name="object">The object to destroy.</param>
+        template <typename Type>
+        void Retire(Type *object)
+        {
+            std::lock_guard<std::mutex> lock(m_retiredMutex);
+
+            auto &retiredObjects = m_retiredObjects[m_epoch.load() & 1];
+            retiredObjects.push_back(
+                RetiredObject{ object, [](void *ptr) { delete static_cast<Type *> (ptr); } }
+            );
+
+            if (retiredObjects.size() >= 64)
+                TryAdvanceEpoch();
+        }
+    };
+
+    /// <summary>
+    /// A hash map for concurrent access, with open addressing (linear probing).
+    /// Lookups take no lock and never wait for writers. Writers lock only one of many
+    /// stripes (selected by hash of the key), and publish entries by atomic exchange
+    /// of immutable nodes, which are reclaimed once no reader can see them.
+    /// When the table grows, entries are migrated incrementally by the writers,
+    /// while readers look for keys in both the old and the new table.
+    /// </summary>
+    template <typename KeyType,
+              typename ValueType,
+              typename HashType = std::hash<KeyType>,
+              typename KeyEqualType = std::equal_to<KeyType>>
+    class ConcurrentHashMap
+    {
+    private:
+
+        static constexpr size_t minCapacity = 16;
+        static constexpr size_t numSlotsMigratedPerWrite = 64;
+        static constexpr uint32_t numStripes = 64;
+
+        struct Node
+        {
+            uint64_t hash;
+            KeyType key;
+            ValueType value;
+        };
+
+        struct Table
+        {
+            const size_t capacity; // power of 2
+            std::unique_ptr<std::atomic<Node *>[]> slots;
+            std::atomic<size_t> numUsedSlots; // nodes & tombstones
+            std::atomic<Table *> next; // set when migrating to a new table
+            std::atomic<size_t> migrationCursor;
+            std::atomic<size_t> numMigratedSlots;
+
+            explicit Table(size_t p_capacity)
+                : capacity(p_capacity)
+                , slots(dbg_new std::atomic<Node *>[p_capacity])
+                , numUsedSlots(0)
+                , next(nullptr)
+                , migrationCursor(0)
+                , numMigratedSlots(0)
+            {
+                for (size_t idx = 0; idx < capacity; ++idx)
+                    slots[idx].store(nullptr, std::memory_order_relaxed);
+            }
+        };
+
+        struct alignas(cacheLineSize) Stripe
+        {
+            std::mutex mutex;
+        };
+
+        // markers in slots, whose addresses are never those of a node:
+        static Node *GetTombstone() noexcept { static char marker; return reinterpret_cast<Node *> (&marker); }
+        static Node *GetMovedMarker() noexcept { static char marker; return reinterpret_cast<Node *> (&marker); }
+        static Node *GetSealedMarker() noexcept { static char marker; return reinterpret_cast<Node *> (&marker); }
+
+        static bool IsNode(Node *node) noexcept
+        {
+            return node != nullptr
+                && node != GetTombstone()
+                && node != GetMovedMarker()
+                && node != GetSealedMarker();
+        }
+
+        std::atomic<Table *> m_table;
+        std::atomic<size_t> m_numEntries;
+        std::array<Stripe, numStripes> m_stripes;
+        mutable EpochBasedReclaimer m_reclaimer;
+        HashType m_hasher;
+        KeyEqualType m_keyEqual;
+
+        uint64_t GetHash(const KeyType &key) const
+        {
+            // mix the bits (MurmurHash3 finalizer), because some hashes (as for integers) are identity:
+            auto hash = static_cast<uint64_t> (m_hasher(key));
+            hash = (hash ^ (hash >> 33)) * 0xFF51AFD7ED558CCDULL;
+            hash = (hash ^ (hash >> 33)) * 0xC4CEB9FE1A85EC53ULL;
+            return hash ^ (hash >> 33);
+        }
+
+        std::mutex &GetStripeMutex(uint64_t hash) noexcept
+        {
+            return m_stripes[(hash >> 16) % numStripes].mutex;
+        }
+
+        // looks for the slot holding the key in a table
+        std::atomic<Node *> *FindSlot(Table *table, uint64_t hash, const KeyType &key) const
+        {
+            auto mask = table->capacity - 1;
+            for (size_t count = 0, idx = hash & mask; count < table->capacity; ++count, idx = (idx + 1) & mask)
+            {
+                auto &slot = table->slots[idx];
+                auto node = slot.load(std::memory_order_acquire);
+
+                // an empty slot ends the probing sequence, even if sealed by migration:
+                if (node == nullptr || node == GetSealedMarker())
+                    return nullptr;
+
+                if (IsNode(node) && node->hash == hash && m_keyEqual(node->key, key))
+                    return &slot;
+            }
+
+            return nullptr;
+        }
+
+        // places a node in the first empty slot of its probing sequence, unless
+        // the table is being sealed by migration (then it returns false)
+        static bool PlaceNode(Table *table, Node *node) noexcept
+        {
+            auto mask = table->capacity - 1;
+            for (size_t count = 0, idx = node->hash & mask; count < table->capacity; ++count, idx = (idx + 1) & mask)
+            {
+                auto &slot = table->slots[idx];
+                auto current = slot.load(std::memory_order_acquire);
+
+                if (current == nullptr)
+                {
+                    if (slot.compare_exchange_strong(current, node))
+                    {
+                        table->numUsedSlots.fetch_add(1, std::memory_order_relaxed);
+                        return true;
+                    }
+                }
+
+                if (current == GetMovedMarker() || current == GetSealedMarker())
+                    return false;
+            }
+
+            return false;
+        }
+
+        // moves the content of a slot from the old table to the new one
+        void MigrateSlot(Table *table, Table *newTable, size_t idx)
+        {
+            auto &slot = table->slots[idx];
+
+            while (true)
+            {
+                auto node = slot.load(std::memory_order_acquire);
+
+                if (node == GetMovedMarker() || node == GetSealedMarker())
+                    return;
+
+                // seal empty slots & tombstones, so nothing is placed there anymore:
+                if (node == nullptr)
+                {
+                    if (slot.compare_exchange_strong(node, GetSealedMarker()))
+                        return;
+
+                    continue;
+                }
+                else if (node == GetTombstone())
+                {
+                    if (slot.compare_exchange_strong(node, GetMovedMarker()))
+                        return;
+
+                    continue;
+                }
+
+                // the node is immutable, but writers can replace it while holding the stripe:
+                std::lock_guard<std::mutex> lock(GetStripeMutex(node->hash));
+
+                if (slot.load(std::memory_order_acquire) != node)
+                    continue;
+
+                // place it in the new table before marking it moved, so readers always find it:
+                bool placed = PlaceNode(newTable, node);
+                _ASSERTE(placed);
+                (void)placed;
+                slot.store(GetMovedMarker(), std::memory_order_release);
+                return;
+            }
+        }
+
+        // migrates a range of slots, and returns false when there was none left
+        bool HelpMigrate(Table *table, Table *newTable)
+        {
+            auto begin = table->migrationCursor.fetch_add(numSlotsMigratedPerWrite);
+            if (begin >= table->capacity)
+                return false;
+
+            auto end = std::min(begin + numSlotsMigratedPerWrite, table->capacity);
+            for (auto idx = begin; idx < end; ++idx)
+                MigrateSlot(table, newTable, idx);
+
+            // the last range to finish makes the new table current:
+            if (table->numMigratedSlots.fetch_add(end - begin) + (end - begin) == table->capacity)
+            {
+                m_table.store(newTable);
+                m_reclaimer.Retire(table);
+            }
+
+            return true;
+        }
+
+        // helps an ongoing migration, or starts one when the table is too loaded
+        // (must be called while no stripe is locked by the caller)
+        void MaintainTable()
+        {
+            auto table = m_table.load();
+            auto newTable = table->next.load();
+
+            if (newTable != nullptr)
+            {
+                // if the new table is filling faster than the migration, complete it now:
+                if (newTable->numUsedSlots.load(std::memory_order_relaxed) * 2 <= newTable->capacity)
+                {
+                    HelpMigrate(table, newTable);
+                    return;
+                }
+
+                while (m_table.load() == table)
+                {
+                    if (!HelpMigrate(table, newTable))
+                        std::this_thread::yield();
+                }
+
+                return;
+            }
+
+            if (table->numUsedSlots.load(std::memory_order_relaxed) * 2 <= table->capacity)
+                return;
+
+            // grow when the table holds many entries, otherwise just purge the tombstones:
+            auto newCapacity = table->capacity;
+            while (m_numEntries.load(std::memory_order_relaxed) * 4 > newCapacity)
+                newCapacity *= 2;
+
+            std::unique_ptr<Table> candidate(dbg_new Table(newCapacity));
+            Table *expected(nullptr);
+            if (table->next.compare_exchange_strong(expected, candidate.get()))
+                candidate.release();
+        }
+
+        enum class WriteOp { Insert, InsertOrAssign, Remove };
+
+        bool Write(const KeyType &key, const ValueType *value, WriteOp op)
+        {
+            auto hash = GetHash(key);
+
+            while (true)
+            {
+                EpochBasedReclaimer::Guard guard(m_reclaimer);
+                bool done(false), result(false);
+
+                {
+                    std::lock_guard<std::mutex> lock(GetStripeMutex(hash));
+
+                    auto table = m_table.load();
+                    auto newTable = table->next.load();
+
+                    // while the stripe is held, the key cannot be moved between tables:
+                    auto slot = FindSlot(table, hash, key);
+                    if (slot == nullptr && newTable != nullptr)
+                        slot = FindSlot(newTable, hash, key);
+
+                    if (slot != nullptr)
+                    {
+                        done = true;
+
+                        if (op != WriteOp::Insert)
+                        {
+                            auto node = slot->load(std::memory_order_acquire);
+
+                            if (op == WriteOp::Remove)
+                            {
+                                slot->store(GetTombstone(), std::memory_order_release);
+                                m_numEntries.fetch_sub(1, std::memory_order_relaxed);
+                            }
+                            else
+                                slot->store(dbg_new Node{ hash, key, *value }, std::memory_order_release);
+
+                            m_reclaimer.Retire(node);
+                            result = true;
+                        }
+                    }
+                    else if (op == WriteOp::Remove)
+                    {
+                        done = true;
+                    }
+                    else
+                    {
+                        std::unique_ptr<Node> node(dbg_new Node{ hash, key, *value });
+
+                        if (PlaceNode(newTable != nullptr ? newTable : table, node.get()))
+                        {
+                            node.release();
+                            m_numEntries.fetch_add(1, std::memory_order_relaxed);
+                            done = result = true;
+                        }
+                    }
+                }
+
+                MaintainTable();
+
+                // when the slot got sealed by a migration just started, try again:
+                if (done)
+                    return result;
+            }
+        }
+
+        static void DeleteNodes(Table *table) noexcept
+        {
+            for (size_t idx = 0; idx < table->capacity; ++idx)
+            {
+                auto node = table->slots[idx].load(std::memory_order_relaxed);
+                if (IsNode(node))
+                    delete node;
+            }
+        }
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="ConcurrentHashMap"/> class.
+        /// </summary>
+        /// <param name="initialCapacity">The initial amount of slots in the table.</param>
+        explicit ConcurrentHashMap(size_t initialCapacity = 64)
+            : m_table(nullptr)
+            , m_numEntries(0)
+        {
+            size_t capacity(minCapacity);
+            while (capacity < initialCapacity)
+                capacity *= 2;
+
+            m_table.store(dbg_new Table(capacity));
+        }
+
+        ConcurrentHashMap(const ConcurrentHashMap &) = delete;
+
+        /// <summary>
+        /// Finalizes an instance of the <see cref="ConcurrentHashMap"/> class.
+        /// </summary>
+        ~ConcurrentHashMap()
+        {
+            auto table = m_table.load();
+            auto newTable = table->next.load();
+
+            // nodes marked as moved are in the new table:
+            DeleteNodes(table);
+            delete table;
+
+            if (newTable != nullptr)
+            {
+                DeleteNodes(newTable);
+                delete newTable;
+            }
+        }
+
+        /// <summary>
+        /// Looks up a key without taking any lock.
+        /// </summary>
+        /// <param name="key">The key.</param>
+        /// <param name="value">Receives a copy of the value mapped to the key.</param>
+        /// <returns>Whether the key was found.</returns>
+        bool Find(const KeyType &key, ValueType &value) const
+        {
+            auto hash = GetHash(key);
+            EpochBasedReclaimer::Guard guard(m_reclaimer);
+
+            // keys already migrated are found in the new table:
+            for (auto table = m_table.load(); table != nullptr; table = table->next.load())
+            {
+                auto slot = FindSlot(table, hash, key);
+                if (slot != nullptr)
+                {
+                    auto node = slot->load(std::memory_order_acquire);
+                    if (IsNode(node))
+                    {
+                        value = node->value;
+                        return true;
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        /// <summary>
+        /// Tells whether the map contains a key.
+        /// </summary>
+        bool Contains(const KeyType &key) const
+        {
+            ValueType value;
+            return Find(key, value);
+        }
+
+        /// <summary>
+        /// Inserts an entry, unless the key is already present.
+        /// </summary>
+        /// <returns>Whether the entry was inserted.</returns>
+        bool Insert(const KeyType &key, const ValueType &value)
+        {
+            return Write(key, &value, WriteOp::Insert);
+        }
+
+        /// <summary>
+        /// Inserts an entry, or replaces the value when the key is already present.
+        /// </summary>
+        void InsertOrAssign(const KeyType &key, const ValueType &value)
+        {
+            Write(key, &value, WriteOp::InsertOrAssign);
+        }
+
+        /// <summary>
+        /// Removes an entry.
+        /// </summary>
+        /// <returns>Whether the key was found.</returns>
+        bool Remove(const KeyType &key)
+        {
+            return Write(key, nullptr, WriteOp::Remove);
+        }
+
+        /// <summary>
+        /// Gets the amount of entries in the map.
+        /// </summary>
+        size_t GetSize() const noexcept
+        {
+            return m_numEntries.load(std::memory_order_relaxed);
+        }
+    };
+
+}// end of namespace utils
+}// end of namespace _3fd
+
+#endif // end of header guard
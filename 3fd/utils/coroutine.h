@@ -0,0 +1,423 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#ifndef COROUTINE_H // header guard
+#define COROUTINE_H
+
+#include <3fd/core/preprocessing.h>
+
+#ifdef _3FD_HAS_COROUTINES
+
+#include <3fd/utils/threadpool.h>
+#include <3fd/utils/timerwheel.h>
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <future>
+#include <optional>
+#include <utility>
+
+namespace _3fd
+{
+namespace utils
+{
+    template <typename ValType> class Task;
+
+    /// <summary>
+    /// Common implementation for the promise of <see cref="Task{}"/>.
+    /// </summary>
+    class TaskPromiseBase
+    {
+    private:
+
+        std::coroutine_handle<> m_continuation;
+
+    protected:
+
+        std::exception_ptr m_exception;
+
+    public:
+
+        /// <summary>
+        /// Upon completion, resumes the awaiting coroutine (if any) by symmetric transfer.
+        /// </summary>
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+
+            template <typename PromiseType>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseType> handle) noexcept
+            {
+                auto continuation = handle.promise().GetContinuation();
+                return continuation ? continuation : std::noop_coroutine();
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception() noexcept { m_exception = std::current_exception(); }
+
+        void SetContinuation(std::coroutine_handle<> continuation) noexcept { m_continuation = continuation; }
+
+        std::coroutine_handle<> GetContinuation() const noexcept { return m_continuation; }
+    };
+
+    /// <summary>
+    /// The promise of <see cref="Task{}"/>.
+    /// </summary>
+    template <typename ValType>
+    class TaskPromise : public TaskPromiseBase
+    {
+    private:
+
+        std::optional<ValType> m_value;
+
+    public:
+
+        Task<ValType> get_return_object() noexcept;
+
+        template <typename FromType>
+        void return_value(FromType &&value)
+        {
+            m_value.emplace(std::forward<FromType>(value));
+        }
+
+        ValType GetResult()
+        {
+            if (m_exception)
+                std::rethrow_exception(m_exception);
+
+            return std::move(*m_value);
+        }
+    };
+
+    /// <summary>
+    /// The promise of <see cref="Task{void}"/>.
+    /// </summary>
+    template <>
+    class TaskPromise<void> : public TaskPromiseBase
+    {
+    public:
+
+        Task<void> get_return_object() noexcept;
+
+        void return_void() noexcept {}
+
+        void GetResult()
+        {
+            if (m_exception)
+                std::rethrow_exception(m_exception);
+        }
+    };
+
+    /// <summary>
+    /// A lazy coroutine that produces a value (or an exception). It only
+    /// starts when awaited, and the awaiting coroutine is resumed right away
+    /// in the thread where this one completes.
+    /// </summary>
+    template <typename ValType = void>
+    class [[nodiscard]] Task
+    {
+    public:
+
+        typedef TaskPromise<ValType> promise_type;
+
+    private:
+
+        std::coroutine_handle<promise_type> m_handle;
+
+    public:
+
+        explicit Task(std::coroutine_handle<promise_type> handle) noexcept
+            : m_handle(handle) {}
+
+        Task(const Task &) = delete;
+
+        Task(Task &&ob) noexcept
+            : m_handle(std::exchange(ob.m_handle, nullptr)) {}
+
+        Task &operator =(Task &&ob) noexcept
+        {
+            if (&ob != this)
+            {
+                if (m_handle)
+                    m_handle.destroy();
+
+                m_handle = std::exchange(ob.m_handle, nullptr);
+            }
+
+            return *this;
+        }
+
+        ~Task()
+        {
+            if (m_handle)
+                m_handle.destroy();
+        }
+
+        /// <summary>
+        /// Starts the coroutine and suspends the awaiting one until completion.
+        /// </summary>
+        auto operator co_await() && noexcept
+        {
+            _ASSERTE(m_handle); // cannot await an empty task
+
+            struct Awaiter
+            {
+                std::coroutine_handle<promise_type> handle;
+
+                bool await_ready() noexcept { return handle.done(); }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+                {
+                    handle.promise().SetContinuation(awaiting);
+                    return handle;
+                }
+
+                ValType await_resume() { return handle.promise().GetResult(); }
+            };
+
+            return Awaiter{ m_handle };
+        }
+    };
+
+    template <typename ValType>
+    Task<ValType> TaskPromise<ValType>::get_return_object() noexcept
+    {
+        return Task<ValType>(std::coroutine_handle<TaskPromise<ValType>>::from_promise(*this));
+    }
+
+    inline Task<void> TaskPromise<void>::get_return_object() noexcept
+    {
+        return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+    }
+
+    /// <summary>
+    /// A coroutine that starts right away and releases its own resources upon completion.
+    /// Exceptions must not escape it.
+    /// </summary>
+    struct DetachedCoroutine
+    {
+        struct promise_type
+        {
+            DetachedCoroutine get_return_object() noexcept { return {}; }
+
+            std::suspend_never initial_suspend() noexcept { return {}; }
+
+            std::suspend_never final_suspend() noexcept { return {}; }
+
+            void return_void() noexcept {}
+
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    /// <summary>
+    /// Awaitable that resumes the coroutine in a thread pool.
+    /// </summary>
+    class ThreadPoolAwaiter
+    {
+    private:
+
+        ThreadPool &m_threadPool;
+        TaskPriority m_priority;
+
+    public:
+
+        ThreadPoolAwaiter(ThreadPool &threadPool, TaskPriority priority) noexcept
+            : m_threadPool(threadPool), m_priority(priority) {}
+
+        bool await_ready() noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            m_threadPool.Submit([handle]() { handle.resume(); }, m_priority);
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    /// <summary>
+    /// Makes the awaiting coroutine continue in a thread of the given pool.
+    /// </summary>
+    /// <param name="threadPool">The thread pool.</param>
+    /// <param name="priority">The priority for resumption in the pool.</param>
+    inline ThreadPoolAwaiter ScheduleOn(ThreadPool &threadPool, TaskPriority priority = TaskPriority::Normal)
+    {
+        return ThreadPoolAwaiter(threadPool, priority);
+    }
+
+    /// <summary>
+    /// Awaitable that resumes the coroutine after a delay, without blocking a thread.
+    /// </summary>
+    class DelayAwaiter
+    {
+    private:
+
+        TimerWheel &m_timerWheel;
+        std::chrono::milliseconds m_delay;
+        TaskPriority m_priority;
+
+    public:
+
+        DelayAwaiter(TimerWheel &timerWheel, std::chrono::milliseconds delay, TaskPriority priority) noexcept
+            : m_timerWheel(timerWheel), m_delay(delay), m_priority(priority) {}
+
+        bool await_ready() noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            m_timerWheel.Schedule(m_delay, [handle]() { handle.resume(); }, m_priority);
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    /// <summary>
+    /// Makes the awaiting coroutine continue after a delay, in the thread pool of the timer wheel.
+    /// </summary>
+    /// <param name="timerWheel">The timer wheel.</param>
+    /// <param name="delay">The delay.</param>
+    /// <param name="priority">The priority for resumption in the pool.</param>
+    inline DelayAwaiter ResumeAfter(TimerWheel &timerWheel,
+                                    std::chrono::milliseconds delay,
+                                    TaskPriority priority = TaskPriority::Normal)
+    {
+        return DelayAwaiter(timerWheel, delay, priority);
+    }
+
+    /// <summary>
+    /// Awaitable for an operation that notifies its completion through a callback.
+    /// The coroutine is resumed in a thread pool, rather than in the notifying thread.
+    /// </summary>
+    template <typename SubscriberType>
+    class CompletionAwaiter
+    {
+    private:
+
+        SubscriberType m_subscriber;
+        ThreadPool &m_threadPool;
+
+    public:
+
+        CompletionAwaiter(SubscriberType &&subscriber, ThreadPool &threadPool)
+            : m_subscriber(std::move(subscriber)), m_threadPool(threadPool) {}
+
+        bool await_ready() noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            /* Once subscribed, the coroutine might be resumed (and this awaiter destroyed)
+               by another thread, so nothing in this object can be touched from then on: */
+            auto subscriber = std::move(m_subscriber);
+            auto &threadPool = m_threadPool;
+
+            subscriber(std::function<void()>([&threadPool, handle]()
+            {
+                try
+                {
+                    threadPool.Submit([handle]() { handle.resume(); });
+                }
+                catch (...)
+                {
+                    handle.resume(); // pool is no longer available
+                }
+            }));
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    /// <summary>
+    /// Awaits an operation that notifies its completion through a callback.
+    /// </summary>
+    /// <param name="subscriber">A callable that receives the callback
+    /// (std::function&lt;void()&gt;) and arranges it to be invoked upon completion.</param>
+    /// <param name="threadPool">The thread pool where the awaiting coroutine is resumed.</param>
+    template <typename SubscriberType>
+    CompletionAwaiter<std::decay_t<SubscriberType>>
+        AwaitCompletion(SubscriberType &&subscriber, ThreadPool &threadPool)
+    {
+        return CompletionAwaiter<std::decay_t<SubscriberType>>(
+            std::decay_t<SubscriberType>(std::forward<SubscriberType>(subscriber)), threadPool
+        );
+    }
+
+    /// <summary>
+    /// Awaits an operation that notifies its completion through a callback,
+    /// resuming in the framework thread pool.
+    /// </summary>
+    template <typename SubscriberType>
+    CompletionAwaiter<std::decay_t<SubscriberType>> AwaitCompletion(SubscriberType &&subscriber)
+    {
+        return AwaitCompletion(std::forward<SubscriberType>(subscriber), ThreadPool::GetInstance());
+    }
+
+    /// <summary>
+    /// Runs a task, blocking the calling thread until its completion.
+    /// </summary>
+    /// <param name="task">The task.</param>
+    /// <returns>The value produced by the task. Its exception is rethrown.</returns>
+    template <typename ValType>
+    ValType SyncWait(Task<ValType> task)
+    {
+        std::promise<ValType> promise;
+        auto future = promise.get_future();
+
+        [](Task<ValType> task, std::promise<ValType> promise) -> DetachedCoroutine
+        {
+            try
+            {
+                if constexpr (std::is_void_v<ValType>)
+                {
+                    co_await std::move(task);
+                    promise.set_value();
+                }
+                else
+                    promise.set_value(co_await std::move(task));
+            }
+            catch (...)
+            {
+                promise.set_exception(std::current_exception());
+            }
+        }(std::move(task), std::move(promise));
+
+        return future.get();
+    }
+
+    /// <summary>
+    /// Starts a task and leaves without waiting for its completion.
+    /// It runs in the calling thread until its first suspension.
+    /// </summary>
+    /// <param name="task">The task.</param>
+    /// <param name="onError">Receives the exception that escapes the task, if any.</param>
+    inline void StartDetached(Task<void> task, std::function<void(std::exception_ptr)> onError)
+    {
+        [](Task<void> task, std::function<void(std::exception_ptr)> onError) -> DetachedCoroutine
+        {
+            try
+            {
+                co_await std::move(task);
+            }
+            catch (...)
+            {
+                if (onError)
+                    onError(std::current_exception());
+            }
+        }(std::move(task), std::move(onError));
+    }
+
+} // end of namespace utils
+} // end of namespace _3fd
+
+#endif // _3FD_HAS_COROUTINES
+
+#endif // end of header guard
@@ -8,9 +8,20 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdlib>
 #include <limits>
 #include <sstream>
 
+#ifdef _3FD_PLATFORM_WIN32API
+#   include <windows.h>
+#   define _3FD_HAS_VIRTUAL_MEMORY_BACKING
+#elif !defined _WIN32
+#   include <sys/mman.h>
+#   include <unistd.h>
+#   define _3FD_HAS_VIRTUAL_MEMORY_BACKING
+#endif
+
 #undef min
 #undef max
 
@@ -19,65 +30,298 @@ namespace _3fd
 namespace utils
 {
     /// <summary>
+    /// The header placed at the base of a chunk of memory.
+    /// </summary>
+    struct DynamicMemPool::Chunk
+    {
+        MemoryPool memPool;
+        Chunk *nextAvailable;
+
+        Chunk(void *blocksBaseAddr, uint16_t numBlocks, uint16_t blockSize) noexcept
+            : memPool(blocksBaseAddr, numBlocks, blockSize)
+            , nextAvailable(nullptr)
+        {
+        }
+    };
+
+    // the size of the chunk header, keeping the blocks that follow it aligned
+    static const size_t chunkHeaderSize =
+        (sizeof(MemoryPool) + sizeof(void *) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+#ifdef _3FD_HAS_VIRTUAL_MEMORY_BACKING
+
+    // the size of a huge page in the most common platforms
+    static const size_t hugePageSize = 2 * 1024 * 1024;
+
+    /// <summary>
+    /// Gets the size of a page of virtual memory.
+    /// </summary>
+    static size_t GetPageSize() noexcept
+    {
+#   ifdef _WIN32
+        SYSTEM_INFO sysInfo;
+        GetSystemInfo(&sysInfo);
+        return sysInfo.dwPageSize;
+#   else
+        return static_cast<size_t> (sysconf(_SC_PAGESIZE));
+#   endif
+    }
+
+    /// <summary>
+    /// Maps pages of virtual memory, aligned to their total size.
+    /// </summary>
+    /// <param name="size">The size of the mapping, a power of 2 multiple of the page size.</param>
+    /// <param name="hugePages">Whether to ask for transparent huge pages.</param>
+    /// <returns>The base address of the mapped memory.</returns>
+    static void *MapAlignedPages(size_t size, bool hugePages)
+    {
+#   ifdef _WIN32
+        /* Reserve twice the size to find an aligned address, then release it and map just
+           the aligned region. Another thread might take that address in between, hence the retries. */
+        for (int attempt = 0; attempt < 8; ++attempt)
+        {
+            auto reserved = VirtualAlloc(nullptr, size * 2, MEM_RESERVE, PAGE_NOACCESS);
+            if (reserved == nullptr)
+                throw core::AppException<std::runtime_error>("Failed to reserve virtual memory for memory pool");
+
+            auto aligned = reinterpret_cast<void *> ((reinterpret_cast<uintptr_t> (reserved) + size - 1) & ~(size - 1));
+            VirtualFree(reserved, 0, MEM_RELEASE);
+
+            auto addr = VirtualAlloc(aligned, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            if (addr != nullptr)
+                return addr; // large pages require a privilege, so 'hugePages' is ignored
+        }
+
+        throw core::AppException<std::runtime_error>("Failed to map virtual memory for memory pool");
+#   else
+        // map twice the size, then trim the excess around the aligned region:
+        auto reserved = mmap(nullptr, size * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved == MAP_FAILED)
+            throw core::AppException<std::runtime_error>("Failed to map virtual memory for memory pool");
+
+        auto front = (size - (reinterpret_cast<uintptr_t> (reserved) & (size - 1))) & (size - 1);
+        auto addr = reinterpret_cast<void *> (reinterpret_cast<uintptr_t> (reserved) + front);
+
+        if (front > 0)
+            munmap(reserved, front);
+
+        munmap(reinterpret_cast<void *> (reinterpret_cast<uintptr_t> (addr) + size), size - front);
+
+#       ifdef MADV_HUGEPAGE
+        if (hugePages)
+            madvise(addr, size, MADV_HUGEPAGE); // just a hint, so failure is irrelevant
+#       endif
+        return addr;
+#   endif
+    }
+
+    /// <summary>
+    /// Unmaps pages of virtual memory.
+    /// </summary>
+    static void UnmapPages(void *addr, size_t size) noexcept
+    {
+#   ifdef _WIN32
+        VirtualFree(addr, 0, MEM_RELEASE);
+#   else
+        munmap(addr, size);
+#   endif
+    }
+
+    /// <summary>
+    /// Hands back to the system the physical memory of mapped pages, which remain mapped.
+    /// </summary>
+    static void DiscardPages(void *addr, size_t size) noexcept
+    {
+#   ifdef _WIN32
+        VirtualAlloc(addr, size, MEM_RESET, PAGE_READWRITE);
+#   else
+        madvise(addr, size, MADV_DONTNEED);
+#   endif
+    }
+
+#endif // _3FD_HAS_VIRTUAL_MEMORY_BACKING
+
     /// <summary>
     /// Initializes a new instance of the <see cref="DynamicMemPool"/> class.
     /// </summary>
     /// <param name="initialSize">The initial size.</param>
     /// <param name="blockSize">Size of the block.</param>
     /// <param name="growingFactor">The factor for growing size of the pool.</param>
-    DynamicMemPool::DynamicMemPool(uint16_t initialSize, uint16_t blockSize, float growingFactor) :
+    /// <param name="backing">Where memory comes from. Backing by virtual memory
+    /// falls back to the heap in platforms that do not support it.</param>
+    /// <remarks>
+    /// The amount of blocks in a chunk is rounded up, so as to fill the power of 2 size of the chunk.
+    /// </remarks>
+    DynamicMemPool::DynamicMemPool(uint16_t initialSize,
+                                   uint16_t blockSize,
+                                   float growingFactor,
+                                   MemoryBacking backing) :
         m_initialSize(initialSize),
-        m_blockSize(blockSize),
-        m_growingFactor(growingFactor)
+        m_blockSize(blockSize > sizeof(void *) ? blockSize : static_cast<uint16_t> (sizeof(void *))),
+        m_growingFactor(growingFactor),
+#ifdef _3FD_HAS_VIRTUAL_MEMORY_BACKING
+        m_backing(backing),
+#else
+        m_backing(MemoryBacking::Heap),
+#endif
+        m_chunkSize(0),
+        m_numBlocksPerChunk(0),
+        m_availableChunks(nullptr),
+        m_numBlocksInUse(0),
+        m_numBlocksInUseHighWaterMark(0),
+        m_numAllocations(0),
+        m_numDeallocations(0)
     {
+        static_assert(sizeof(Chunk) <= chunkHeaderSize, "chunk header does not fit in the reserved space");
+
         _ASSERTE(initialSize * blockSize > 0); // The object pool cannot start zero-sized
         _ASSERTE(growingFactor > 0); // The increasing factor must be a positive number
+
+        // all chunks have the same size, so the largest request dictates it:
+        auto numBlocks = std::max(static_cast<size_t> (m_initialSize),
+                                  std::min(static_cast<size_t> (m_initialSize * m_growingFactor),
+                                           static_cast<size_t> (std::numeric_limits<uint16_t>::max())));
+
+        auto minChunkSize = chunkHeaderSize + numBlocks * m_blockSize;
+
+        switch (m_backing)
+        {
+#ifdef _3FD_HAS_VIRTUAL_MEMORY_BACKING
+        case MemoryBacking::VirtualMemory:
+            m_chunkSize = GetPageSize();
+            break;
+        case MemoryBacking::HugePages:
+            m_chunkSize = std::max(GetPageSize(), hugePageSize);
+            break;
+#endif
+        default:
+            m_chunkSize = alignof(std::max_align_t);
+            break;
+        }
+
+        while (m_chunkSize < minChunkSize)
+            m_chunkSize <<= 1;
+
+        m_numBlocksPerChunk = static_cast<uint16_t> (
+            std::min((m_chunkSize - chunkHeaderSize) / m_blockSize,
+                     static_cast<size_t> (std::numeric_limits<uint16_t>::max()))
+        );
     }
 
     /// <summary>
-    /// Gets the free block.
+    /// Finalizes an instance of the <see cref="DynamicMemPool"/> class.
     /// </summary>
-    /// <returns></returns>
-    void * DynamicMemPool::GetFreeBlock()
+    DynamicMemPool::~DynamicMemPool()
     {
-        // are there memory pools with available memory?
-        if (!m_availableMemPools.empty())
-        {
-            auto memPool = m_availableMemPools.front();
-            auto addr = memPool->GetFreeBlock();
+        for (auto chunk : m_chunks)
+            ReleaseChunk(chunk);
+    }
 
-            if (addr != nullptr)
-                return addr;
-            else
-            {
-                m_availableMemPools.pop();
-                return GetFreeBlock(); // tail recursion
-            }
-        }
+    /// <summary>
+    /// Allocates a new chunk of memory, aligned to its own size.
+    /// </summary>
+    /// <returns>The header of the new chunk.</returns>
+    DynamicMemPool::Chunk * DynamicMemPool::AllocateChunk()
+    {
+        m_chunks.reserve(m_chunks.size() + 1);
 
-        // there is no memory available in the existent pools, so create a new one:
+        void *baseAddr;
 
-        uint16_t initNumBlocks;
-        
-        if (!m_memPools.empty())
+#ifdef _3FD_HAS_VIRTUAL_MEMORY_BACKING
+        if (m_backing != MemoryBacking::Heap)
         {
-            initNumBlocks = static_cast<uint16_t> (
-                std::min(static_cast<size_t> (m_initialSize * m_growingFactor),
-                         static_cast<size_t> (std::numeric_limits<uint16_t>::max()))
-            );
+            baseAddr = MapAlignedPages(m_chunkSize, m_backing == MemoryBacking::HugePages);
         }
         else
-            initNumBlocks = m_initialSize;
+#endif
+        {
+#    ifdef _WIN32
+            baseAddr = _aligned_malloc(m_chunkSize, m_chunkSize);
+#    else
+            baseAddr = aligned_alloc(m_chunkSize, m_chunkSize);
+#    endif
+            if (baseAddr == nullptr)
+                throw core::AppException<std::runtime_error>("Failed to allocate memory for memory pool");
+        }
+
+        auto chunk = new (baseAddr) Chunk(
+            reinterpret_cast<void *> (reinterpret_cast<uintptr_t> (baseAddr) + chunkHeaderSize),
+            m_numBlocksPerChunk,
+            m_blockSize
+        );
+
+        m_chunks.push_back(chunk);
+        return chunk;
+    }
+
+    /// <summary>
+    /// Releases the memory of a chunk.
+    /// </summary>
+    /// <param name="chunk">The chunk header.</param>
+    void DynamicMemPool::ReleaseChunk(Chunk *chunk) noexcept
+    {
+        chunk->~Chunk();
+
+#ifdef _3FD_HAS_VIRTUAL_MEMORY_BACKING
+        if (m_backing != MemoryBacking::Heap)
+        {
+            UnmapPages(chunk, m_chunkSize);
+            return;
+        }
+#endif
+
+#    ifdef _WIN32
+        _aligned_free(chunk);
+#    else
+        free(chunk);
+#    endif
+    }
+
+    /// <summary>
+    /// Compacts the memory pool of a chunk, and hands back to the system the
+    /// physical memory of the pages past the region in use. No-op for heap backing.
+    /// </summary>
+    /// <param name="chunk">The chunk header.</param>
+    void DynamicMemPool::ReleaseUnusedPages(Chunk *chunk)
+    {
+#ifdef _3FD_HAS_VIRTUAL_MEMORY_BACKING
+        if (m_backing == MemoryBacking::Heap)
+            return;
 
-        MemoryPool memPool(initNumBlocks, m_blockSize);
+        static const size_t pageSize = GetPageSize();
 
-        auto addr = memPool.GetFreeBlock();
+        auto unusedAddr = (reinterpret_cast<uintptr_t> (chunk->memPool.Compact()) + pageSize - 1) & ~(pageSize - 1);
+        auto chunkEnd = reinterpret_cast<uintptr_t> (chunk) + m_chunkSize;
 
-        auto &movedMemPool = m_memPools.insert(
-            std::make_pair(addr, std::move(memPool))
-        ).first->second;
+        if (unusedAddr < chunkEnd)
+            DiscardPages(reinterpret_cast<void *> (unusedAddr), chunkEnd - unusedAddr);
+#endif
+    }
+
+    /// <summary>
+    /// Gets the free block.
+    /// </summary>
+    /// <returns></returns>
+    void * DynamicMemPool::GetFreeBlock()
+    {
+        // no memory available in the existent chunks, so create a new one:
+        if (m_availableChunks == nullptr)
+            m_availableChunks = AllocateChunk();
+
+        auto chunk = m_availableChunks;
+        auto addr = chunk->memPool.GetFreeBlock();
+        _ASSERTE(addr != nullptr);
 
-        m_availableMemPools.push(&movedMemPool); // make the new memory pool available
+        // take out of the list the chunk that runs out of memory:
+        if (chunk->memPool.IsEmpty())
+        {
+            m_availableChunks = chunk->nextAvailable;
+            chunk->nextAvailable = nullptr;
+        }
+
+        ++m_numAllocations;
+        if (++m_numBlocksInUse > m_numBlocksInUseHighWaterMark)
+            m_numBlocksInUseHighWaterMark = m_numBlocksInUse;
 
         return addr;
     }
@@ -88,60 +332,79 @@ namespace utils
     /// <param name="object">The address of the object to return.</param>
     void DynamicMemPool::ReturnBlock(void *object)
     {
-        // Finds the corresponding memory pool
-        auto iter = m_memPools.upper_bound(object);
-
-        _ASSERTE(iter != m_memPools.begin()); // Cannot return a memory block which does not belong to the pool
-
-        auto &memPool = (--iter)->second;
+        // Finds the corresponding chunk
+        auto chunk = reinterpret_cast<Chunk *> (reinterpret_cast<uintptr_t> (object) & ~(m_chunkSize - 1));
 
-        _ASSERTE(memPool.Contains(object)); // Cannot return a memory block which does not belong to the pool
+        _ASSERTE(chunk->memPool.Contains(object)); // Cannot return a memory block which does not belong to the pool
 
-        // If the corresponding memory pool was empty:
-        if (memPool.IsEmpty())
+        // If the chunk was empty, it becomes available again:
+        if (chunk->memPool.IsEmpty())
         {
-            m_availableMemPools.push(&memPool); // mark the pool as 'available' (not empty / with available memory)
-
-            // The empty memory pool might have already been in the queue (front element):
-            if (m_availableMemPools.front() == &memPool)
-                m_availableMemPools.pop();
+            chunk->nextAvailable = m_availableChunks;
+            m_availableChunks = chunk;
         }
 
-        memPool.ReturnBlock(object); // returns the memory to the pool
+        chunk->memPool.ReturnBlock(object); // returns the memory to the pool
+
+        ++m_numDeallocations;
+        --m_numBlocksInUse;
     }
 
     /// <summary>
     /// Shrinks the set of memory pools releasing the resources of the pools which are full.
+    /// When backed by virtual memory, partially used chunks also hand back their unused pages.
     /// </summary>
     void DynamicMemPool::Shrink()
     {
-        std::vector<MemoryPool *> toBeDeleted;
+        m_availableChunks = nullptr;
 
-        toBeDeleted.reserve(m_availableMemPools.size());
+        // release the chunks that are full:
+        m_chunks.erase(
+            std::remove_if(m_chunks.begin(), m_chunks.end(), [this](Chunk *chunk)
+            {
+                if (!chunk->memPool.IsFull())
+                    return false;
 
-        // Scan the queue and hold the pointers to the pool objects that are full:
-        for (auto count = m_availableMemPools.size(); count > 0; --count)
-        {
-            auto memPool = m_availableMemPools.front();
+                ReleaseChunk(chunk);
+                return true;
+            }),
+            m_chunks.end()
+        );
 
-            if (memPool->IsFull())
+        // rebuild the list with the chunks that have available memory:
+        for (auto chunk : m_chunks)
+        {
+            if (!chunk->memPool.IsEmpty())
             {
-                m_availableMemPools.pop();
-                toBeDeleted.push_back(memPool);
+                chunk->nextAvailable = m_availableChunks;
+                m_availableChunks = chunk;
             }
             else
-            {
-                m_availableMemPools.pop();
-                m_availableMemPools.push(memPool);
-            }
+                chunk->nextAvailable = nullptr;
         }
 
-        // Delete the pool objects that were found full:
-        for (auto memPool : toBeDeleted)
+        for (auto chunk = m_availableChunks; chunk != nullptr; chunk = chunk->nextAvailable)
+            ReleaseUnusedPages(chunk);
+    }
+
+    /// <summary>
+    /// Gets the statistics of the pool.
+    /// </summary>
+    /// <returns>The current statistics.</returns>
+    MemPoolStats DynamicMemPool::GetStats() const noexcept
+    {
+        MemPoolStats stats;
+        stats.numChunks = m_chunks.size();
+        stats.numFullyFreeChunks = std::count_if(m_chunks.begin(), m_chunks.end(), [](Chunk *chunk)
         {
-            auto iter = m_memPools.find(memPool->GetBaseAddress());
-            m_memPools.erase(iter);
-        }
+            return chunk->memPool.IsFull();
+        });
+        stats.numBytesReserved = m_chunks.size() * m_chunkSize;
+        stats.numBytesInUse = m_numBlocksInUse * m_blockSize;
+        stats.numBytesInUseHighWaterMark = m_numBlocksInUseHighWaterMark * m_blockSize;
+        stats.numAllocations = m_numAllocations;
+        stats.numDeallocations = m_numDeallocations;
+        return stats;
     }
 
 } // end of namespace utils
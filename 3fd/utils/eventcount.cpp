@@ -0,0 +1,139 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include "concurrency.h"
+
+#include <cassert>
+#include <chrono>
+#include <climits>
+
+#ifdef __linux__
+#   include <linux/futex.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#   include <ctime>
+#endif
+
+namespace _3fd
+{
+namespace utils
+{
+#ifdef __linux__
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(int),
+                  "futex requires the epoch of the event count to be a plain 32-bit integer");
+
+    /// <summary>
+    /// Blocks the calling thread while the value at the given address is the expected one.
+    /// </summary>
+    /// <param name="addr">The address of the futex.</param>
+    /// <param name="expected">The expected value.</param>
+    /// <param name="timeout">The relative timeout, or a null pointer to wait indefinitely.</param>
+    static void FutexWait(std::atomic<uint32_t> *addr, uint32_t expected, const timespec *timeout) noexcept
+    {
+        syscall(SYS_futex, reinterpret_cast<int *> (addr), FUTEX_WAIT_PRIVATE, static_cast<int> (expected), timeout, nullptr, 0);
+    }
+
+    /// <summary>
+    /// Wakes threads blocked in the futex at the given address.
+    /// </summary>
+    /// <param name="addr">The address of the futex.</param>
+    /// <param name="count">How many threads to wake.</param>
+    static void FutexWake(std::atomic<uint32_t> *addr, int count) noexcept
+    {
+        syscall(SYS_futex, reinterpret_cast<int *> (addr), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    }
+#endif
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="EventCount"/> class.
+    /// </summary>
+    EventCount::EventCount()
+        : m_epoch(0)
+        , m_numWaiters(0)
+    {
+    }
+
+    /// <summary>
+    /// Advances the epoch and wakes the threads blocked in it.
+    /// </summary>
+    /// <param name="all">Whether all blocked threads should be woken, rather than a single one.
+    /// (Blocked threads not woken remain so until the next notification.)</param>
+    void EventCount::WakeWaiters(bool all) noexcept
+    {
+#ifdef __linux__
+        m_epoch.fetch_add(1, std::memory_order_acq_rel);
+        FutexWake(&m_epoch, all ? INT_MAX : 1);
+#else
+        {// the increment must happen inside the lock, otherwise the waiter might miss it
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_epoch.fetch_add(1, std::memory_order_acq_rel);
+        }
+
+        if (all)
+            m_condition.notify_all();
+        else
+            m_condition.notify_one();
+#endif
+    }
+
+    /// <summary>
+    /// Blocks until a notification happens after <see cref="PrepareWait"/> was called.
+    /// </summary>
+    /// <param name="key">The key returned by <see cref="PrepareWait"/>.</param>
+    void EventCount::Wait(Key key) noexcept
+    {
+#ifdef __linux__
+        while (m_epoch.load(std::memory_order_acquire) == key)
+            FutexWait(&m_epoch, key, nullptr);
+#else
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this, key]()
+        {
+            return m_epoch.load(std::memory_order_acquire) != key;
+        });
+#endif
+        m_numWaiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    /// <summary>
+    /// Blocks until a notification happens after <see cref="PrepareWait"/> was called,
+    /// or the timeout expires.
+    /// </summary>
+    /// <param name="key">The key returned by <see cref="PrepareWait"/>.</param>
+    /// <param name="millisecs">The timeout in milliseconds.</param>
+    /// <returns>'true' if notified, 'false' if a timeout happens first.</returns>
+    bool EventCount::WaitFor(Key key, unsigned long millisecs) noexcept
+    {
+        using namespace std::chrono;
+
+        bool notified;
+#ifdef __linux__
+        auto deadline = steady_clock::now() + milliseconds(millisecs);
+
+        while (!(notified = (m_epoch.load(std::memory_order_acquire) != key)))
+        {
+            auto remaining = duration_cast<nanoseconds>(deadline - steady_clock::now()).count();
+            if (remaining <= 0)
+                break;
+
+            timespec timeout;
+            timeout.tv_sec = static_cast<time_t> (remaining / 1000000000LL);
+            timeout.tv_nsec = static_cast<long> (remaining % 1000000000LL);
+            FutexWait(&m_epoch, key, &timeout);
+        }
+#else
+        std::unique_lock<std::mutex> lock(m_mutex);
+        notified = m_condition.wait_for(lock, milliseconds(millisecs), [this, key]()
+        {
+            return m_epoch.load(std::memory_order_acquire) != key;
+        });
+#endif
+        m_numWaiters.fetch_sub(1, std::memory_order_seq_cst);
+        return notified;
+    }
+
+} // end of namespace utils
+} // end of namespace _3fd
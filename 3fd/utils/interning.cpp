@@ -0,0 +1,136 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include "interning.h"
+#include <3fd/core/exceptions.h>
+
+#include <cassert>
+#include <cstring>
+#include <sstream>
+
+#undef max
+
+namespace _3fd
+{
+namespace utils
+{
+    /// <summary>
+    /// Initializes a new instance of the <see cref="StringInterner"/> class.
+    /// </summary>
+    StringInterner::StringInterner()
+        : m_chunkCursor(nullptr)
+        , m_chunkRemaining(0)
+        , m_lastId(0)
+    {
+    }
+
+    /// <summary>
+    /// Gets the global instance of the interner.
+    /// </summary>
+    StringInterner &StringInterner::GetInstance()
+    {
+        static StringInterner instance;
+        return instance;
+    }
+
+    /// <summary>
+    /// Allocates room in the arena for an entry (whose characters follow the header).
+    /// Must be called holding the lock of the arena.
+    /// </summary>
+    /// <param name="length">The length of the string.</param>
+    /// <returns>The allocated entry, already identified.</returns>
+    InternedString::Entry *StringInterner::AllocateEntry(size_t length)
+    {
+        if (length > UINT32_MAX - 1)
+            throw core::AppException<std::length_error>("Failed to intern string: it is too long!");
+
+        // keep the entries aligned:
+        const size_t alignment = alignof(InternedString::Entry);
+        const size_t numBytes = (sizeof(InternedString::Entry) + length + 1 + alignment - 1) & ~(alignment - 1);
+
+        if (numBytes > m_chunkRemaining)
+        {
+            // large strings take a chunk of their own, so the current one can still be used:
+            if (numBytes > chunkSize / 4)
+            {
+                m_chunks.push_back(std::unique_ptr<char[]>(dbg_new char[numBytes]));
+                return reinterpret_cast<InternedString::Entry *> (m_chunks.back().get());
+            }
+
+            m_chunks.push_back(std::unique_ptr<char[]>(dbg_new char[chunkSize]));
+            m_chunkCursor = m_chunks.back().get();
+            m_chunkRemaining = chunkSize;
+        }
+
+        auto entry = reinterpret_cast<InternedString::Entry *> (m_chunkCursor);
+        m_chunkCursor += numBytes;
+        m_chunkRemaining -= numBytes;
+        return entry;
+    }
+
+    /// <summary>
+    /// Interns a string.
+    /// </summary>
+    /// <param name="str">The string to intern.</param>
+    /// <returns>The one copy of the string held by this interner.</returns>
+    InternedString StringInterner::Intern(std::string_view str)
+    {
+        const InternedString::Entry *entry;
+        if (m_index.Find(str, entry))
+            return InternedString(entry);
+
+        try
+        {
+            std::lock_guard<std::mutex> lock(m_arenaMutex);
+
+            // someone else might have interned the same string meanwhile:
+            if (m_index.Find(str, entry))
+                return InternedString(entry);
+
+            auto newEntry = AllocateEntry(str.size());
+            newEntry->id = ++m_lastId;
+            newEntry->length = static_cast<uint32_t> (str.size());
+
+            auto data = const_cast<char *> (newEntry->data());
+            memcpy(data, str.data(), str.size());
+            data[str.size()] = 0;
+
+            // the key refers to the copy in the arena:
+            m_index.Insert(std::string_view(data, str.size()), newEntry);
+            return InternedString(newEntry);
+        }
+        catch (core::IAppException &)
+        {
+            throw; // just forward exceptions regarding errors known to have been already handled
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to acquire lock when interning string: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::bad_alloc &)
+        {
+            throw core::AppException<std::runtime_error>("Failed to allocate memory when interning string");
+        }
+    }
+
+    /// <summary>
+    /// Finds a string among those already interned, without interning it.
+    /// </summary>
+    /// <param name="str">The string to look for.</param>
+    /// <returns>The interned string, or null if not found.</returns>
+    InternedString StringInterner::Find(std::string_view str) const
+    {
+        const InternedString::Entry *entry;
+        if (m_index.Find(str, entry))
+            return InternedString(entry);
+
+        return InternedString();
+    }
+
+}// end of namespace utils
+}// end of namespace _3fd
@@ -0,0 +1,159 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#ifndef UTILS_INTERNING_H // header guard
+#define UTILS_INTERNING_H
+
+#include <3fd/utils/concurrenthashmap.h>
+#include <3fd/utils/text.h>
+
+#include <cinttypes>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace _3fd
+{
+namespace utils
+{
+    /// <summary>
+    /// A string interned by <see cref="StringInterner"/>: there is only one copy of each
+    /// distinct string, so equality is tested in constant time, and a copy of this object
+    /// is as cheap as a pointer. The string lives until the end of the program.
+    /// </summary>
+    class InternedString
+    {
+    public:
+
+        // header of an interned string in the arena, followed by its (null terminated) characters
+        struct Entry
+        {
+            uint32_t id;
+            uint32_t length;
+
+            const char *data() const noexcept
+            {
+                return reinterpret_cast<const char *> (this + 1);
+            }
+        };
+
+    private:
+
+        friend class StringInterner;
+
+        const Entry *m_entry;
+
+        explicit InternedString(const Entry *entry) noexcept
+            : m_entry(entry) {}
+
+    public:
+
+        /// <summary>
+        /// Initializes a new (null) instance of the <see cref="InternedString"/> class.
+        /// </summary>
+        InternedString() noexcept
+            : m_entry(nullptr) {}
+
+        // Interns a string (in the global interner)
+        InternedString(std::string_view str);
+
+        InternedString(const char *str)
+            : InternedString(std::string_view(str)) {}
+
+        InternedString(const std::string &str)
+            : InternedString(std::string_view(str)) {}
+
+        bool null() const noexcept { return m_entry == nullptr; }
+
+        /// <summary>
+        /// Gets the unique identifier of the string in the interner (zero if null).
+        /// </summary>
+        uint32_t id() const noexcept { return m_entry != nullptr ? m_entry->id : 0; }
+
+        const char *c_str() const noexcept { return m_entry != nullptr ? m_entry->data() : nullptr; }
+
+        std::string_view str() const noexcept
+        {
+            return m_entry != nullptr ? std::string_view(m_entry->data(), m_entry->length) : std::string_view();
+        }
+
+        CStringViewUtf8 view() const noexcept
+        {
+            return m_entry != nullptr ? CStringViewUtf8(m_entry->data(), m_entry->length) : CStringViewUtf8("", 0U);
+        }
+
+        bool operator==(InternedString other) const noexcept { return m_entry == other.m_entry; }
+
+        bool operator!=(InternedString other) const noexcept { return m_entry != other.m_entry; }
+
+        // order of interning (not alphabetical)
+        bool operator<(InternedString other) const noexcept { return id() < other.id(); }
+    };
+
+    /// <summary>
+    /// Keeps a single copy of each distinct string in an append-only arena.
+    /// Lookups take no lock, while a string seen for the first time is
+    /// interned under a lock. It is safe for concurrent access. Because nothing
+    /// is ever freed, only names that come from code should be interned, never
+    /// strings from untrusted input (such as documents or ad hoc queries).
+    /// </summary>
+    class StringInterner
+    {
+    private:
+
+        static constexpr size_t chunkSize = 64 * 1024;
+
+        ConcurrentHashMap<std::string_view, const InternedString::Entry *> m_index;
+
+        std::mutex m_arenaMutex;
+        std::vector<std::unique_ptr<char[]>> m_chunks;
+        char *m_chunkCursor;
+        size_t m_chunkRemaining;
+        uint32_t m_lastId;
+
+        InternedString::Entry *AllocateEntry(size_t length);
+
+    public:
+
+        StringInterner();
+
+        StringInterner(const StringInterner &) = delete;
+
+        InternedString Intern(std::string_view str);
+
+        InternedString Find(std::string_view str) const;
+
+        /// <summary>
+        /// Gets how many distinct strings have been interned.
+        /// </summary>
+        size_t GetNumStrings() const noexcept { return m_index.GetSize(); }
+
+        static StringInterner &GetInstance();
+    };
+
+    inline InternedString::InternedString(std::string_view str)
+        : m_entry(StringInterner::GetInstance().Intern(str).m_entry)
+    {
+    }
+
+}// end of namespace utils
+}// end of namespace _3fd
+
+namespace std
+{
+    template <>
+    struct hash<_3fd::utils::InternedString>
+    {
+        size_t operator()(_3fd::utils::InternedString str) const noexcept
+        {
+            return str.id();
+        }
+    };
+}
+
+#endif // end of header guard
@@ -7,13 +7,16 @@
 #define UTILS_LOCKFREEQUEUE_H
 
 #include <3fd/core/preprocessing.h>
+#include <3fd/utils/concurrency.h>
 
 #include <functional>
+#include <cstdint>
 #include <memory>
 #include <atomic>
 #include <mutex>
 #include <vector>
 #include <queue>
+#include <type_traits>
 
 #ifdef _WIN32
 #   ifdef _3FD_PLATFORM_WINRT
@@ -48,6 +51,9 @@ namespace utils
         std::atomic<Element *> m_head;
         std::atomic<Element *> m_tail;
 
+        EventCount m_eventCount;
+        std::atomic<bool> m_waitInterrupted;
+
     public:
 
         /// <summary>
@@ -55,6 +61,7 @@ namespace utils
         /// The initialization of this instance is NOT THREAD-SAFE.
         /// </summary>
         LockFreeQueue()
+            : m_waitInterrupted(false)
         {
             auto emptyElem = dbg_new Element();
             m_tail.store(emptyElem, std::memory_order_relaxed);
@@ -94,6 +101,8 @@ namespace utils
             auto newElem = dbg_new Element(entry);
             auto headBefore = m_head.exchange(newElem, std::memory_order_acq_rel);
             headBefore->next.store(newElem, std::memory_order_release);
+
+            m_eventCount.Notify(); // wakes the consumer, if blocked
         }
 
         /// <summary>
@@ -132,6 +141,78 @@ namespace utils
             }
         }
 
+        /// <summary>
+        /// Removes from the tail all the entries that are available at the moment of the
+        /// call (but no more than the given maximum), invoking a callback for each of them
+        /// in FIFO order. The position of the head is read only once, hence entries added
+        /// by producers in the meantime are left for the next call.
+        /// </summary>
+        /// <param name="callback">
+        /// The callback to invoke for each entry, taking ownership of it.
+        /// </param>
+        /// <param name="maxCount">The maximum amount of entries to remove.</param>
+        /// <returns>How many entries were removed from the queue.</returns>
+        template <typename CallbackType>
+        size_t ForEachDrained(CallbackType &&callback,
+                              size_t maxCount = SIZE_MAX)
+        {
+            // the snapshot of the head is the single synchronization point with the producers
+            auto last = m_head.load(std::memory_order_acquire);
+            auto tail = m_tail.load(std::memory_order_relaxed);
+
+            size_t count(0);
+            while (count < maxCount)
+            {
+                /* Stop at the head of the snapshot, or if a producer has not yet linked
+                the next element. Either way, keep the tail, but consume the value: */
+                auto next = (tail != last) ? tail->next.load(std::memory_order_acquire) : nullptr;
+                if (next == nullptr)
+                {
+                    // this can be null if already consumed before
+                    auto value = tail->value.exchange(nullptr, std::memory_order_relaxed);
+                    if (value != nullptr)
+                    {
+                        ++count;
+                        callback(value);
+                    }
+
+                    break;
+                }
+
+                auto value = tail->value.load(std::memory_order_relaxed);
+                delete tail;
+                tail = next;
+                m_tail.store(tail, std::memory_order_relaxed); // move tail before callback might throw
+
+                // this value can be null if already consumed before
+                if (value != nullptr)
+                {
+                    ++count;
+                    callback(value);
+                }
+            }
+
+            return count;
+        }
+
+        /// <summary>
+        /// Removes from the tail all the entries that are available at the moment of
+        /// the call (but no more than the given maximum), moving them in FIFO order
+        /// to the back of a container.
+        /// </summary>
+        /// <param name="container">
+        /// The container to receive the entries, such as a vector of
+        /// plain or unique pointers. It takes ownership of the entries.
+        /// </param>
+        /// <param name="maxCount">The maximum amount of entries to remove.</param>
+        /// <returns>How many entries were removed from the queue.</returns>
+        template <typename ContainerType>
+        size_t DrainTo(ContainerType &container,
+                       size_t maxCount = SIZE_MAX)
+        {
+            return ForEachDrained([&container](Type *entry) { container.emplace_back(entry); }, maxCount);
+        }
+
         /// <summary>
         /// Determines whether the queue is empty.
         /// </summary>
@@ -145,8 +226,311 @@ namespace utils
             auto head = m_head.load(std::memory_order_acquire);
             return tail == head && value == nullptr;
         }
+
+        /// <summary>
+        /// Blocks the consumer until the queue has entries or the wait gets interrupted.
+        /// </summary>
+        /// <returns>
+        /// <c>true</c> when the queue has entries, otherwise (interrupted), <c>false</c>.
+        /// </returns>
+        bool WaitForEntries() noexcept
+        {
+            while (true)
+            {
+                auto key = m_eventCount.PrepareWait();
+
+                if (m_waitInterrupted.load(std::memory_order_acquire))
+                {
+                    m_eventCount.CancelWait();
+                    return false;
+                }
+
+                if (!IsEmpty())
+                {
+                    m_eventCount.CancelWait();
+                    return true;
+                }
+
+                m_eventCount.Wait(key);
+            }
+        }
+
+        /// <summary>
+        /// Interrupts the wait of the consumer for entries. After this call,
+        /// <see cref="WaitForEntries"/> no longer blocks, so that the consumer
+        /// is able to get the remaining entries and finish.
+        /// </summary>
+        void InterruptWait() noexcept
+        {
+            m_waitInterrupted.store(true, std::memory_order_release);
+            m_eventCount.Notify();
+        }
     };
 
+    /// <summary>
+    /// Implements a bounded queue (ring buffer) for a single writer and a single
+    /// consumer, which exposes the same interface of <see cref="LockFreeQueue{Type}"/>,
+    /// but whose operations <see cref="TryAdd"/> and <see cref="Remove"/> are wait-free.
+    /// </summary>
+    template<typename Type>
+    class SpscRingQueue
+    {
+    private:
+
+        // Written by the producer only:
+        alignas(cacheLineSize) std::atomic<size_t> m_head;
+        size_t m_tailCache; // last seen position of the tail, so as to avoid touching the consumer cache line
+
+        // Written by the consumer only:
+        alignas(cacheLineSize) std::atomic<size_t> m_tail;
+        size_t m_headCache; // last seen position of the head, so as to avoid touching the producer cache line
+
+        alignas(cacheLineSize) const size_t m_capacity;
+        std::unique_ptr<Type *[]> m_slots;
+
+        EventCount m_notEmptyEventCount;
+        EventCount m_notFullEventCount;
+        std::atomic<bool> m_waitInterrupted;
+
+        static size_t RoundUpToPowerOf2(size_t value)
+        {
+            size_t result(1);
+            while (result < value)
+                result <<= 1;
+
+            return result;
+        }
+
+        Type *&SlotAt(size_t position) noexcept
+        {
+            return m_slots[position & (m_capacity - 1)];
+        }
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="SpscRingQueue{Type}"/> class.
+        /// The initialization of this instance is NOT THREAD-SAFE.
+        /// </summary>
+        /// <param name="capacity">
+        /// The capacity of the queue, which is rounded up to a power of 2.
+        /// </param>
+        SpscRingQueue(size_t capacity = 4096)
+            : m_head(0)
+            , m_tailCache(0)
+            , m_tail(0)
+            , m_headCache(0)
+            , m_capacity(RoundUpToPowerOf2(capacity))
+            , m_slots(dbg_new Type *[RoundUpToPowerOf2(capacity)])
+            , m_waitInterrupted(false)
+        {
+        }
+
+        SpscRingQueue(const SpscRingQueue &) = delete;
+
+        /// <summary>
+        /// Finalizes an instance of the <see cref="SpscRingQueue{Type}"/> class.
+        /// The destruction of this instance is NOT THREADSAFE.
+        /// </summary>
+        ~SpscRingQueue()
+        {
+            // Clears all the elements from the queue:
+            auto head = m_head.load(std::memory_order_acquire);
+            for (auto tail = m_tail.load(std::memory_order_relaxed); tail != head; ++tail)
+                delete SlotAt(tail);
+        }
+
+        /// <summary>
+        /// Gets the capacity of the queue.
+        /// </summary>
+        size_t GetCapacity() const noexcept { return m_capacity; }
+
+        /// <summary>
+        /// Attempts to add a new entry to the queue head. Only the producer may call it.
+        /// </summary>
+        /// <param name="entry">The entry to insert.</param>
+        /// <returns><c>true</c> if added, or <c>false</c> if the queue was full.</returns>
+        bool TryAdd(Type *entry) noexcept
+        {
+            auto head = m_head.load(std::memory_order_relaxed);
+
+            if (head - m_tailCache == m_capacity)
+            {
+                m_tailCache = m_tail.load(std::memory_order_acquire);
+                if (head - m_tailCache == m_capacity)
+                    return false;
+            }
+
+            SlotAt(head) = entry;
+            m_head.store(head + 1, std::memory_order_release);
+
+            m_notEmptyEventCount.Notify(); // wakes the consumer, if blocked
+            return true;
+        }
+
+        /// <summary>
+        /// Adds a new entry to the queue head. Only the producer may call it.
+        /// When the queue is full, it blocks until the consumer frees some room.
+        /// </summary>
+        /// <param name="entry">The entry to insert.</param>
+        void Add(Type *entry) noexcept
+        {
+            while (!TryAdd(entry))
+            {
+                auto key = m_notFullEventCount.PrepareWait();
+
+                if (m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_acquire) < m_capacity)
+                    m_notFullEventCount.CancelWait();
+                else
+                    m_notFullEventCount.Wait(key);
+            }
+        }
+
+        /// <summary>
+        /// Removes an entry from the tail of the queue. Only the consumer may call it.
+        /// </summary>
+        /// <returns>
+        /// The value removed from the tail, or a null pointer when none found.
+        /// </returns>
+        Type *Remove() noexcept
+        {
+            auto tail = m_tail.load(std::memory_order_relaxed);
+
+            if (tail == m_headCache)
+            {
+                m_headCache = m_head.load(std::memory_order_acquire);
+                if (tail == m_headCache)
+                    return nullptr;
+            }
+
+            auto value = SlotAt(tail);
+            m_tail.store(tail + 1, std::memory_order_release);
+
+            m_notFullEventCount.Notify(); // wakes the producer, if blocked
+            return value;
+        }
+
+        /// <summary>
+        /// Removes from the tail all the entries that are available at the moment of the
+        /// call (but no more than the given maximum), invoking a callback for each of them
+        /// in FIFO order. Only the consumer may call it.
+        /// </summary>
+        /// <param name="callback">
+        /// The callback to invoke for each entry, taking ownership of it.
+        /// </param>
+        /// <param name="maxCount">The maximum amount of entries to remove.</param>
+        /// <returns>How many entries were removed from the queue.</returns>
+        template <typename CallbackType>
+        size_t ForEachDrained(CallbackType &&callback, size_t maxCount = SIZE_MAX)
+        {
+            auto tail = m_tail.load(std::memory_order_relaxed);
+            m_headCache = m_head.load(std::memory_order_acquire);
+
+            size_t count(0);
+            try
+            {
+                while (tail != m_headCache && count < maxCount)
+                {
+                    auto value = SlotAt(tail);
+                    m_tail.store(++tail, std::memory_order_release); // move tail before callback might throw
+                    ++count;
+                    callback(value);
+                }
+            }
+            catch (...)
+            {
+                m_notFullEventCount.Notify();
+                throw;
+            }
+
+            if (count > 0)
+                m_notFullEventCount.Notify(); // wakes the producer, if blocked
+
+            return count;
+        }
+
+        /// <summary>
+        /// Removes from the tail all the entries that are available at the moment of
+        /// the call (but no more than the given maximum), moving them in FIFO order
+        /// to the back of a container. Only the consumer may call it.
+        /// </summary>
+        /// <param name="container">
+        /// The container to receive the entries, such as a vector of
+        /// plain or unique pointers. It takes ownership of the entries.
+        /// </param>
+        /// <param name="maxCount">The maximum amount of entries to remove.</param>
+        /// <returns>How many entries were removed from the queue.</returns>
+        template <typename ContainerType>
+        size_t DrainTo(ContainerType &container, size_t maxCount = SIZE_MAX)
+        {
+            return ForEachDrained([&container](Type *entry) { container.emplace_back(entry); }, maxCount);
+        }
+
+        /// <summary>
+        /// Determines whether the queue is empty.
+        /// </summary>
+        /// <returns>
+        /// <c>true</c> when the queue is empty, otherwise, <c>false</c>.
+        /// </returns>
+        bool IsEmpty() const noexcept
+        {
+            return m_tail.load(std::memory_order_relaxed) == m_head.load(std::memory_order_acquire);
+        }
+
+        /// <summary>
+        /// Blocks the consumer until the queue has entries or the wait gets interrupted.
+        /// </summary>
+        /// <returns>
+        /// <c>true</c> when the queue has entries, otherwise (interrupted), <c>false</c>.
+        /// </returns>
+        bool WaitForEntries() noexcept
+        {
+            while (true)
+            {
+                auto key = m_notEmptyEventCount.PrepareWait();
+
+                if (m_waitInterrupted.load(std::memory_order_acquire))
+                {
+                    m_notEmptyEventCount.CancelWait();
+                    return false;
+                }
+
+                if (!IsEmpty())
+                {
+                    m_notEmptyEventCount.CancelWait();
+                    return true;
+                }
+
+                m_notEmptyEventCount.Wait(key);
+            }
+        }
+
+        /// <summary>
+        /// Interrupts the wait of the consumer for entries. After this call,
+        /// <see cref="WaitForEntries"/> no longer blocks, so that the consumer
+        /// is able to get the remaining entries and finish.
+        /// </summary>
+        void InterruptWait() noexcept
+        {
+            m_waitInterrupted.store(true, std::memory_order_release);
+            m_notEmptyEventCount.Notify();
+        }
+    };
+
+    /// <summary>
+    /// How many threads are allowed to add entries to a queue with a single consumer.
+    /// </summary>
+    enum class QueueProducers { Multiple, Single };
+
+    /// <summary>
+    /// Selects the implementation of queue for a single consumer that best
+    /// fits the given amount of producers. Both offer the same interface.
+    /// </summary>
+    template <typename Type, QueueProducers producers>
+    using SingleConsumerQueue = typename std::conditional<producers == QueueProducers::Single,
+                                                          SpscRingQueue<Type>,
+                                                          LockFreeQueue<Type>>::type;
+
     /// <summary>
     /// Implements a locked queue in order to aid the testing of
     /// the lock-free implementation.
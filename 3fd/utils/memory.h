@@ -10,14 +10,13 @@
 
 #include <array>
 #include <cinttypes>
-#include <map>
+#include <cstddef>
 #include <memory>
-#include <queue>
-#include <stack>
 #include <vector>
 
 #ifdef _3FD_HAS_STLOPTIMALLOC
 #   include <memory_resource>
+#   include <mutex>
 #endif
 
 namespace _3fd
@@ -76,6 +75,9 @@ namespace utils
     {
     private:
 
+        template <typename OtherType, bool t_otherThreadSafe>
+        friend class StlOptimizedAllocatorBase;
+
         // Guess a good size for pool memory chunk in number of blocks
         static constexpr size_t GuessNumMemBlocksPerChunk(size_t blockSizeBytes)
         {
@@ -208,17 +210,26 @@ namespace utils
 
         const uint16_t m_blockSize;
 
+        // whether the memory was allocated by this pool (and must be released by it)
+        bool m_isMemoryOwner;
+
+        /// <summary>
+        /// Head of the list of returned blocks. Each returned block stores the
+        /// address of the next one in its first bytes, so no extra memory is used.
+        /// </summary>
+        void *m_freeListHead;
+
         /// <summary>
-        /// Keeps available memory addresses stored as distance in number of blocks
-        /// from the base address. Because the offset is a 16 bit unsigned integer,
-        /// this imposes a practical limit of aproximately 64k blocks to the pool.
+        /// How many blocks are in the list of returned blocks.
         /// </summary>
-        std::stack<uint16_t> m_availAddrsAsBlockIndex;
+        uint16_t m_numFreeListBlocks;
 
     public:
 
         MemoryPool(uint16_t numBlocks, uint16_t blockSize);
 
+        MemoryPool(void *baseAddr, uint16_t numBlocks, uint16_t blockSize) noexcept;
+
         MemoryPool(const MemoryPool &) = delete;
 
         MemoryPool(MemoryPool &&ob) noexcept;
@@ -237,45 +248,284 @@ namespace utils
 
         void *GetFreeBlock() noexcept;
 
-        void ReturnBlock(void *addr);
+        void ReturnBlock(void *addr) noexcept;
+
+        void *Compact();
+    };
+
+    /// <summary>
+    /// Where <see cref="DynamicMemPool"/> gets its memory from.
+    /// </summary>
+    enum class MemoryBacking : uint8_t
+    {
+        Heap, // aligned allocation from the heap
+        VirtualMemory, // pages mapped directly from the system, whose unused tail can be handed back
+        HugePages // same as above, but asking for transparent huge pages (where supported)
+    };
+
+    /// <summary>
+    /// Statistics of a memory pool.
+    /// </summary>
+    struct MemPoolStats
+    {
+        size_t numChunks; // chunks of memory obtained by the pool
+        size_t numFullyFreeChunks; // chunks with no block in use (released by shrinking)
+        size_t numBytesReserved; // the memory in the chunks
+        size_t numBytesInUse; // the memory in blocks handed out
+        size_t numBytesInUseHighWaterMark; // the peak of memory in use
+        uint64_t numAllocations; // blocks handed out since the creation of the pool
+        uint64_t numDeallocations; // blocks returned since the creation of the pool
+
+        /// <summary>
+        /// Gets the fraction of the chunks that have no block in use.
+        /// </summary>
+        double GetFullyFreeChunksFraction() const noexcept
+        {
+            return numChunks > 0 ? static_cast<double> (numFullyFreeChunks) / numChunks : 0.0;
+        }
     };
 
     /// <summary>
     /// A template class for a memory pool that expands dynamically.
+    /// Memory comes in chunks whose size is a power of 2 and which are aligned
+    /// to their own size, so the chunk owning a block is found by masking the
+    /// block address. A header at the base of the chunk holds its <see cref="MemoryPool"/>.
     /// The pool was designed for SINGLE-THREAD access.
     /// </summary>
     class DynamicMemPool
     {
     private:
 
+        struct Chunk;
+
         const float m_growingFactor;
         const uint16_t m_blockSize;
         const uint16_t m_initialSize;
+        MemoryBacking m_backing;
 
-#ifdef _3FD_HAS_STL_OPTIMALLOC
-        typedef std::map<void *, MemoryPool, std::less<void *>,
-            StlOptimizedUnsafeAllocator<std::map<void *, MemoryPool>::value_type>> MapOfMemoryPools;
-#else
-        typedef std::map<void *, MemoryPool> MapOfMemoryPools;
-#endif
-        MapOfMemoryPools m_memPools;
-        std::queue<MemoryPool *> m_availableMemPools;
+        size_t m_chunkSize;
+        uint16_t m_numBlocksPerChunk;
+
+        std::vector<Chunk *> m_chunks;
+
+        // intrusive list of the chunks with available memory
+        Chunk *m_availableChunks;
+
+        size_t m_numBlocksInUse;
+        size_t m_numBlocksInUseHighWaterMark;
+        uint64_t m_numAllocations;
+        uint64_t m_numDeallocations;
+
+        Chunk *AllocateChunk();
+
+        void ReleaseChunk(Chunk *chunk) noexcept;
+
+        void ReleaseUnusedPages(Chunk *chunk);
 
     public:
 
         DynamicMemPool(uint16_t initialSize,
                        uint16_t blockSize,
-                       float growingFactor);
+                       float growingFactor,
+                       MemoryBacking backing = MemoryBacking::Heap);
 
 		DynamicMemPool(const DynamicMemPool &) = delete;
 
+        ~DynamicMemPool();
+
         void *GetFreeBlock();
 
         void ReturnBlock(void *object);
 
         void Shrink();
+
+        MemPoolStats GetStats() const noexcept;
+    };
+
+    /// <summary>
+    /// A memory pool that expands dynamically and is safe for concurrent access.
+    /// Each thread keeps its own cache of free blocks, organized in 2 "magazines",
+    /// so most allocations and deallocations take no lock. Magazines are exchanged
+    /// with a global depot as they get full or empty. A block can be returned by a
+    /// thread other than the one which obtained it.
+    /// </summary>
+    class ConcurrentDynamicMemPool
+    {
+    public:
+
+        struct Depot;
+
+    private:
+
+        std::shared_ptr<Depot> m_depot;
+
+    public:
+
+        ConcurrentDynamicMemPool(uint16_t initialSize,
+                                 uint16_t blockSize,
+                                 float growingFactor);
+
+        ConcurrentDynamicMemPool(const ConcurrentDynamicMemPool &) = delete;
+
+        ~ConcurrentDynamicMemPool();
+
+        void *GetFreeBlock();
+
+        void ReturnBlock(void *object);
+
+        void Shrink();
+
+        MemPoolStats GetStats();
+    };
+
+    /// <summary>
+    /// A general purpose allocator for objects of variable size. Requests up to
+    /// <see cref="SlabAllocator::maxSlabBlockSize"/> are rounded up to one of several
+    /// size classes, each served by slabs: chunks of memory aligned to their own (power of 2)
+    /// size, holding a header at the base, so the slab owning a block is found by masking
+    /// its address. Larger (or over-aligned) requests go straight to the heap.
+    /// The allocator was designed for SINGLE-THREAD access.
+    /// </summary>
+    class SlabAllocator
+    {
+    public:
+
+        static constexpr size_t maxSlabBlockSize = 32 * 1024;
+
+        static constexpr size_t numSizeClasses = 41;
+
+        struct Slab;
+
+    private:
+
+        struct SizeClass
+        {
+            size_t blockSize;
+            size_t slabSize;
+            Slab *partialSlabs; // have available blocks
+            Slab *fullSlabs; // have no available blocks
+            Slab *emptySlab; // kept for reuse when a slab gets entirely free
+        };
+
+        std::array<SizeClass, numSizeClasses> m_sizeClasses;
+
+        Slab *CreateSlab(SizeClass &sizeClass);
+
+        void ReleaseSlab(Slab *slab) noexcept;
+
+    public:
+
+        SlabAllocator() noexcept;
+
+        SlabAllocator(const SlabAllocator &) = delete;
+
+        ~SlabAllocator();
+
+        static size_t GetSizeClassIndex(size_t size) noexcept;
+
+        static size_t GetSizeClassBlockSize(size_t index) noexcept;
+
+        void *Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        void Deallocate(void *ptr, size_t size, size_t alignment = alignof(std::max_align_t)) noexcept;
+
+        void Shrink() noexcept;
     };
 
+#ifdef _3FD_HAS_STLOPTIMALLOC
+
+    /// <summary>
+    /// Adapts <see cref="SlabAllocator"/> to the interface of STL memory resources,
+    /// so it can serve STL containers via std::pmr::polymorphic_allocator.
+    /// </summary>
+    template <bool t_threadSafe>
+    class SlabMemoryResource : public std::pmr::memory_resource
+    {
+    private:
+
+        SlabAllocator m_slabAllocator;
+        std::mutex m_mutex;
+
+        void *do_allocate(size_t numBytes, size_t alignment) override
+        {
+            if (t_threadSafe)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                return m_slabAllocator.Allocate(numBytes, alignment);
+            }
+
+            return m_slabAllocator.Allocate(numBytes, alignment);
+        }
+
+        void do_deallocate(void *ptr, size_t numBytes, size_t alignment) override
+        {
+            if (t_threadSafe)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_slabAllocator.Deallocate(ptr, numBytes, alignment);
+                return;
+            }
+
+            m_slabAllocator.Deallocate(ptr, numBytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    typedef SlabMemoryResource<true> SyncSlabMemoryResource;
+    typedef SlabMemoryResource<false> UnsyncSlabMemoryResource;
+
+    /// <summary>
+    /// A memory resource that allocates by just bumping a pointer and never releases
+    /// memory upon deallocation, but only when reset or destroyed. Good for containers whose
+    /// lifetime is bound to a request (or any unit of work): after <see cref="Reset"/>, the
+    /// largest buffer is kept, so the next request of similar size makes no allocation at all.
+    /// It was designed for SINGLE-THREAD access.
+    /// </summary>
+    class MonotonicArenaResource : public std::pmr::memory_resource
+    {
+    private:
+
+        struct Buffer
+        {
+            Buffer *next;
+            size_t size;
+        };
+
+        std::pmr::memory_resource *m_upstream;
+        Buffer *m_buffers; // newest first
+        uintptr_t m_current;
+        uintptr_t m_end;
+        size_t m_nextBufferSize;
+
+        void AddBuffer(size_t minSize);
+
+        void *do_allocate(size_t numBytes, size_t alignment) override;
+
+        void do_deallocate(void *, size_t, size_t) override {}
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+    public:
+
+        explicit MonotonicArenaResource(size_t initialSize = 4096,
+                                        std::pmr::memory_resource *upstream = std::pmr::get_default_resource());
+
+        MonotonicArenaResource(const MonotonicArenaResource &) = delete;
+
+        ~MonotonicArenaResource();
+
+        void Reset() noexcept;
+    };
+
+#endif // _3FD_HAS_STLOPTIMALLOC
+
 }// end of namespace utils
 }// end of namespace _3fd
 
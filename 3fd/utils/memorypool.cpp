@@ -10,6 +10,7 @@
 #include <cassert>
 #include <cstring>
 #include <sstream>
+#include <vector>
 
 namespace _3fd
 {
@@ -44,6 +45,25 @@ namespace utils
             throw core::AppException<std::runtime_error>("Failed to allocate memory for memory pool");
     }
 
+    /// <summary>
+    /// Reads the link to the next block in the list of returned blocks.
+    /// (Blocks are not necessarily aligned for a pointer, hence memcpy.)
+    /// </summary>
+    static void *ReadFreeListLink(void *block) noexcept
+    {
+        void *next;
+        memcpy(&next, block, sizeof next);
+        return next;
+    }
+
+    /// <summary>
+    /// Writes in the block the link to the next one in the list of returned blocks.
+    /// </summary>
+    static void WriteFreeListLink(void *block, void *next) noexcept
+    {
+        memcpy(block, &next, sizeof next);
+    }
+
     /// <summary>
     /// Memories the pool.
     /// </summary>
@@ -54,15 +74,18 @@ namespace utils
         : m_baseAddr(nullptr)
         , m_nextAddr(nullptr)
         , m_end(nullptr)
-        , m_blockSize(blockSize)
-        , m_availAddrsAsBlockIndex()
+        // a returned block must be able to hold the link to the next one:
+        , m_blockSize(blockSize > sizeof(void *) ? blockSize : static_cast<uint16_t> (sizeof(void *)))
+        , m_isMemoryOwner(true)
+        , m_freeListHead(nullptr)
+        , m_numFreeListBlocks(0)
     {
         _ASSERTE(numBlocks * blockSize > 0); // Cannot handle a null value as the amount of memory
 
         /* Allocation aligned in 4 bytes guarantees the addresses will always have
            the 2 least significant bit unused. This is explored in the GC implementation. */
-        m_baseAddr = aligned_calloc(4, numBlocks, blockSize);
-        m_end = reinterpret_cast<void *> (reinterpret_cast<size_t> (m_baseAddr) + numBlocks * blockSize);
+        m_baseAddr = aligned_calloc(4, numBlocks, m_blockSize);
+        m_end = reinterpret_cast<void *> (reinterpret_cast<size_t> (m_baseAddr) + numBlocks * m_blockSize);
         m_nextAddr = m_baseAddr;
     }
     catch (core::IAppException &)
@@ -76,6 +99,26 @@ namespace utils
         throw core::AppException<std::runtime_error>(oss.str());
     }
 
+    /// <summary>
+    /// Initializes a new instance of the <see cref="MemoryPool"/> class
+    /// that manages memory allocated elsewhere (and not released by the pool).
+    /// </summary>
+    /// <param name="baseAddr">The base address of the memory to manage.</param>
+    /// <param name="numBlocks">The number blocks.</param>
+    /// <param name="blockSize">Size of the block. Blocks smaller than a pointer are enlarged.</param>
+    MemoryPool::MemoryPool(void *baseAddr, uint16_t numBlocks, uint16_t blockSize) noexcept
+        : m_baseAddr(baseAddr)
+        , m_nextAddr(baseAddr)
+        , m_end(nullptr)
+        , m_blockSize(blockSize > sizeof(void *) ? blockSize : static_cast<uint16_t> (sizeof(void *)))
+        , m_isMemoryOwner(false)
+        , m_freeListHead(nullptr)
+        , m_numFreeListBlocks(0)
+    {
+        _ASSERTE(baseAddr != nullptr && numBlocks * blockSize > 0);
+        m_end = reinterpret_cast<void *> (reinterpret_cast<uintptr_t> (m_baseAddr) + numBlocks * m_blockSize);
+    }
+
     /// <summary>
     /// Initializes a new instance of the <see cref="MemoryPool"/> class.
     /// </summary>
@@ -85,9 +128,12 @@ namespace utils
         , m_nextAddr(ob.m_nextAddr)
         , m_end(ob.m_end)
         , m_blockSize(ob.m_blockSize)
-        , m_availAddrsAsBlockIndex(std::move(ob.m_availAddrsAsBlockIndex))
+        , m_isMemoryOwner(ob.m_isMemoryOwner)
+        , m_freeListHead(ob.m_freeListHead)
+        , m_numFreeListBlocks(ob.m_numFreeListBlocks)
     {
-        ob.m_baseAddr = ob.m_nextAddr = ob.m_end = nullptr;
+        ob.m_baseAddr = ob.m_nextAddr = ob.m_end = ob.m_freeListHead = nullptr;
+        ob.m_numFreeListBlocks = 0;
     }
 
     /// <summary>
@@ -96,11 +142,11 @@ namespace utils
     MemoryPool::~MemoryPool()
     {
         // Memory pool destruction was reached not having all its memory returned
-        _ASSERTE(m_availAddrsAsBlockIndex.size() ==
+        _ASSERTE(m_numFreeListBlocks ==
             (reinterpret_cast<uintptr_t> (m_nextAddr) - reinterpret_cast<uintptr_t> (m_baseAddr)) / m_blockSize
         );
 
-        if (m_baseAddr != nullptr)
+        if (m_baseAddr != nullptr && m_isMemoryOwner)
 #    ifdef _WIN32
             _aligned_free(m_baseAddr);
 #    else
@@ -144,7 +190,7 @@ namespace utils
     /// <returns><c>true</c> if all the memory is available, otherwise, <c>false</c>.</returns>
     bool MemoryPool::IsFull() const noexcept
     {
-        return m_availAddrsAsBlockIndex.size() == GetNumBlocks() || m_nextAddr == m_baseAddr;
+        return m_numFreeListBlocks == (reinterpret_cast<uintptr_t> (m_nextAddr) - reinterpret_cast<uintptr_t> (m_baseAddr)) / m_blockSize;
     }
 
     /// <summary>
@@ -153,7 +199,7 @@ namespace utils
     /// <returns><c>true</c> if the pool has no memory available, otherwise, <c>false</c>.</returns>
     bool MemoryPool::IsEmpty() const noexcept
     {
-        return m_nextAddr == m_end && m_availAddrsAsBlockIndex.empty();
+        return m_nextAddr == m_end && m_freeListHead == nullptr;
     }
 
     /// <summary>
@@ -162,12 +208,11 @@ namespace utils
     /// <returns></returns>
     void * MemoryPool::GetFreeBlock() noexcept
     {
-        if (!m_availAddrsAsBlockIndex.empty())
+        if (m_freeListHead != nullptr)
         {
-            auto addr = reinterpret_cast<void *> (
-                reinterpret_cast<uintptr_t> (m_baseAddr) + m_availAddrsAsBlockIndex.top() * m_blockSize
-            );
-            m_availAddrsAsBlockIndex.pop();
+            auto addr = m_freeListHead;
+            m_freeListHead = ReadFreeListLink(addr);
+            --m_numFreeListBlocks;
             return addr;
         }
         else if (m_nextAddr < m_end)
@@ -184,12 +229,51 @@ namespace utils
     /// Returns a block of memory to the pool.
     /// </summary>
     /// <param name="addr">The address of the block to return.</param>
-    void MemoryPool::ReturnBlock(void *addr)
+    void MemoryPool::ReturnBlock(void *addr) noexcept
     {
         _ASSERTE(Contains(addr)); // Cannot return a memory block which does not belong to the memory pool
-        m_availAddrsAsBlockIndex.push(static_cast<uint16_t> (
-            (reinterpret_cast<uintptr_t> (addr) - reinterpret_cast<uintptr_t> (m_baseAddr)) / m_blockSize
-        ));
+        WriteFreeListLink(addr, m_freeListHead);
+        m_freeListHead = addr;
+        ++m_numFreeListBlocks;
+    }
+
+    /// <summary>
+    /// Lowers the mark of memory ever handed out by the pool as much as the returned blocks
+    /// at the end of the used region allow, and rearranges the list of returned blocks in
+    /// ascending order of address, so the memory in use tends to concentrate at the base.
+    /// </summary>
+    /// <returns>The address from where the memory of the pool is no longer in use.</returns>
+    void * MemoryPool::Compact()
+    {
+        auto numUsedBlocks = static_cast<size_t> (
+            (reinterpret_cast<uintptr_t> (m_nextAddr) - reinterpret_cast<uintptr_t> (m_baseAddr)) / m_blockSize
+        );
+
+        std::vector<bool> isFree(numUsedBlocks, false);
+
+        for (auto addr = m_freeListHead; addr != nullptr; addr = ReadFreeListLink(addr))
+        {
+            isFree[(reinterpret_cast<uintptr_t> (addr) - reinterpret_cast<uintptr_t> (m_baseAddr)) / m_blockSize] = true;
+        }
+
+        // returned blocks at the end of the used region go back to it:
+        while (numUsedBlocks > 0 && isFree[numUsedBlocks - 1])
+            --numUsedBlocks;
+
+        m_nextAddr = reinterpret_cast<void *> (reinterpret_cast<uintptr_t> (m_baseAddr) + numUsedBlocks * m_blockSize);
+        m_freeListHead = nullptr;
+        m_numFreeListBlocks = 0;
+
+        // rebuild the list (links are written only in blocks below the new mark):
+        for (auto idx = numUsedBlocks; idx-- > 0;)
+        {
+            if (isFree[idx])
+            {
+                ReturnBlock(reinterpret_cast<void *> (reinterpret_cast<uintptr_t> (m_baseAddr) + idx * m_blockSize));
+            }
+        }
+
+        return m_nextAddr;
     }
 
 } // end of namespace utils
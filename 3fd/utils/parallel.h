@@ -0,0 +1,401 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#ifndef UTILS_PARALLEL_H // header guard
+#define UTILS_PARALLEL_H
+
+#include <3fd/utils/threadpool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace _3fd
+{
+namespace utils
+{
+    /// <summary>
+    /// Runs a loop body over a range of indexes split in chunks of a given size, in parallel
+    /// on the thread pool. The calling thread also takes chunks, so it only waits for those
+    /// already running in other threads, and it is safe to call from tasks of the pool
+    /// (nested parallelism). When the range fits in a single chunk, it runs inline.
+    /// </summary>
+    /// <param name="pool">The thread pool, usually <see cref="ThreadPool::GetInstance"/>.</param>
+    /// <param name="begin">The first index.</param>
+    /// <param name="end">One past the last index.</param>
+    /// <param name="grainSize">The amount of indexes in a chunk.</param>
+    /// <param name="body">The loop body, invoked as 'body(chunkBegin, chunkEnd)'.
+    /// The first exception it throws is forwarded to the caller, and the
+    /// chunks not started yet are skipped.</param>
+    template <typename BodyFnType>
+    void ParallelFor(ThreadPool &pool, size_t begin, size_t end, size_t grainSize, BodyFnType body)
+    {
+        if (begin >= end)
+            return;
+
+        grainSize = std::max(grainSize, static_cast<size_t> (1));
+        const size_t numChunks = (end - begin + grainSize - 1) / grainSize;
+
+        if (numChunks == 1 || pool.GetNumWorkers() == 0)
+        {
+            body(begin, end);
+            return;
+        }
+
+        // shared with the tasks, which might start after the loop is over:
+        struct State
+        {
+            std::atomic<size_t> nextChunk;
+            std::atomic<size_t> numPendingChunks;
+            std::atomic<bool> failed;
+            std::exception_ptr exception;
+            std::mutex exceptionMutex;
+            Event done;
+            std::function<void(size_t, size_t)> body;
+            size_t begin, end, grainSize, numChunks;
+        };
+
+        auto state = std::make_shared<State>();
+        state->nextChunk.store(0);
+        state->numPendingChunks.store(numChunks);
+        state->failed.store(false);
+        state->body = body;
+        state->begin = begin;
+        state->end = end;
+        state->grainSize = grainSize;
+        state->numChunks = numChunks;
+
+        auto runChunks = [](State &state)
+        {
+            size_t chunk;
+            while ((chunk = state.nextChunk.fetch_add(1)) < state.numChunks)
+            {
+                if (!state.failed.load(std::memory_order_relaxed))
+                {
+                    try
+                    {
+                        auto chunkBegin = state.begin + chunk * state.grainSize;
+                        state.body(chunkBegin, std::min(chunkBegin + state.grainSize, state.end));
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(state.exceptionMutex);
+                        if (!state.failed.exchange(true))
+                            state.exception = std::current_exception();
+                    }
+                }
+
+                if (state.numPendingChunks.fetch_sub(1) == 1)
+                    state.done.Signalize();
+            }
+        };
+
+        auto numTasks = std::min(numChunks - 1, static_cast<size_t> (pool.GetNumWorkers()));
+        for (size_t idx = 0; idx < numTasks; ++idx)
+        {
+            try
+            {
+                pool.Submit([state, runChunks]() { runChunks(*state); }, TaskPriority::High);
+            }
+            catch (...)
+            {
+                break; // the calling thread runs what was left
+            }
+        }
+
+        runChunks(*state);
+
+        state->done.Wait([&state]() { return state->numPendingChunks.load() == 0; });
+
+        if (state->exception)
+            std::rethrow_exception(state->exception);
+    }
+
+    /// <summary>
+    /// Finds how many elements from the first sorted range go in the first positions
+    /// of a (stable) merge with a second sorted range. The binary search over the
+    /// diagonal of the merge path lets independent threads merge separate parts.
+    /// </summary>
+    /// <param name="first1">The beginning of the first sorted range.</param>
+    /// <param name="length1">The length of the first range.</param>
+    /// <param name="first2">The beginning of the second sorted range.</param>
+    /// <param name="length2">The length of the second range.</param>
+    /// <param name="position">The position in the merged output.</param>
+    /// <param name="lessThan">A functor that evaluates when an element is less than another.</param>
+    /// <returns>How many elements of the first range precede the given position in the output.</returns>
+    template <typename IterType1, typename IterType2, typename LessFnType>
+    size_t FindMergePathSplit(IterType1 first1, size_t length1,
+                              IterType2 first2, size_t length2,
+                              size_t position,
+                              LessFnType lessThan)
+    {
+        size_t low = position > length2 ? position - length2 : 0;
+        size_t high = std::min(position, length1);
+
+        while (low < high)
+        {
+            size_t mid = low + (high - low) / 2;
+
+            // ties go to the first range, keeping the merge stable:
+            if (lessThan(*(first2 + (position - mid - 1)), *(first1 + mid)))
+                high = mid;
+            else
+                low = mid + 1;
+        }
+
+        return low;
+    }
+
+    /// <summary>
+    /// Merges two sorted ranges in parallel, splitting the output in chunks.
+    /// The result is the same as from std::merge (stable).
+    /// </summary>
+    /// <param name="pool">The thread pool.</param>
+    /// <param name="first1">The beginning of the first sorted range.</param>
+    /// <param name="last1">The end of the first sorted range.</param>
+    /// <param name="first2">The beginning of the second sorted range.</param>
+    /// <param name="last2">The end of the second sorted range.</param>
+    /// <param name="output">The beginning of the output, which cannot overlap the inputs.</param>
+    /// <param name="lessThan">A functor that evaluates when an element is less than another.</param>
+    /// <param name="grainSize">The amount of output elements merged by a single task.</param>
+    template <typename IterType1, typename IterType2, typename OutIterType, typename LessFnType>
+    void ParallelMerge(ThreadPool &pool,
+                       IterType1 first1, IterType1 last1,
+                       IterType2 first2, IterType2 last2,
+                       OutIterType output,
+                       LessFnType lessThan,
+                       size_t grainSize = 8192)
+    {
+        const size_t length1 = std::distance(first1, last1);
+        const size_t length2 = std::distance(first2, last2);
+
+        ParallelFor(pool, 0, length1 + length2, grainSize, [=](size_t begin, size_t end)
+        {
+            auto split1 = FindMergePathSplit(first1, length1, first2, length2, begin, lessThan);
+            auto split2 = FindMergePathSplit(first1, length1, first2, length2, end, lessThan);
+
+            std::merge(first1 + split1, first1 + split2,
+                       first2 + (begin - split1), first2 + (end - split2),
+                       output + begin,
+                       lessThan);
+        });
+    }
+
+    /// <summary>
+    /// Merges consecutive sorted runs (k-way) in place, in parallel. Runs are merged
+    /// in pairs, round after round, and every pairwise merge is parallel as well.
+    /// The result is the same as from a stable sort of the whole range.
+    /// </summary>
+    /// <param name="pool">The thread pool.</param>
+    /// <param name="first">The beginning of the range.</param>
+    /// <param name="last">The end of the range.</param>
+    /// <param name="runOffsets">The offsets where each sorted run begins (starting with zero).</param>
+    /// <param name="lessThan">A functor that evaluates when an element is less than another.</param>
+    /// <param name="grainSize">The amount of output elements merged by a single task.</param>
+    /// <remarks>The element type must be default constructible, because of the auxiliary buffer.</remarks>
+    template <typename IterType, typename LessFnType>
+    void ParallelMergeRuns(ThreadPool &pool,
+                           IterType first, IterType last,
+                           std::vector<size_t> runOffsets,
+                           LessFnType lessThan,
+                           size_t grainSize = 8192)
+    {
+        typedef typename std::iterator_traits<IterType>::value_type ValueType;
+
+        const size_t length = std::distance(first, last);
+
+        runOffsets.push_back(length);
+        if (runOffsets.size() <= 2)
+            return;
+
+        std::vector<ValueType> buffer(length);
+        bool inBuffer(false); // tells where the current runs are
+
+        while (runOffsets.size() > 2)
+        {
+            const size_t numRuns = runOffsets.size() - 1;
+
+            std::vector<size_t> mergedOffsets;
+            mergedOffsets.reserve(numRuns / 2 + 2);
+
+            for (size_t idx = 0; idx < numRuns; idx += 2)
+            {
+                auto begin = runOffsets[idx];
+                auto middle = runOffsets[idx + 1];
+                auto end = runOffsets[std::min(idx + 2, numRuns)];
+                mergedOffsets.push_back(begin);
+
+                auto merge = [&](auto source, auto target)
+                {
+                    ParallelMerge(pool,
+                                  std::make_move_iterator(source + begin),
+                                  std::make_move_iterator(source + middle),
+                                  std::make_move_iterator(source + middle),
+                                  std::make_move_iterator(source + end),
+                                  target + begin,
+                                  lessThan,
+                                  grainSize);
+                };
+
+                // the odd run out is just moved along:
+                if (middle == end)
+                {
+                    if (inBuffer)
+                        std::move(buffer.begin() + begin, buffer.begin() + end, first + begin);
+                    else
+                        std::move(first + begin, first + end, buffer.begin() + begin);
+                }
+                else if (inBuffer)
+                    merge(buffer.begin(), first);
+                else
+                    merge(first, buffer.begin());
+            }
+
+            mergedOffsets.push_back(length);
+            runOffsets.swap(mergedOffsets);
+            inBuffer = !inBuffer;
+        }
+
+        if (inBuffer)
+        {
+            ParallelFor(pool, 0, length, grainSize, [&buffer, first](size_t begin, size_t end)
+            {
+                std::move(buffer.begin() + begin, buffer.begin() + end, first + begin);
+            });
+        }
+    }
+
+    /// <summary>
+    /// Sorts a range in parallel (merge sort): chunks are sorted by separate tasks,
+    /// then merged with <see cref="ParallelMergeRuns"/>. The sort is stable, hence the
+    /// result does not depend on the amount of threads. Ranges up to the grain size
+    /// are sorted sequentially.
+    /// </summary>
+    /// <param name="pool">The thread pool.</param>
+    /// <param name="first">The beginning of the range.</param>
+    /// <param name="last">The end of the range.</param>
+    /// <param name="lessThan">A functor that evaluates when an element is less than another.</param>
+    /// <param name="grainSize">The amount of elements sorted by a single task.</param>
+    template <typename IterType, typename LessFnType>
+    void ParallelSort(ThreadPool &pool, IterType first, IterType last, LessFnType lessThan, size_t grainSize = 8192)
+    {
+        const size_t length = std::distance(first, last);
+        grainSize = std::max(grainSize, static_cast<size_t> (2));
+
+        if (length <= grainSize || pool.GetNumWorkers() == 0)
+        {
+            std::stable_sort(first, last, lessThan);
+            return;
+        }
+
+        std::vector<size_t> runOffsets;
+        for (size_t offset = 0; offset < length; offset += grainSize)
+            runOffsets.push_back(offset);
+
+        ParallelFor(pool, 0, length, grainSize, [first, &lessThan](size_t begin, size_t end)
+        {
+            std::stable_sort(first + begin, first + end, lessThan);
+        });
+
+        ParallelMergeRuns(pool, first, last, std::move(runOffsets), lessThan, grainSize);
+    }
+
+    template <typename IterType>
+    void ParallelSort(ThreadPool &pool, IterType first, IterType last)
+    {
+        ParallelSort(pool, first, last, std::less<typename std::iterator_traits<IterType>::value_type>());
+    }
+
+    /// <summary>
+    /// Computes the inclusive prefix sum (scan) of a range in parallel: every chunk is
+    /// reduced, the partial results are scanned, and then every chunk is scanned starting
+    /// from its offset. Chunks are defined by the grain size only (even when the pool has
+    /// no workers), so the result is the same regardless the amount of threads, even for
+    /// floating point.
+    /// </summary>
+    /// <param name="pool">The thread pool.</param>
+    /// <param name="first">The beginning of the input.</param>
+    /// <param name="last">The end of the input.</param>
+    /// <param name="output">The beginning of the output, which can be the same as the input.</param>
+    /// <param name="op">The associative binary operation.</param>
+    /// <param name="grainSize">The amount of elements processed by a single task.</param>
+    template <typename InIterType, typename OutIterType, typename BinaryOpType>
+    void ParallelInclusiveScan(ThreadPool &pool,
+                               InIterType first, InIterType last,
+                               OutIterType output,
+                               BinaryOpType op,
+                               size_t grainSize = 16384)
+    {
+        typedef typename std::iterator_traits<InIterType>::value_type ValueType;
+
+        const size_t length = std::distance(first, last);
+        grainSize = std::max(grainSize, static_cast<size_t> (1));
+
+        auto scanChunk = [first, output, &op](size_t begin, size_t end, const ValueType *offset)
+        {
+            ValueType sum = offset ? op(*offset, *(first + begin)) : *(first + begin);
+            *(output + begin) = sum;
+
+            for (size_t idx = begin + 1; idx < end; ++idx)
+            {
+                sum = op(sum, *(first + idx));
+                *(output + idx) = sum;
+            }
+        };
+
+        if (length <= grainSize)
+        {
+            if (length > 0)
+                scanChunk(0, length, nullptr);
+
+            return;
+        }
+
+        // without workers, the chunks are processed inline, so the association order is the same:
+        auto forEachChunk = [&pool, grainSize](size_t end, auto body)
+        {
+            if (pool.GetNumWorkers() > 0)
+            {
+                ParallelFor(pool, 0, end, grainSize, body);
+                return;
+            }
+
+            for (size_t begin = 0; begin < end; begin += grainSize)
+                body(begin, std::min(begin + grainSize, end));
+        };
+
+        const size_t numChunks = (length + grainSize - 1) / grainSize;
+        std::vector<ValueType> chunkSums(numChunks);
+
+        // reduce every chunk but the last:
+        forEachChunk((numChunks - 1) * grainSize, [first, grainSize, &op, &chunkSums](size_t begin, size_t end)
+        {
+            ValueType sum = *(first + begin);
+            for (size_t idx = begin + 1; idx < end; ++idx)
+                sum = op(sum, *(first + idx));
+
+            chunkSums[begin / grainSize] = sum;
+        });
+
+        for (size_t idx = 1; idx < numChunks - 1; ++idx)
+            chunkSums[idx] = op(chunkSums[idx - 1], chunkSums[idx]);
+
+        forEachChunk(length, [grainSize, &chunkSums, &scanChunk](size_t begin, size_t end)
+        {
+            auto chunk = begin / grainSize;
+            scanChunk(begin, end, chunk > 0 ? &chunkSums[chunk - 1] : nullptr);
+        });
+    }
+
+}// end of namespace utils
+}// end of namespace _3fd
+
+#endif // end of header guard
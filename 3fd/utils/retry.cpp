@@ -0,0 +1,245 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include "retry.h"
+#include "algorithms.h"
+#include <3fd/core/exceptions.h>
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <thread>
+
+#undef min
+#undef max
+
+namespace _3fd
+{
+namespace utils
+{
+    using namespace std::chrono;
+
+    /////////////////////////////
+    // RetryBudget Class
+    /////////////////////////////
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="RetryBudget"/> class.
+    /// The budget starts full.
+    /// </summary>
+    /// <param name="retriesPerSec">How many retries per second the budget affords in the long run.</param>
+    /// <param name="maxBurst">How many retries the budget can afford at once.</param>
+    RetryBudget::RetryBudget(double retriesPerSec, uint32_t maxBurst)
+        : m_tokens(maxBurst)
+        , m_maxTokens(maxBurst)
+        , m_tokensPerSec(retriesPerSec)
+        , m_lastRefill(steady_clock::now())
+    {
+    }
+
+    /// <summary>
+    /// Spends a token for a retry, if available.
+    /// </summary>
+    /// <returns>Whether the retry is allowed.</returns>
+    bool RetryBudget::TryWithdraw()
+    {
+        try
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto now = steady_clock::now();
+            auto elapsedSecs = duration_cast<duration<double>>(now - m_lastRefill).count();
+            m_tokens = std::min(m_maxTokens, m_tokens + elapsedSecs * m_tokensPerSec);
+            m_lastRefill = now;
+
+            if (m_tokens < 1.0)
+                return false;
+
+            m_tokens -= 1.0;
+            return true;
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to acquire lock of retry budget: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+    /////////////////////////////
+    // RetryPolicy Class
+    /////////////////////////////
+
+    // All retry policies alive, so their counters can be collected:
+    static std::mutex &GetRegistryMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::vector<const RetryPolicy *> &GetRegistry()
+    {
+        static std::vector<const RetryPolicy *> policies;
+        return policies;
+    }
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="RetryPolicy"/> class.
+    /// </summary>
+    /// <param name="callSite">The name of the call site, which must be a string literal.</param>
+    /// <param name="options">The options.</param>
+    /// <param name="budget">The budget of retries to spend from, optional.</param>
+    RetryPolicy::RetryPolicy(const char *callSite, const RetryOptions &options, RetryBudget *budget)
+        : m_callSite(callSite)
+        , m_options(options)
+        , m_budget(budget)
+        , m_numRetriedCalls(0)
+        , m_numRetries(0)
+        , m_numGiveUps(0)
+        , m_numBudgetDenials(0)
+    {
+        _ASSERTE(options.baseDelay <= options.maxDelay);
+
+        try
+        {
+            std::lock_guard<std::mutex> lock(GetRegistryMutex());
+            GetRegistry().push_back(this);
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to acquire lock when registering retry policy: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::bad_alloc &)
+        {
+            throw core::AppException<std::runtime_error>("Failed to allocate memory when registering retry policy");
+        }
+    }
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="RetryPolicy"/> class.
+    /// </summary>
+    RetryPolicy::~RetryPolicy()
+    {
+        try
+        {
+            std::lock_guard<std::mutex> lock(GetRegistryMutex());
+            auto &registry = GetRegistry();
+            registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+        }
+        catch (std::system_error &)
+        {
+            _ASSERTE(false); // cannot unregister
+        }
+    }
+
+    /// <summary>
+    /// Gets the counters of retries at the call site.
+    /// </summary>
+    RetryStats RetryPolicy::GetStats() const noexcept
+    {
+        return RetryStats{
+            m_callSite,
+            m_numRetriedCalls.load(std::memory_order_relaxed),
+            m_numRetries.load(std::memory_order_relaxed),
+            m_numGiveUps.load(std::memory_order_relaxed),
+            m_numBudgetDenials.load(std::memory_order_relaxed)
+        };
+    }
+
+    /// <summary>
+    /// Gets the counters of retries of all the call sites (whose policies are alive).
+    /// </summary>
+    std::vector<RetryStats> RetryPolicy::GetStatsOfAllCallSites()
+    {
+        try
+        {
+            std::vector<RetryStats> allStats;
+
+            std::lock_guard<std::mutex> lock(GetRegistryMutex());
+            for (auto policy : GetRegistry())
+                allStats.push_back(policy->GetStats());
+
+            return allStats;
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to acquire lock when collecting statistics of retries: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::bad_alloc &)
+        {
+            throw core::AppException<std::runtime_error>("Failed to allocate memory when collecting statistics of retries");
+        }
+    }
+
+    /////////////////////////////
+    // Retrier Class
+    /////////////////////////////
+
+    /// <summary>
+    /// Decides whether to retry after a failed attempt and, if so, how long to wait.
+    /// </summary>
+    /// <param name="delay">Receives how long to wait before the next attempt.</param>
+    /// <returns>Whether to retry. When <c>false</c>, the call must give up.</returns>
+    bool Retrier::NextDelay(milliseconds &delay)
+    {
+        const auto &options = m_policy.m_options;
+        auto now = steady_clock::now();
+
+        if (m_numAttempts == 1)
+        {
+            m_policy.m_numRetriedCalls.fetch_add(1, std::memory_order_relaxed);
+            m_deadline = now + options.timeout;
+        }
+
+        if ((options.maxAttempts != 0 && m_numAttempts >= options.maxAttempts)
+            || (options.timeout.count() > 0 && now >= m_deadline))
+        {
+            m_policy.m_numGiveUps.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (m_policy.m_budget != nullptr && !m_policy.m_budget->TryWithdraw())
+        {
+            m_policy.m_numBudgetDenials.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // decorrelated jitter:
+        auto low = static_cast<uint64_t> (options.baseDelay.count());
+        auto high = std::max(low, static_cast<uint64_t> (m_lastDelay.count()) * 3);
+        auto randomDelay = milliseconds(low + GenerateThreadLocalRandom() % (high - low + 1));
+
+        delay = std::min(randomDelay, options.maxDelay);
+        m_lastDelay = delay;
+
+        if (options.timeout.count() > 0)
+            delay = std::min(delay, duration_cast<milliseconds>(m_deadline - now));
+
+        ++m_numAttempts;
+        m_policy.m_numRetries.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// <summary>
+    /// Waits before the next attempt, unless it is time to give up.
+    /// </summary>
+    /// <returns>Whether to retry. When <c>false</c>, the call must give up.</returns>
+    bool Retrier::BackOff()
+    {
+        milliseconds delay;
+        if (!NextDelay(delay))
+            return false;
+
+        std::this_thread::sleep_for(delay);
+        return true;
+    }
+
+}// end of namespace utils
+}// end of namespace _3fd
@@ -0,0 +1,148 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#ifndef UTILS_RETRY_H // header guard
+#define UTILS_RETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <mutex>
+#include <vector>
+
+namespace _3fd
+{
+namespace utils
+{
+    /// <summary>
+    /// Options of a <see cref="RetryPolicy"/>.
+    /// </summary>
+    struct RetryOptions
+    {
+        std::chrono::milliseconds baseDelay; // the least delay before a retry
+        std::chrono::milliseconds maxDelay; // the greatest delay before a retry
+        uint32_t maxAttempts; // including the first one (zero means no limit)
+        std::chrono::milliseconds timeout; // counted since the first failure (zero means no limit)
+    };
+
+    /// <summary>
+    /// A budget of retries, shared by the operations on a common resource: tokens
+    /// accumulate at a fixed rate (up to a burst) and every retry spends one. When
+    /// the resource is unavailable for everyone, the callers give up once the budget
+    /// is spent, instead of hammering it with retries (retry storm).
+    /// </summary>
+    class RetryBudget
+    {
+    private:
+
+        std::mutex m_mutex;
+        double m_tokens;
+        const double m_maxTokens;
+        const double m_tokensPerSec;
+        std::chrono::steady_clock::time_point m_lastRefill;
+
+    public:
+
+        RetryBudget(double retriesPerSec, uint32_t maxBurst);
+
+        RetryBudget(const RetryBudget &) = delete;
+
+        bool TryWithdraw();
+    };
+
+    /// <summary>
+    /// Counters of the retries at a call site.
+    /// </summary>
+    struct RetryStats
+    {
+        const char *callSite;
+        uint64_t numRetriedCalls; // calls that needed at least one retry
+        uint64_t numRetries;
+        uint64_t numGiveUps; // calls that ran out of attempts or time
+        uint64_t numBudgetDenials; // calls that gave up because the budget was spent
+    };
+
+    /// <summary>
+    /// How the operation at a call site retries upon transient failure: the delays have
+    /// decorrelated jitter (each one is random between the base delay and 3 times the
+    /// previous delay, capped), so concurrent callers do not retry in lock-step.
+    /// Meant to be a static object at the call site, where it also keeps counters.
+    /// </summary>
+    class RetryPolicy
+    {
+    private:
+
+        friend class Retrier;
+
+        const char *m_callSite;
+        const RetryOptions m_options;
+        RetryBudget *m_budget;
+
+        std::atomic<uint64_t> m_numRetriedCalls;
+        std::atomic<uint64_t> m_numRetries;
+        std::atomic<uint64_t> m_numGiveUps;
+        std::atomic<uint64_t> m_numBudgetDenials;
+
+    public:
+
+        RetryPolicy(const char *callSite, const RetryOptions &options, RetryBudget *budget = nullptr);
+
+        RetryPolicy(const RetryPolicy &) = delete;
+
+        ~RetryPolicy();
+
+        RetryStats GetStats() const noexcept;
+
+        static std::vector<RetryStats> GetStatsOfAllCallSites();
+    };
+
+    /// <summary>
+    /// Keeps track of the retries of a single call, according to a <see cref="RetryPolicy"/>.
+    /// </summary>
+    /// <remarks>
+    /// Usage:
+    ///     Retrier retrier(policy);
+    ///     while (!TryOperation())
+    ///         if (!retrier.BackOff()) GiveUp();
+    /// </remarks>
+    class Retrier
+    {
+    private:
+
+        RetryPolicy &m_policy;
+        uint32_t m_numAttempts;
+        std::chrono::milliseconds m_lastDelay;
+        std::chrono::steady_clock::time_point m_deadline;
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="Retrier"/> class.
+        /// Cheap enough to construct before the first attempt in a hot path.
+        /// </summary>
+        /// <param name="policy">The retry policy of the call site.</param>
+        explicit Retrier(RetryPolicy &policy) noexcept
+            : m_policy(policy)
+            , m_numAttempts(1)
+            , m_lastDelay(policy.m_options.baseDelay)
+        {
+        }
+
+        Retrier(const Retrier &) = delete;
+
+        /// <summary>
+        /// Gets how many attempts were made so far (including the first one).
+        /// </summary>
+        uint32_t GetNumAttempts() const noexcept { return m_numAttempts; }
+
+        bool NextDelay(std::chrono::milliseconds &delay);
+
+        bool BackOff();
+    };
+
+}// end of namespace utils
+}// end of namespace _3fd
+
+#endif // end of header guard
@@ -15,11 +15,6 @@ namespace _3fd
         // Specialization of serializations
         ///////////////////////////////////////
 
-        size_t _estimate_string_size()
-        {
-            return 0;
-        }
-
 #ifdef _3FD_PLATFORM_WINRT
 
         SerializableValue<const wchar_t *> FormatArg(const winrt::hstring &value)
@@ -6,6 +6,7 @@
 #ifndef UTILS_IO_H // header guard
 #define UTILS_IO_H
 
+#include <3fd/core/preprocessing.h>
 #include <3fd/core/exceptions.h>
 #include <3fd/core/callstacktracer.h>
 
@@ -14,11 +15,13 @@
 
 #include <algorithm>
 #include <array>
+#include <charconv>
 #include <cinttypes>
 #include <cstdio>
 #include <cstring>
 #include <sstream>
 #include <string>
+#include <type_traits>
 
 #ifdef __linux__
 #   include <wchar.h>
@@ -243,6 +246,264 @@ namespace utils
          static constexpr const wchar_t *place_holder_width_precision(long double) { return L"%*.*lG"; }
     };
 
+    ////////////////////////////////////
+    // Native formatting (no printf)
+    ////////////////////////////////////
+
+    // Greatest precision formatted without resorting to printf
+    constexpr int _maxNativePrecision = 64;
+
+    // Integer types formatted as numbers (characters and booleans are not)
+    template <typename ValType>
+    struct _is_native_integer : std::integral_constant<bool,
+        std::is_integral<ValType>::value
+        && !std::is_same<ValType, bool>::value
+        && !std::is_same<ValType, char>::value
+        && !std::is_same<ValType, wchar_t>::value> {};
+
+    // Strings of the given character type
+    template <typename ValType, typename CharType>
+    struct _is_native_string : std::integral_constant<bool,
+        std::is_same<ValType, const CharType *>::value
+        || std::is_same<ValType, CharType *>::value> {};
+
+    // printf behavior is undefined for a null string, so it is replaced by "(null)", as glibc prints it
+
+    template <typename ValType>
+    ValType _not_null(ValType value) noexcept { return value; }
+
+    inline const char *_not_null(const char *str) noexcept { return str != nullptr ? str : "(null)"; }
+
+    inline const char *_not_null(char *str) noexcept { return _not_null(static_cast<const char *> (str)); }
+
+    inline const wchar_t *_not_null(const wchar_t *str) noexcept { return str != nullptr ? str : L"(null)"; }
+
+    inline const wchar_t *_not_null(wchar_t *str) noexcept { return _not_null(static_cast<const wchar_t *> (str)); }
+
+    /// <summary>
+    /// Counts the decimal digits of an integer.
+    /// </summary>
+    inline size_t _count_decimal_digits(uint64_t value) noexcept
+    {
+        size_t count(1);
+        while (value >= 10)
+        {
+            value /= 10;
+            ++count;
+        }
+        return count;
+    }
+
+    /// <summary>
+    /// Gets the length of a string, like printf would read it given a precision.
+    /// </summary>
+    template <typename CharType>
+    size_t _get_length(const CharType *str, int precision) noexcept
+    {
+        size_t length(0);
+        const size_t maxLength = (precision < 0) ? SIZE_MAX : static_cast<size_t> (precision);
+        while (length < maxLength && str[length] != 0)
+            ++length;
+        return length;
+    }
+
+    /// <summary>
+    /// Writes into a buffer a text padded with spaces to the left up to a width,
+    /// and terminates it with null.
+    /// </summary>
+    /// <returns>
+    /// The length of the padded text. If not less than the room in the buffer,
+    /// nothing has been written and the caller has to provide more room.
+    /// </returns>
+    template <typename CharType, typename SrcCharType>
+    size_t _write_padded(const RawBufferInfo<CharType> &buffer, const SrcCharType *text, size_t length, int width) noexcept
+    {
+        const size_t padding = (width > 0 && static_cast<size_t> (width) > length) ? width - length : 0;
+        const size_t total = padding + length;
+
+        if (total >= buffer.count)
+            return total;
+
+        std::fill_n(buffer.data, padding, static_cast<CharType> (' '));
+        std::copy(text, text + length, buffer.data + padding);
+        buffer.data[total] = 0;
+        return total;
+    }
+
+    /// <summary>
+    /// Formats an integer like printf does with "%*.*d", but with std::to_chars.
+    /// </summary>
+    template <typename CharType, typename IntType>
+    size_t _format_integer(const RawBufferInfo<CharType> &buffer, IntType value, int width, int precision) noexcept
+    {
+        _ASSERTE(precision <= _maxNativePrecision);
+
+        std::array<char, 24> digits;
+        auto end = std::to_chars(digits.data(), digits.data() + digits.size(), value).ptr;
+
+        char *begin = digits.data();
+        bool negative(false);
+        if constexpr (std::is_signed<IntType>::value)
+        {
+            negative = (value < 0);
+            if (negative)
+                ++begin; // skip the sign
+        }
+
+        // printf writes no digits when both precision and value are zero:
+        if (precision == 0 && value == 0)
+            end = begin;
+
+        std::array<char, _maxNativePrecision + 24> chars;
+        char *out = chars.data();
+
+        if (negative)
+            *out++ = '-';
+
+        const size_t numDigits = end - begin;
+        if (precision > 0 && static_cast<size_t> (precision) > numDigits)
+            out = std::fill_n(out, precision - numDigits, '0');
+
+        out = std::copy(begin, end, out);
+        return _write_padded(buffer, chars.data(), out - chars.data(), width);
+    }
+
+#ifdef _3FD_HAS_FLOAT_TO_CHARS
+    /// <summary>
+    /// Formats a floating-point number like printf does with "%*.*G", but with std::to_chars.
+    /// </summary>
+    template <typename CharType, typename FloatType>
+    size_t _format_floating(const RawBufferInfo<CharType> &buffer, FloatType value, int width, int precision) noexcept
+    {
+        _ASSERTE(precision <= _maxNativePrecision);
+
+        std::array<char, _maxNativePrecision + 32> chars;
+        auto end = std::to_chars(chars.data(), chars.data() + chars.size(),
+                                 value,
+                                 std::chars_format::general,
+                                 (precision < 0) ? 6 : precision).ptr;
+
+        // uppercase exponent, infinity and NaN:
+        for (char *iter = chars.data(); iter != end; ++iter)
+        {
+            if (*iter >= 'a' && *iter <= 'z')
+                *iter -= 'a' - 'A';
+        }
+
+        return _write_padded(buffer, chars.data(), end - chars.data(), width);
+    }
+#endif
+
+    /// <summary>
+    /// Formats a value into a buffer without printf, when that is supported for its type.
+    /// </summary>
+    /// <param name="buffer">The output buffer.</param>
+    /// <param name="value">The value to format.</param>
+    /// <param name="width">The minimum width, or negative if not specified.</param>
+    /// <param name="precision">The precision, or negative if not specified.</param>
+    /// <param name="pcount">Receives the length of the formatted text (as returned by snprintf).</param>
+    /// <returns>Whether the value was formatted. Otherwise, it must resort to printf.</returns>
+    template <typename CharType, typename ValType>
+    bool _try_format_native(const RawBufferInfo<CharType> &buffer,
+                            ValType value,
+                            int width,
+                            int precision,
+                            size_t &pcount) noexcept
+    {
+        if constexpr (_is_native_integer<ValType>::value)
+        {
+            if (precision > _maxNativePrecision)
+                return false;
+
+            pcount = _format_integer(buffer, value, width, precision);
+            return true;
+        }
+        else if constexpr (std::is_floating_point<ValType>::value)
+        {
+#   ifdef _3FD_HAS_FLOAT_TO_CHARS
+            if (precision > _maxNativePrecision)
+                return false;
+
+            // printf promotes float to double:
+            typedef typename std::conditional<std::is_same<ValType, float>::value, double, ValType>::type PromotedType;
+            pcount = _format_floating(buffer, static_cast<PromotedType> (value), width, precision);
+            return true;
+#   else
+            return false;
+#   endif
+        }
+        else if constexpr (_is_native_string<ValType, CharType>::value)
+        {
+            auto str = _not_null(value);
+            pcount = _write_padded(buffer, str, _get_length(str, precision), width);
+            return true;
+        }
+        else if constexpr (std::is_same<ValType, CharType>::value)
+        {
+            // a character with width or precision is printed by its code
+            if (width >= 0 || precision >= 0)
+                return false;
+
+            pcount = _write_padded(buffer, &value, 1, width);
+            return true;
+        }
+        else
+            return false;
+    }
+
+    /// <summary>
+    /// Calculates the length of text required to format a value,
+    /// which is exact for integers and strings, and a tight upper bound for floating-point numbers.
+    /// </summary>
+    template <typename CharType, typename ValType>
+    size_t _calc_formatted_length(ValType value, int precision) noexcept
+    {
+        if constexpr (_is_native_integer<ValType>::value)
+        {
+            if (precision == 0 && value == 0)
+                return 0;
+
+            uint64_t magnitude = static_cast<uint64_t> (value);
+            bool negative(false);
+
+            if constexpr (std::is_signed<ValType>::value)
+            {
+                if (value < 0)
+                {
+                    magnitude = 0 - magnitude;
+                    negative = true;
+                }
+            }
+
+            return (negative ? 1 : 0) + std::max(_count_decimal_digits(magnitude),
+                                                 static_cast<size_t> (std::max(precision, 0)));
+        }
+        else if constexpr (std::is_floating_point<ValType>::value)
+        {
+            // sign, digits, decimal point and exponent (E+4932):
+            return static_cast<size_t> ((precision < 0) ? 6 : std::max(precision, 1)) + 8;
+        }
+        else if constexpr (_is_native_string<ValType, char>::value || _is_native_string<ValType, wchar_t>::value)
+        {
+            if (value == nullptr)
+                return 8;
+
+            // when converted from wide characters, a code point takes up to 4 bytes of UTF-8:
+            if (sizeof *value > sizeof(CharType))
+                return (precision < 0) ? 4 * _get_length(value, -1) : static_cast<size_t> (precision);
+
+            return _get_length(value, precision);
+        }
+        else if constexpr (std::is_pointer<ValType>::value)
+        {
+            return 2 + 2 * sizeof(void *);
+        }
+        else
+        {
+            return 24; // character printed by its code, or else
+        }
+    }
+
     /// <summary>
     /// Wraps a generic value for serialization,
     /// packing it along with format information.
@@ -278,28 +539,58 @@ namespace utils
         template <typename CharType, typename OutType>
         size_t SerializeTo(OutType output) const
         {
+            if constexpr (std::is_same<OutType, RawBufferInfo<CharType>>::value)
+            {
+                size_t pcount;
+                if (_try_format_native(output, m_value, m_width, m_precision, pcount))
+                    return pcount;
+            }
+            else if constexpr (std::is_same<OutType, FILE *>::value && std::is_same<CharType, char>::value)
+            {
+                // format in the stack, then write to the file:
+                std::array<char, 256> buffer;
+                size_t pcount;
+                if (_try_format_native(RawBufferInfo<char>{ buffer.data(), buffer.size() }, m_value, m_width, m_precision, pcount)
+                    && pcount < buffer.size())
+                {
+                    if (fwrite(buffer.data(), sizeof(char), pcount, output) == pcount)
+                        return pcount;
+                    else
+                        throw core::AppException<std::runtime_error>("fwrite: IO error!", strerror(errno));
+                }
+            }
+
+            return SerializeWithPrintf<CharType>(output);
+        }
+
+        // Serializes the held value to text using printf
+        template <typename CharType, typename OutType>
+        size_t SerializeWithPrintf(OutType output) const
+        {
+            auto value = _not_null(m_value);
+
             if (m_precision < 0)
             {
                 if (m_width < 0)
-                    return xprintf(output, PrintFormats<CharType>::place_holder(m_value), m_value);
+                    return xprintf(output, PrintFormats<CharType>::place_holder(value), value);
                 else
-                    return xprintf(output, PrintFormats<CharType>::place_holder_width(m_value), m_width, m_value);
+                    return xprintf(output, PrintFormats<CharType>::place_holder_width(value), m_width, value);
             }
             else
             {
                 if (m_width < 0)
-                    return xprintf(output, PrintFormats<CharType>::place_holder_precision(m_value), m_precision, m_value);
+                    return xprintf(output, PrintFormats<CharType>::place_holder_precision(value), m_precision, value);
                 else
-                    return xprintf(output, PrintFormats<CharType>::place_holder_width_precision(m_value), m_width, m_precision, m_value);
+                    return xprintf(output, PrintFormats<CharType>::place_holder_width_precision(value), m_width, m_precision, value);
             }
         }
 
-        // Estimates required size for serialized string
-        uint32_t EstimateStringSize() const
+        // Calculates the size required for serialized string
+        template <typename CharType>
+        size_t EstimateStringSize() const
         {
-            auto width = (m_width >= 0) ? m_width : 0;
-            auto precision = (m_precision >= 0) ? m_precision : 0;
-            return std::max((uint32_t)std::max(width, precision), (uint32_t)sizeof (ValType));
+            return std::max(_calc_formatted_length<CharType>(m_value, m_precision),
+                            static_cast<size_t> (std::max(m_width, 0)));
         }
     };
 
@@ -333,18 +624,16 @@ namespace utils
     // Serialization Helpers
     //////////////////////////////
 
-    size_t _estimate_string_size();
-
-    template <typename FirstArgVType, typename ... Args>
-    size_t _estimate_string_size(FirstArgVType &&firstArg, Args ... args)
+    template <typename CharType>
+    constexpr size_t _estimate_string_size()
     {
-        return FormatArg(firstArg).EstimateStringSize() + _estimate_string_size(args ...);
+        return 0;
     }
 
-    template <typename ... Args>
-    size_t _estimate_string_size(Args ... args)
+    template <typename CharType, typename FirstArgVType, typename ... Args>
+    size_t _estimate_string_size(FirstArgVType &&firstArg, Args ... args)
     {
-        return _estimate_string_size(args ...);
+        return FormatArg(firstArg).template EstimateStringSize<CharType>() + _estimate_string_size<CharType>(args ...);
     }
 
     template <typename CharType>
@@ -437,13 +726,16 @@ namespace utils
 
         try
         {
-            /* Try to guarantee room in the string buffer using a rough estimation
-            for the serialized string size. If the current size exceeds the estimation,
-            do nothing, otherwise, expand it. When resizing, make use of all already
-            reserved capacity if that is enough, because such allocation is cheap,
-            otherwise, just allocate memory for the estimation and hope for the best.*/
-
-            auto estReqSize = _estimate_string_size(args ...);
+            /* Guarantee room in the string buffer for the serialized string (plus
+            null terminator), whose size is calculated upfront: it is exact for integers
+            and strings and an upper bound for floating-point numbers, so the values
+            are written directly into the string in a single pass. If the current size
+            exceeds that, do nothing, otherwise, expand it. When resizing, make use of
+            all already reserved capacity if that is enough, because such allocation
+            is cheap, otherwise, just allocate memory for the calculated size. A retry
+            only happens for values formatted by printf whose size is not known. */
+
+            auto estReqSize = _estimate_string_size<CharType>(args ...) + 1;
             if (out.size() < estReqSize)
             {
                 if (out.capacity() < estReqSize)
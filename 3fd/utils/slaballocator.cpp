@@ -0,0 +1,364 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include "memory.h"
+#include <3fd/core/exceptions.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+#undef min
+#undef max
+
+namespace _3fd
+{
+namespace utils
+{
+    /// <summary>
+    /// The header placed at the base of a slab.
+    /// </summary>
+    struct SlabAllocator::Slab
+    {
+        Slab *prev;
+        Slab *next;
+        void *freeListHead; // returned blocks, linked through their first bytes
+        void *nextAddr; // first block never handed out
+        uint32_t numBlocks;
+        uint32_t numBlocksInUse;
+        size_t sizeClassIndex;
+    };
+
+    // the size of the slab header, keeping the blocks that follow it aligned
+    static const size_t slabHeaderSize = 64;
+
+    // the minimum size of a slab
+    static const size_t minSlabSize = 64 * 1024;
+
+    // how many blocks a slab must hold at least
+    static const size_t minBlocksPerSlab = 8;
+
+    // amount of size classes up to 128 bytes (8, then multiples of 16)
+    static const size_t numSmallSizeClasses = 9;
+
+    /// <summary>
+    /// Gets the position of the most significant bit set.
+    /// </summary>
+    static uint32_t GetHighestBitIndex(uint64_t value) noexcept
+    {
+        _ASSERTE(value != 0);
+#   ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return index;
+#   else
+        return 63 - __builtin_clzll(value);
+#   endif
+    }
+
+    /// <summary>
+    /// Gets the size class that serves a given request size.
+    /// </summary>
+    /// <param name="size">The request size, which cannot exceed <see cref="maxSlabBlockSize"/>.</param>
+    /// <returns>The index of the size class.</returns>
+    /// <remarks>
+    /// Up to 128 bytes, classes go in steps of 16 bytes (starting from 8 bytes).
+    /// Above that, every doubling of size is split in 4 classes, so no more than 25% is wasted.
+    /// </remarks>
+    size_t SlabAllocator::GetSizeClassIndex(size_t size) noexcept
+    {
+        _ASSERTE(size <= maxSlabBlockSize);
+
+        if (size <= 8)
+            return 0;
+
+        if (size <= 128)
+            return (size + 15) / 16;
+
+        auto log2 = GetHighestBitIndex(size - 1);
+        auto base = static_cast<size_t> (1) << log2;
+        auto step = base / 4;
+        return numSmallSizeClasses + (log2 - 7) * 4 + (size - base + step - 1) / step - 1;
+    }
+
+    /// <summary>
+    /// Gets the size of the blocks in a given size class.
+    /// </summary>
+    /// <param name="index">The index of the size class.</param>
+    /// <returns>The block size in bytes.</returns>
+    size_t SlabAllocator::GetSizeClassBlockSize(size_t index) noexcept
+    {
+        _ASSERTE(index < numSizeClasses);
+
+        if (index < numSmallSizeClasses)
+            return index == 0 ? 8 : index * 16;
+
+        auto idxLarge = index - numSmallSizeClasses;
+        auto base = static_cast<size_t> (128) << (idxLarge / 4);
+        return base + (idxLarge % 4 + 1) * (base / 4);
+    }
+
+    /// <summary>
+    /// Selects the size class to serve a request.
+    /// </summary>
+    /// <param name="size">The request size.</param>
+    /// <param name="alignment">The required alignment.</param>
+    /// <returns>The index of the size class, or <see cref="SlabAllocator::numSizeClasses"/>
+    /// when the request must bypass the slabs (large or over-aligned).</returns>
+    static size_t SelectSizeClass(size_t size, size_t alignment) noexcept
+    {
+        if (size > SlabAllocator::maxSlabBlockSize || alignment > alignof(std::max_align_t))
+            return SlabAllocator::numSizeClasses;
+
+        auto index = SlabAllocator::GetSizeClassIndex(size);
+
+        // blocks of all classes but the first are aligned to 16 bytes:
+        if (index == 0 && alignment > 8)
+            return 1;
+
+        return index;
+    }
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="SlabAllocator"/> class.
+    /// No memory is allocated before the first request.
+    /// </summary>
+    SlabAllocator::SlabAllocator() noexcept
+    {
+        static_assert(sizeof(Slab) <= slabHeaderSize, "slab header does not fit in the reserved space");
+
+        for (size_t idx = 0; idx < numSizeClasses; ++idx)
+        {
+            auto &sizeClass = m_sizeClasses[idx];
+            sizeClass.blockSize = GetSizeClassBlockSize(idx);
+            sizeClass.partialSlabs = nullptr;
+            sizeClass.fullSlabs = nullptr;
+            sizeClass.emptySlab = nullptr;
+
+            sizeClass.slabSize = minSlabSize;
+            while (sizeClass.slabSize < slabHeaderSize + minBlocksPerSlab * sizeClass.blockSize)
+                sizeClass.slabSize <<= 1;
+        }
+    }
+
+    /// <summary>
+    /// Inserts a slab at the front of a list.
+    /// </summary>
+    static void PushFront(SlabAllocator::Slab *&head, SlabAllocator::Slab *slab) noexcept
+    {
+        slab->prev = nullptr;
+        slab->next = head;
+
+        if (head != nullptr)
+            head->prev = slab;
+
+        head = slab;
+    }
+
+    /// <summary>
+    /// Removes a slab from a list.
+    /// </summary>
+    static void Unlink(SlabAllocator::Slab *&head, SlabAllocator::Slab *slab) noexcept
+    {
+        if (slab->prev != nullptr)
+            slab->prev->next = slab->next;
+        else
+            head = slab->next;
+
+        if (slab->next != nullptr)
+            slab->next->prev = slab->prev;
+
+        slab->prev = slab->next = nullptr;
+    }
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="SlabAllocator"/> class.
+    /// </summary>
+    SlabAllocator::~SlabAllocator()
+    {
+        for (auto &sizeClass : m_sizeClasses)
+        {
+            for (auto list : { sizeClass.partialSlabs, sizeClass.fullSlabs, sizeClass.emptySlab })
+            {
+                while (list != nullptr)
+                {
+                    auto next = list->next;
+                    ReleaseSlab(list);
+                    list = next;
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// Allocates a new slab, aligned to its own size.
+    /// </summary>
+    /// <param name="sizeClass">The size class the slab is for.</param>
+    /// <returns>The header of the new slab.</returns>
+    SlabAllocator::Slab * SlabAllocator::CreateSlab(SizeClass &sizeClass)
+    {
+#    ifdef _WIN32
+        auto baseAddr = _aligned_malloc(sizeClass.slabSize, sizeClass.slabSize);
+#    else
+        auto baseAddr = aligned_alloc(sizeClass.slabSize, sizeClass.slabSize);
+#    endif
+        if (baseAddr == nullptr)
+            throw core::AppException<std::runtime_error>("Failed to allocate memory for slab allocator");
+
+        auto slab = static_cast<Slab *> (baseAddr);
+        slab->prev = slab->next = nullptr;
+        slab->freeListHead = nullptr;
+        slab->nextAddr = reinterpret_cast<void *> (reinterpret_cast<uintptr_t> (baseAddr) + slabHeaderSize);
+        slab->numBlocks = static_cast<uint32_t> ((sizeClass.slabSize - slabHeaderSize) / sizeClass.blockSize);
+        slab->numBlocksInUse = 0;
+        slab->sizeClassIndex = &sizeClass - m_sizeClasses.data();
+        return slab;
+    }
+
+    /// <summary>
+    /// Releases the memory of a slab.
+    /// </summary>
+    void SlabAllocator::ReleaseSlab(Slab *slab) noexcept
+    {
+#    ifdef _WIN32
+        _aligned_free(slab);
+#    else
+        free(slab);
+#    endif
+    }
+
+    /// <summary>
+    /// Allocates memory.
+    /// </summary>
+    /// <param name="size">The amount of bytes to allocate.</param>
+    /// <param name="alignment">The required alignment.</param>
+    /// <returns>The address of the allocated memory.</returns>
+    void * SlabAllocator::Allocate(size_t size, size_t alignment)
+    {
+        auto index = SelectSizeClass(size, alignment);
+
+        // large objects & alignment beyond the guarantee of slabs bypass the slabs:
+        if (index == numSizeClasses)
+        {
+            try
+            {
+                return ::operator new(size, std::align_val_t(alignment));
+            }
+            catch (std::bad_alloc &)
+            {
+                throw core::AppException<std::runtime_error>("Failed to allocate memory for slab allocator");
+            }
+        }
+
+        auto &sizeClass = m_sizeClasses[index];
+
+        auto slab = sizeClass.partialSlabs;
+        if (slab == nullptr)
+        {
+            if (sizeClass.emptySlab != nullptr)
+            {
+                slab = sizeClass.emptySlab;
+                sizeClass.emptySlab = nullptr;
+            }
+            else
+                slab = CreateSlab(sizeClass);
+
+            PushFront(sizeClass.partialSlabs, slab);
+        }
+
+        void *block;
+        if (slab->freeListHead != nullptr)
+        {
+            block = slab->freeListHead;
+            slab->freeListHead = *static_cast<void **> (block);
+        }
+        else
+        {
+            block = slab->nextAddr;
+            slab->nextAddr = reinterpret_cast<void *> (reinterpret_cast<uintptr_t> (block) + sizeClass.blockSize);
+        }
+
+        // the slab that runs out of blocks moves to the list of full slabs:
+        if (++slab->numBlocksInUse == slab->numBlocks)
+        {
+            Unlink(sizeClass.partialSlabs, slab);
+            PushFront(sizeClass.fullSlabs, slab);
+        }
+
+        return block;
+    }
+
+    /// <summary>
+    /// Deallocates memory.
+    /// </summary>
+    /// <param name="ptr">The address of the memory to deallocate.</param>
+    /// <param name="size">The amount of bytes requested in the allocation.</param>
+    /// <param name="alignment">The alignment requested in the allocation.</param>
+    void SlabAllocator::Deallocate(void *ptr, size_t size, size_t alignment) noexcept
+    {
+        if (ptr == nullptr)
+            return;
+
+        auto index = SelectSizeClass(size, alignment);
+
+        if (index == numSizeClasses)
+        {
+            ::operator delete(ptr, std::align_val_t(alignment));
+            return;
+        }
+
+        auto &sizeClass = m_sizeClasses[index];
+
+        // Finds the slab that owns the block
+        auto slab = reinterpret_cast<Slab *> (reinterpret_cast<uintptr_t> (ptr) & ~(sizeClass.slabSize - 1));
+
+        _ASSERTE(slab->sizeClassIndex == index); // size or alignment differ from the allocation
+
+        // a full slab has now a block available:
+        if (slab->numBlocksInUse == slab->numBlocks)
+        {
+            Unlink(sizeClass.fullSlabs, slab);
+            PushFront(sizeClass.partialSlabs, slab);
+        }
+
+        *static_cast<void **> (ptr) = slab->freeListHead;
+        slab->freeListHead = ptr;
+
+        if (--slab->numBlocksInUse > 0)
+            return;
+
+        // the slab is entirely free, so keep one for reuse and release the others:
+
+        Unlink(sizeClass.partialSlabs, slab);
+
+        if (sizeClass.emptySlab == nullptr)
+        {
+            slab->freeListHead = nullptr;
+            slab->nextAddr = reinterpret_cast<void *> (reinterpret_cast<uintptr_t> (slab) + slabHeaderSize);
+            sizeClass.emptySlab = slab;
+        }
+        else
+            ReleaseSlab(slab);
+    }
+
+    /// <summary>
+    /// Releases the slabs kept for reuse.
+    /// </summary>
+    void SlabAllocator::Shrink() noexcept
+    {
+        for (auto &sizeClass : m_sizeClasses)
+        {
+            if (sizeClass.emptySlab != nullptr)
+            {
+                ReleaseSlab(sizeClass.emptySlab);
+                sizeClass.emptySlab = nullptr;
+            }
+        }
+    }
+
+} // end of namespace utils
+} // end of namespace _3fd
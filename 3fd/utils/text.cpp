@@ -5,57 +5,736 @@
 //
 #include "pch.h"
 #include "text.h"
-#include <codecvt>
-#include <locale>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#if defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2) || defined __SSE2__
+#   define _3FD_TEXT_SSE2
+#   include <immintrin.h>
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#       define _3FD_TARGET_AVX2
+#   else
+#       define _3FD_TARGET_AVX2 __attribute__((target("avx2")))
+#   endif
+#endif
 
 namespace _3fd
 {
 namespace utils
 {
-    std::string to_lower(std::string str)
+    ////////////////////////////////////////////////
+    // Unicode Conversion
+    ////////////////////////////////////////////////
+
+    /* The conversions have fast paths for blocks of ASCII characters, which use
+    SIMD instructions when available (SSE2, or AVX2 when supported by the CPU,
+    as detected at runtime), while any other characters are validated and
+    converted one by one. The wide characters are UTF-16 when 'wchar_t' has
+    2 bytes (Windows), otherwise UTF-32. */
+
+    // Converts a prefix of ASCII characters in whole blocks, returns how many were converted
+    typedef size_t (*WidenAsciiFunc)(const uint8_t *in, size_t length, wchar_t *out);
+    typedef size_t (*NarrowAsciiFunc)(const wchar_t *in, size_t length, char *out);
+
+    // Flips the case of letters from 'first' to 'first' + 25 in whole blocks, returns how many chars were converted
+    typedef size_t (*ConvertCaseFunc)(const char *in, size_t length, char *out, char first);
+
+#ifdef _3FD_TEXT_SSE2
+
+    /// <summary>
+    /// Widens blocks of 16 ASCII characters with SSE2.
+    /// </summary>
+    static size_t WidenAsciiSse2(const uint8_t *in, size_t length, wchar_t *out) noexcept
     {
-        for (char &ch : str)
+        const __m128i zero = _mm_setzero_si128();
+
+        size_t idx(0);
+        for (; idx + 16 <= length; idx += 16)
         {
-            ch = tolower(ch);
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *> (in + idx));
+            if (_mm_movemask_epi8(bytes) != 0)
+                break;
+
+            __m128i low = _mm_unpacklo_epi8(bytes, zero);
+            __m128i high = _mm_unpackhi_epi8(bytes, zero);
+            auto dest = reinterpret_cast<__m128i *> (out + idx);
+
+            if constexpr (sizeof(wchar_t) == 2)
+            {
+                _mm_storeu_si128(dest, low);
+                _mm_storeu_si128(dest + 1, high);
+            }
+            else
+            {
+                _mm_storeu_si128(dest, _mm_unpacklo_epi16(low, zero));
+                _mm_storeu_si128(dest + 1, _mm_unpackhi_epi16(low, zero));
+                _mm_storeu_si128(dest + 2, _mm_unpacklo_epi16(high, zero));
+                _mm_storeu_si128(dest + 3, _mm_unpackhi_epi16(high, zero));
+            }
         }
+        return idx;
+    }
 
-        return str;
+    /// <summary>
+    /// Narrows blocks of 16 ASCII characters with SSE2.
+    /// </summary>
+    static size_t NarrowAsciiSse2(const wchar_t *in, size_t length, char *out) noexcept
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        size_t idx(0);
+        for (; idx + 16 <= length; idx += 16)
+        {
+            auto src = reinterpret_cast<const __m128i *> (in + idx);
+            __m128i bytes;
+
+            if constexpr (sizeof(wchar_t) == 2)
+            {
+                __m128i first = _mm_loadu_si128(src);
+                __m128i second = _mm_loadu_si128(src + 1);
+
+                __m128i nonAscii = _mm_and_si128(_mm_or_si128(first, second), _mm_set1_epi16(static_cast<short> (0xFF80)));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(nonAscii, zero)) != 0xFFFF)
+                    break;
+
+                bytes = _mm_packus_epi16(first, second);
+            }
+            else
+            {
+                __m128i first = _mm_loadu_si128(src);
+                __m128i second = _mm_loadu_si128(src + 1);
+                __m128i third = _mm_loadu_si128(src + 2);
+                __m128i fourth = _mm_loadu_si128(src + 3);
+
+                __m128i all = _mm_or_si128(_mm_or_si128(first, second), _mm_or_si128(third, fourth));
+                __m128i nonAscii = _mm_and_si128(all, _mm_set1_epi32(static_cast<int> (0xFFFFFF80)));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi32(nonAscii, zero)) != 0xFFFF)
+                    break;
+
+                bytes = _mm_packus_epi16(_mm_packs_epi32(first, second), _mm_packs_epi32(third, fourth));
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *> (out + idx), bytes);
+        }
+        return idx;
     }
 
-    std::string to_upper(std::string str)
+    /// <summary>
+    /// Converts the case of blocks of 16 characters with SSE2.
+    /// </summary>
+    static size_t ConvertCaseSse2(const char *in, size_t length, char *out, char first) noexcept
     {
-        for (char &ch : str)
+        // signed comparison leaves out the bytes from 0x80 on:
+        const __m128i belowFirst = _mm_set1_epi8(first - 1);
+        const __m128i aboveLast = _mm_set1_epi8(first + 26);
+        const __m128i caseBit = _mm_set1_epi8(0x20);
+
+        size_t idx(0);
+        for (; idx + 16 <= length; idx += 16)
         {
-            ch = toupper(ch);
+            __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *> (in + idx));
+            __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(chars, belowFirst), _mm_cmplt_epi8(chars, aboveLast));
+            chars = _mm_xor_si128(chars, _mm_and_si128(isLetter, caseBit));
+            _mm_storeu_si128(reinterpret_cast<__m128i *> (out + idx), chars);
         }
+        return idx;
+    }
 
-        return str;
+    /// <summary>
+    /// Widens blocks of 32 ASCII characters with AVX2, then the rest with SSE2.
+    /// </summary>
+    _3FD_TARGET_AVX2
+    static size_t WidenAsciiAvx2(const uint8_t *in, size_t length, wchar_t *out) noexcept
+    {
+        size_t idx(0);
+        for (; idx + 32 <= length; idx += 32)
+        {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *> (in + idx));
+            if (_mm256_movemask_epi8(bytes) != 0)
+                break;
+
+            auto dest = reinterpret_cast<__m256i *> (out + idx);
+
+            if constexpr (sizeof(wchar_t) == 2)
+            {
+                _mm256_storeu_si256(dest, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)));
+                _mm256_storeu_si256(dest + 1, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)));
+            }
+            else
+            {
+                for (int part = 0; part < 4; ++part)
+                {
+                    __m128i eightBytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *> (in + idx + 8 * part));
+                    _mm256_storeu_si256(dest + part, _mm256_cvtepu8_epi32(eightBytes));
+                }
+            }
+        }
+
+        // avoid the penalty of switching to legacy SSE with dirty upper halves of YMM registers:
+        _mm256_zeroupper();
+        return idx + WidenAsciiSse2(in + idx, length - idx, out + idx);
+    }
+
+    /// <summary>
+    /// Narrows blocks of 32 ASCII characters with AVX2, then the rest with SSE2.
+    /// </summary>
+    _3FD_TARGET_AVX2
+    static size_t NarrowAsciiAvx2(const wchar_t *in, size_t length, char *out) noexcept
+    {
+        size_t idx(0);
+        for (; idx + 32 <= length; idx += 32)
+        {
+            auto src = reinterpret_cast<const __m256i *> (in + idx);
+            __m256i bytes;
+
+            if constexpr (sizeof(wchar_t) == 2)
+            {
+                __m256i first = _mm256_loadu_si256(src);
+                __m256i second = _mm256_loadu_si256(src + 1);
+
+                if (!_mm256_testz_si256(_mm256_or_si256(first, second), _mm256_set1_epi16(static_cast<short> (0xFF80))))
+                    break;
+
+                // packing works within 128-bit lanes, so fix the order of the 64-bit parts:
+                bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), 0xD8);
+            }
+            else
+            {
+                __m256i first = _mm256_loadu_si256(src);
+                __m256i second = _mm256_loadu_si256(src + 1);
+                __m256i third = _mm256_loadu_si256(src + 2);
+                __m256i fourth = _mm256_loadu_si256(src + 3);
+
+                __m256i all = _mm256_or_si256(_mm256_or_si256(first, second), _mm256_or_si256(third, fourth));
+                if (!_mm256_testz_si256(all, _mm256_set1_epi32(static_cast<int> (0xFFFFFF80))))
+                    break;
+
+                // packing works within 128-bit lanes, so fix the order of the 32-bit parts:
+                __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(first, second), _mm256_packs_epi32(third, fourth));
+                bytes = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+            }
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i *> (out + idx), bytes);
+        }
+
+        // avoid the penalty of switching to legacy SSE with dirty upper halves of YMM registers:
+        _mm256_zeroupper();
+        return idx + NarrowAsciiSse2(in + idx, length - idx, out + idx);
+    }
+
+    /// <summary>
+    /// Converts the case of blocks of 32 characters with AVX2, then the rest with SSE2.
+    /// </summary>
+    _3FD_TARGET_AVX2
+    static size_t ConvertCaseAvx2(const char *in, size_t length, char *out, char first) noexcept
+    {
+        const __m256i belowFirst = _mm256_set1_epi8(first - 1);
+        const __m256i aboveLast = _mm256_set1_epi8(first + 26);
+        const __m256i caseBit = _mm256_set1_epi8(0x20);
+
+        size_t idx(0);
+        for (; idx + 32 <= length; idx += 32)
+        {
+            __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *> (in + idx));
+            __m256i isLetter = _mm256_and_si256(_mm256_cmpgt_epi8(chars, belowFirst), _mm256_cmpgt_epi8(aboveLast, chars));
+            chars = _mm256_xor_si256(chars, _mm256_and_si256(isLetter, caseBit));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *> (out + idx), chars);
+        }
+
+        // avoid the penalty of switching to legacy SSE with dirty upper halves of YMM registers:
+        _mm256_zeroupper();
+        return idx + ConvertCaseSse2(in + idx, length - idx, out + idx, first);
+    }
+
+    /// <summary>
+    /// Tells whether the CPU and the OS support AVX2.
+    /// </summary>
+    static bool IsAvx2Supported() noexcept
+    {
+#   ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        __cpuid(info, 1);
+        const bool osUsesXSave = (info[2] & (1 << 27)) != 0;
+        if (!osUsesXSave || (_xgetbv(0) & 0x6) != 0x6) // are YMM registers saved by the OS?
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#   else
+        return __builtin_cpu_supports("avx2") != 0;
+#   endif
+    }
+
+#else
+
+    /// <summary>
+    /// Widens blocks of 8 ASCII characters, tested at once as a 64-bit word.
+    /// </summary>
+    static size_t WidenAsciiScalar(const uint8_t *in, size_t length, wchar_t *out) noexcept
+    {
+        size_t idx(0);
+        for (; idx + 8 <= length; idx += 8)
+        {
+            uint64_t word;
+            memcpy(&word, in + idx, sizeof word);
+            if ((word & 0x8080808080808080ULL) != 0)
+                break;
+
+            for (size_t offset = 0; offset < 8; ++offset)
+                out[idx + offset] = in[idx + offset];
+        }
+        return idx;
+    }
+
+    /// <summary>
+    /// Narrows blocks of 8 ASCII characters.
+    /// </summary>
+    static size_t NarrowAsciiScalar(const wchar_t *in, size_t length, char *out) noexcept
+    {
+        size_t idx(0);
+        for (; idx + 8 <= length; idx += 8)
+        {
+            uint32_t bits(0);
+            for (size_t offset = 0; offset < 8; ++offset)
+                bits |= static_cast<uint32_t> (in[idx + offset]);
+
+            if (bits >= 0x80)
+                break;
+
+            for (size_t offset = 0; offset < 8; ++offset)
+                out[idx + offset] = static_cast<char> (in[idx + offset]);
+        }
+        return idx;
+    }
+
+    /// <summary>
+    /// Converts the case of blocks of 8 characters, handled at once as a 64-bit word.
+    /// </summary>
+    static size_t ConvertCaseScalar(const char *in, size_t length, char *out, char first) noexcept
+    {
+        const uint64_t ones = 0x0101010101010101ULL;
+        const uint64_t highBits = 0x8080808080808080ULL;
+        const uint64_t geFirst = ones * static_cast<uint8_t> (0x80 - first);
+        const uint64_t gtLast = ones * static_cast<uint8_t> (0x7F - (first + 25));
+
+        size_t idx(0);
+        for (; idx + 8 <= length; idx += 8)
+        {
+            uint64_t word;
+            memcpy(&word, in + idx, sizeof word);
+
+            // in each byte, the high bit tells whether the char is a letter in range (no carry crosses bytes):
+            const uint64_t heptets = word & ~highBits;
+            const uint64_t isLetter = ~word & ((heptets + geFirst) ^ (heptets + gtLast)) & highBits;
+
+            word ^= isLetter >> 2; // 0x80 >> 2 = 0x20
+            memcpy(out + idx, &word, sizeof word);
+        }
+        return idx;
+    }
+
+#endif // end of _3FD_TEXT_SSE2
+
+    /// <summary>
+    /// The fastest conversions of ASCII blocks supported by this CPU, selected only once.
+    /// </summary>
+    struct AsciiConverters
+    {
+        WidenAsciiFunc widen;
+        NarrowAsciiFunc narrow;
+        ConvertCaseFunc convertCase;
+
+        static const AsciiConverters &Get() noexcept
+        {
+#   ifdef _3FD_TEXT_SSE2
+            static const AsciiConverters converters = IsAvx2Supported()
+                ? AsciiConverters{ &WidenAsciiAvx2, &NarrowAsciiAvx2, &ConvertCaseAvx2 }
+                : AsciiConverters{ &WidenAsciiSse2, &NarrowAsciiSse2, &ConvertCaseSse2 };
+#   else
+            static const AsciiConverters converters{ &WidenAsciiScalar, &NarrowAsciiScalar, &ConvertCaseScalar };
+#   endif
+            return converters;
+        }
+    };
+
+    [[noreturn]] static void ThrowInvalidEncoding(const char *what, size_t offset)
+    {
+        std::ostringstream oss;
+        oss << "Invalid sequence at position " << offset;
+        throw core::AppException<std::invalid_argument>(what, oss.str());
+    }
+
+    /// <summary>
+    /// Decodes a character from UTF-8, validating it.
+    /// </summary>
+    /// <param name="in">The input text.</param>
+    /// <param name="length">The length of the input text.</param>
+    /// <param name="idx">The position of the character, which is moved to the next one.</param>
+    /// <returns>The code point, or <c>UINT32_MAX</c> if the sequence is invalid.</returns>
+    static inline uint32_t DecodeUtf8(const uint8_t *in, size_t length, size_t &idx) noexcept
+    {
+        const uint32_t lead = in[idx];
+        const size_t numAvailable = length - idx;
+
+        auto isContinuation = [](uint32_t byte) { return (byte & 0xC0) == 0x80; };
+
+        if (lead < 0x80)
+        {
+            ++idx;
+            return lead;
+        }
+        else if (lead < 0xE0)
+        {
+            if (lead < 0xC2 || numAvailable < 2 || !isContinuation(in[idx + 1])) // (rules out overlong forms)
+                return UINT32_MAX;
+
+            idx += 2;
+            return ((lead & 0x1F) << 6) | (in[idx - 1] & 0x3F);
+        }
+        else if (lead < 0xF0)
+        {
+            if (numAvailable < 3 || !isContinuation(in[idx + 1]) || !isContinuation(in[idx + 2]))
+                return UINT32_MAX;
+
+            uint32_t codePoint = ((lead & 0x0F) << 12) | ((in[idx + 1] & 0x3F) << 6) | (in[idx + 2] & 0x3F);
+            if (codePoint < 0x800 || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) // overlong form or surrogate
+                return UINT32_MAX;
+
+            idx += 3;
+            return codePoint;
+        }
+        else if (lead < 0xF5)
+        {
+            if (numAvailable < 4 || !isContinuation(in[idx + 1]) || !isContinuation(in[idx + 2]) || !isContinuation(in[idx + 3]))
+                return UINT32_MAX;
+
+            uint32_t codePoint = ((lead & 0x07) << 18) | ((in[idx + 1] & 0x3F) << 12) | ((in[idx + 2] & 0x3F) << 6) | (in[idx + 3] & 0x3F);
+            if (codePoint < 0x10000 || codePoint > 0x10FFFF) // overlong form or beyond the last code point
+                return UINT32_MAX;
+
+            idx += 4;
+            return codePoint;
+        }
+        else
+            return UINT32_MAX;
+    }
+
+    /// <summary>
+    /// Converts UTF-8 to wide characters, writing into a buffer provided by the caller.
+    /// </summary>
+    /// <param name="input">The input text in UTF-8.</param>
+    /// <param name="output">The output buffer.</param>
+    /// <param name="outputLength">The length of the buffer, which must be at least the length of the input.</param>
+    /// <returns>How many characters were written in the buffer.</returns>
+    size_t to_ucs2(std::string_view input, wchar_t *output, size_t outputLength)
+    {
+        if (outputLength < input.size())
+            throw core::AppException<std::logic_error>("Failed to convert text from UTF-8: buffer is too short!");
+
+        const auto widenAscii = AsciiConverters::Get().widen;
+        const auto in = reinterpret_cast<const uint8_t *> (input.data());
+        const size_t length = input.size();
+
+        wchar_t *out = output;
+        size_t idx(0);
+        while (idx < length)
+        {
+            // fast path for ASCII:
+            if (in[idx] < 0x80)
+            {
+                auto count = widenAscii(in + idx, length - idx, out);
+                idx += count;
+                out += count;
+            }
+
+            // any other character is handled one by one, but soon retry the fast path:
+            const size_t segmentEnd = std::min(length, idx + 16);
+            while (idx < segmentEnd)
+            {
+                const size_t position = idx;
+                uint32_t codePoint = DecodeUtf8(in, length, idx);
+
+                if (codePoint == UINT32_MAX)
+                    ThrowInvalidEncoding("Failed to convert text from UTF-8: invalid encoding", position);
+
+                if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+                {
+                    codePoint -= 0x10000;
+                    *out++ = static_cast<wchar_t> (0xD800 + (codePoint >> 10));
+                    *out++ = static_cast<wchar_t> (0xDC00 + (codePoint & 0x3FF));
+                }
+                else
+                    *out++ = static_cast<wchar_t> (codePoint);
+            }
+        }
+
+        return out - output;
+    }
+
+    /// <summary>
+    /// Converts wide characters to UTF-8, writing into a buffer provided by the caller.
+    /// </summary>
+    /// <param name="input">The input text in wide characters.</param>
+    /// <param name="output">The output buffer.</param>
+    /// <param name="outputLength">
+    /// The length of the buffer, which must be at least <see cref="GetMaxUtf8Length"/> for the input.
+    /// </param>
+    /// <returns>How many characters were written in the buffer.</returns>
+    size_t to_utf8(std::wstring_view input, char *output, size_t outputLength)
+    {
+        if (outputLength < GetMaxUtf8Length(input.size()))
+            throw core::AppException<std::logic_error>("Failed to convert text to UTF-8: buffer is too short!");
+
+        const auto narrowAscii = AsciiConverters::Get().narrow;
+        const wchar_t *in = input.data();
+        const size_t length = input.size();
+
+        char *out = output;
+        size_t idx(0);
+        while (idx < length)
+        {
+            // fast path for ASCII:
+            if (static_cast<uint32_t> (in[idx]) < 0x80)
+            {
+                auto count = narrowAscii(in + idx, length - idx, out);
+                idx += count;
+                out += count;
+            }
+
+            // any other character is handled one by one, but soon retry the fast path:
+            const size_t segmentEnd = std::min(length, idx + 16);
+            while (idx < segmentEnd)
+            {
+                const size_t position = idx;
+                auto codePoint = static_cast<uint32_t> (in[idx++]);
+
+                if (codePoint >= 0xD800 && codePoint <= 0xDFFF)
+                {
+                    // in UTF-16, a high surrogate must be followed by a low one:
+                    if (sizeof(wchar_t) == 2
+                        && codePoint <= 0xDBFF
+                        && idx < length
+                        && static_cast<uint32_t> (in[idx]) >= 0xDC00
+                        && static_cast<uint32_t> (in[idx]) <= 0xDFFF)
+                    {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (static_cast<uint32_t> (in[idx++]) - 0xDC00);
+                    }
+                    else
+                        ThrowInvalidEncoding("Failed to convert text to UTF-8: invalid encoding", position);
+                }
+                else if (codePoint > 0x10FFFF)
+                    ThrowInvalidEncoding("Failed to convert text to UTF-8: invalid encoding", position);
+
+                if (codePoint < 0x80)
+                {
+                    *out++ = static_cast<char> (codePoint);
+                }
+                else if (codePoint < 0x800)
+                {
+                    *out++ = static_cast<char> (0xC0 | (codePoint >> 6));
+                    *out++ = static_cast<char> (0x80 | (codePoint & 0x3F));
+                }
+                else if (codePoint < 0x10000)
+                {
+                    *out++ = static_cast<char> (0xE0 | (codePoint >> 12));
+                    *out++ = static_cast<char> (0x80 | ((codePoint >> 6) & 0x3F));
+                    *out++ = static_cast<char> (0x80 | (codePoint & 0x3F));
+                }
+                else
+                {
+                    *out++ = static_cast<char> (0xF0 | (codePoint >> 18));
+                    *out++ = static_cast<char> (0x80 | ((codePoint >> 12) & 0x3F));
+                    *out++ = static_cast<char> (0x80 | ((codePoint >> 6) & 0x3F));
+                    *out++ = static_cast<char> (0x80 | (codePoint & 0x3F));
+                }
+            }
+        }
+
+        return out - output;
+    }
+
+    std::wstring to_ucs2(std::string_view input)
+    {
+        std::wstring output(input.size(), L'\0');
+        output.resize(to_ucs2(input, &output[0], output.size()));
+        return output;
+    }
+
+    std::string to_utf8(std::wstring_view input)
+    {
+        std::string output(GetMaxUtf8Length(input.size()), '\0');
+        output.resize(to_utf8(input, &output[0], output.size()));
+        return output;
     }
 
     ////////////////////////////////////////////////
-    // Unicode Conversion
+    // Case Conversion (ASCII)
     ////////////////////////////////////////////////
 
-    std::wstring to_ucs2(std::string_view input)
+    /* Only ASCII letters are converted, just like in the C locale,
+    and all the other characters (including UTF-8 sequences) are
+    preserved, so the conversion can take whole blocks at once. */
+
+    static inline bool IsInRange(char ch, char first) noexcept
+    {
+        return static_cast<uint8_t> (ch - first) < 26;
+    }
+
+    static inline char ToLowerAscii(char ch) noexcept
+    {
+        return IsInRange(ch, 'A') ? (ch | 0x20) : ch;
+    }
+
+    static void ConvertCase(const char *in, size_t length, char *out, char first) noexcept
+    {
+        size_t idx = AsciiConverters::Get().convertCase(in, length, out, first);
+        for (; idx < length; ++idx)
+            out[idx] = IsInRange(in[idx], first) ? (in[idx] ^ 0x20) : in[idx];
+    }
+
+    /// <summary>
+    /// Converts text to lower case, changing it in place.
+    /// </summary>
+    void to_lower_in_place(char *str, size_t length) noexcept
+    {
+        ConvertCase(str, length, str, 'A');
+    }
+
+    /// <summary>
+    /// Converts text to upper case, changing it in place.
+    /// </summary>
+    void to_upper_in_place(char *str, size_t length) noexcept
+    {
+        ConvertCase(str, length, str, 'a');
+    }
+
+    /// <summary>
+    /// Converts text to lower case, writing into a buffer provided by the caller.
+    /// </summary>
+    /// <param name="input">The input text.</param>
+    /// <param name="output">The output buffer.</param>
+    /// <param name="outputLength">The length of the buffer, which must be at least the length of the input.</param>
+    /// <returns>How many characters were written in the buffer.</returns>
+    size_t to_lower(std::string_view input, char *output, size_t outputLength)
+    {
+        if (outputLength < input.size())
+            throw core::AppException<std::logic_error>("Failed to convert text to lower case: buffer is too short!");
+
+        ConvertCase(input.data(), input.size(), output, 'A');
+        return input.size();
+    }
+
+    /// <summary>
+    /// Converts text to upper case, writing into a buffer provided by the caller.
+    /// </summary>
+    /// <param name="input">The input text.</param>
+    /// <param name="output">The output buffer.</param>
+    /// <param name="outputLength">The length of the buffer, which must be at least the length of the input.</param>
+    /// <returns>How many characters were written in the buffer.</returns>
+    size_t to_upper(std::string_view input, char *output, size_t outputLength)
     {
-        if (!input.empty())
+        if (outputLength < input.size())
+            throw core::AppException<std::logic_error>("Failed to convert text to upper case: buffer is too short!");
+
+        ConvertCase(input.data(), input.size(), output, 'a');
+        return input.size();
+    }
+
+    std::string to_lower(std::string str)
+    {
+        to_lower_in_place(&str[0], str.size());
+        return str;
+    }
+
+    std::string to_upper(std::string str)
+    {
+        to_upper_in_place(&str[0], str.size());
+        return str;
+    }
+
+    /// <summary>
+    /// Finds the first position where the texts differ regardless of case.
+    /// </summary>
+    static size_t MismatchIgnoreCase(const char *left, const char *right, size_t length) noexcept
+    {
+        size_t idx(0);
+#   ifdef _3FD_TEXT_SSE2
+        const __m128i belowFirst = _mm_set1_epi8('A' - 1);
+        const __m128i aboveLast = _mm_set1_epi8('Z' + 1);
+        const __m128i caseBit = _mm_set1_epi8(0x20);
+
+        // skips the blocks that are equal, the scalar loop finds the exact position:
+        for (; idx + 16 <= length; idx += 16)
         {
-            std::wstring_convert<std::codecvt_utf8<wchar_t>> transcoder;
-            return transcoder.from_bytes(input.data(), input.data() + input.length());
+            __m128i leftChars = _mm_loadu_si128(reinterpret_cast<const __m128i *> (left + idx));
+            __m128i rightChars = _mm_loadu_si128(reinterpret_cast<const __m128i *> (right + idx));
+
+            leftChars = _mm_or_si128(leftChars,
+                _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi8(leftChars, belowFirst), _mm_cmplt_epi8(leftChars, aboveLast)), caseBit));
+
+            rightChars = _mm_or_si128(rightChars,
+                _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi8(rightChars, belowFirst), _mm_cmplt_epi8(rightChars, aboveLast)), caseBit));
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(leftChars, rightChars)) != 0xFFFF)
+                break;
         }
+#   endif
+        for (; idx < length; ++idx)
+        {
+            if (ToLowerAscii(left[idx]) != ToLowerAscii(right[idx]))
+                break;
+        }
+        return idx;
+    }
 
-        return std::wstring();
+    /// <summary>
+    /// Tells whether two texts are equal regardless of case.
+    /// </summary>
+    bool equals_ignore_case(std::string_view left, std::string_view right) noexcept
+    {
+        return left.size() == right.size()
+            && MismatchIgnoreCase(left.data(), right.data(), left.size()) == left.size();
     }
 
-    std::string to_utf8(std::wstring_view input)
+    /// <summary>
+    /// Compares two texts regardless of case.
+    /// </summary>
+    /// <returns>
+    /// A negative value if <paramref name="left"/> comes first, a positive
+    /// value if <paramref name="right"/> comes first, otherwise zero.
+    /// </returns>
+    int compare_ignore_case(std::string_view left, std::string_view right) noexcept
     {
-        if (!input.empty())
+        const size_t length = std::min(left.size(), right.size());
+        const size_t idx = MismatchIgnoreCase(left.data(), right.data(), length);
+
+        if (idx < length)
         {
-            std::wstring_convert<std::codecvt_utf8<wchar_t>> transcoder;
-            return transcoder.to_bytes(input.data(), input.data() + input.length());
+            return static_cast<int> (static_cast<uint8_t> (ToLowerAscii(left[idx])))
+                - static_cast<int> (static_cast<uint8_t> (ToLowerAscii(right[idx])));
         }
 
-        return std::string();
+        return (left.size() < right.size()) ? -1 : (left.size() > right.size() ? 1 : 0);
+    }
+
+    /// <summary>
+    /// Calculates a hash (FNV-1a) of text, which is the same regardless of case.
+    /// </summary>
+    size_t hash_ignore_case(std::string_view str) noexcept
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (char ch : str)
+        {
+            hash ^= static_cast<uint8_t> (ToLowerAscii(ch));
+            hash *= 1099511628211ULL;
+        }
+        return static_cast<size_t> (hash);
     }
 
 }// end of namespace utils
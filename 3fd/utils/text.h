@@ -6,6 +6,7 @@
 #ifndef UTILS_STRINGS_H // header guard
 #define UTILS_STRINGS_H
 
+#include <3fd/utils/concurrenthashmap.h>
 #include <3fd/utils/serialization.h>
 
 #include <algorithm>
@@ -15,9 +16,11 @@
 #include <cinttypes>
 #include <codecvt>
 #include <iterator>
-#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #ifdef _WIN32
 #   define strtok_x strtok_s
@@ -29,9 +32,58 @@ namespace _3fd
 {
 namespace utils
 {
+    ////////////////////////////////////////////////
+    // Case Conversion (ASCII)
+    ////////////////////////////////////////////////
+
+    void to_lower_in_place(char *str, size_t length) noexcept;
+    void to_upper_in_place(char *str, size_t length) noexcept;
+
+    size_t to_lower(std::string_view input, char *output, size_t outputLength);
+    size_t to_upper(std::string_view input, char *output, size_t outputLength);
+
     std::string to_lower(std::string str);
     std::string to_upper(std::string str);
 
+    bool equals_ignore_case(std::string_view left, std::string_view right) noexcept;
+
+    int compare_ignore_case(std::string_view left, std::string_view right) noexcept;
+
+    size_t hash_ignore_case(std::string_view str) noexcept;
+
+    /// <summary>
+    /// Functor "hash" for text regardless of case.
+    /// </summary>
+    struct IgnoreCaseFunctorHash
+    {
+        size_t operator()(std::string_view str) const noexcept
+        {
+            return hash_ignore_case(str);
+        }
+    };
+
+    /// <summary>
+    /// Functor "equal to" for text regardless of case.
+    /// </summary>
+    struct IgnoreCaseFunctorEqual
+    {
+        bool operator()(std::string_view left, std::string_view right) const noexcept
+        {
+            return equals_ignore_case(left, right);
+        }
+    };
+
+    /// <summary>
+    /// Functor "less" for text regardless of case.
+    /// </summary>
+    struct IgnoreCaseFunctorLess
+    {
+        bool operator()(std::string_view left, std::string_view right) const noexcept
+        {
+            return compare_ignore_case(left, right) < 0;
+        }
+    };
+
     ////////////////////////////////////////////////
     // Type Manipulation
     ////////////////////////////////////////////////
@@ -57,6 +109,19 @@ namespace utils
 
     std::string to_utf8(std::wstring_view input);
 
+    size_t to_ucs2(std::string_view input, wchar_t *output, size_t outputLength);
+
+    size_t to_utf8(std::wstring_view input, char *output, size_t outputLength);
+
+    /// <summary>
+    /// Gets the greatest length that wide characters can take once converted to UTF-8.
+    /// </summary>
+    constexpr size_t GetMaxUtf8Length(size_t numWideChars)
+    {
+        // a character in UTF-16 takes up to 3 bytes (a surrogate pair, 4 bytes), in UTF-32 up to 4 bytes:
+        return (sizeof(wchar_t) == 2 ? 3 : 4) * numWideChars;
+    }
+
     // assume that we are using std::string only with UTF-8 content
     inline std::string_view to_utf8(std::string_view input) { return input; }
 
@@ -76,75 +141,208 @@ namespace utils
     template <typename string_t, typename string_view_t, typename char_t>
     class TextPlaceholderReplacementHelper
     {
-    private:
-        // holds the pieces of string to form the final string
-        std::vector<string_view_t> m_pieces;
+    public:
 
-        // maps a placeholder name to the index of a string piece
-        std::map<string_view_t, string_t> m_replacements;
+        /// <summary>
+        /// A text parsed into pieces of literal text and slots for the placeholders.
+        /// Placeholders with the same name share a slot.
+        /// </summary>
+        class Template
+        {
+        private:
 
-        const string_view_t m_referenceText;
+            static constexpr uint32_t literalText = UINT32_MAX;
 
-        const char_t m_placeholderMarker;
+            struct Piece
+            {
+                string_view_t text; // literal text, or placeholder name (without marker)
+                uint32_t slot; // index of slot, or 'literalText'
+            };
 
-        static bool IsCharAllowedInPlaceholderName(char ch)
-        {
-            return isalnum(ch) != 0 || ch == '_';
-        }
+            // own copy of the text, which the pieces refer to
+            const string_t m_text;
+
+            std::vector<Piece> m_pieces;
 
-        static bool IsCharAllowedInPlaceholderName(wchar_t ch)
+            // names of placeholders (without marker) by slot index
+            std::vector<string_view_t> m_slotNames;
+
+            const char_t m_placeholderMarker;
+
+            static bool IsCharAllowedInPlaceholderName(char ch)
+            {
+                return isalnum(ch) != 0 || ch == '_';
+            }
+
+            static bool IsCharAllowedInPlaceholderName(wchar_t ch)
+            {
+                return iswalnum(ch) != 0 || ch == L'_';
+            }
+
+        public:
+
+            /// <summary>Parses the text and finds the placeholders.</summary>
+            /// <param name="placeholderMarker">
+            /// The character that marks the start of a placeholder.
+            /// Alphanumeric ASCII characters and '_' are the only allowed for a placeholder,
+            /// while being forbidden for a marker.
+            /// </param>
+            /// <param name="text">The text where the placeholders must be replaced.</param>
+            Template(char_t placeholderMarker, string_view_t reference)
+                : m_text(reference.data(), reference.size())
+                , m_placeholderMarker(placeholderMarker)
+            {
+                string_view_t text(m_text);
+                size_t offset(0);
+                while (offset < text.size())
+                {
+                    size_t tokenPos = text.find(placeholderMarker, offset);
+                    if (tokenPos == string_view_t::npos)
+                        tokenPos = text.size();
+
+                    // store text piece before token:
+                    if (tokenPos > offset)
+                        m_pieces.push_back(Piece{ text.substr(offset, tokenPos - offset), literalText });
+
+                    // parse placeholder:
+                    size_t placeholderLength(0);
+                    if (tokenPos < text.size())
+                    {
+                        auto nameBegin = text.begin() + tokenPos + 1;
+                        auto nameEnd = std::find_if_not(nameBegin,
+                                                        text.end(),
+                                                        [](char_t ch) { return IsCharAllowedInPlaceholderName(ch); });
+
+                        string_view_t name = text.substr(tokenPos + 1, nameEnd - nameBegin);
+                        placeholderLength = name.size() + 1;
+
+                        // store placeholder piece:
+                        auto slot = FindSlot(name);
+                        if (slot == literalText)
+                        {
+                            slot = static_cast<uint32_t> (m_slotNames.size());
+                            m_slotNames.push_back(name);
+                        }
+
+                        m_pieces.push_back(Piece{ name, slot });
+                    }
+
+                    offset = tokenPos + placeholderLength;
+                }
+            }
+
+            Template(const Template &) = delete;
+
+            /// <summary>Tells whether this template was parsed from the same text with the same marker.</summary>
+            bool Matches(char_t placeholderMarker, string_view_t text) const noexcept
+            {
+                return placeholderMarker == m_placeholderMarker && string_view_t(m_text) == text;
+            }
+
+            size_t GetNumSlots() const noexcept { return m_slotNames.size(); }
+
+            /// <summary>Finds the slot of a placeholder.</summary>
+            /// <param name="name">The placeholder name (without marker).</param>
+            /// <returns>The slot index, or <c>UINT32_MAX</c> if not found.</returns>
+            uint32_t FindSlot(string_view_t name) const noexcept
+            {
+                // a text has a few placeholders, so a linear search is the fastest:
+                for (uint32_t idx = 0; idx < m_slotNames.size(); ++idx)
+                {
+                    if (m_slotNames[idx] == name)
+                        return idx;
+                }
+
+                return literalText;
+            }
+
+            /// <summary>Emits the text with the placeholders replaced.</summary>
+            /// <param name="replacements">The replacement for each slot.</param>
+            /// <returns>The text with placeholders replaced.</returns>
+            string_t Emit(const std::vector<string_t> &replacements) const
+            {
+                _ASSERTE(replacements.size() == m_slotNames.size());
+
+                size_t length(0);
+                for (auto &piece : m_pieces)
+                    length += (piece.slot == literalText) ? piece.text.size() : replacements[piece.slot].size();
+
+                string_t result;
+                result.reserve(length);
+
+                for (auto &piece : m_pieces)
+                {
+                    if (piece.slot == literalText)
+                        result.append(piece.text.data(), piece.text.size());
+                    else
+                        result.append(replacements[piece.slot]);
+                }
+
+                return result;
+            }
+        };
+
+    private:
+
+        // shared with the cache, so an evicted template lives while still in use
+        std::shared_ptr<const Template> m_template;
+
+        // replacements by slot index
+        std::vector<string_t> m_replacements;
+
+        explicit TextPlaceholderReplacementHelper(std::shared_ptr<const Template> textTemplate)
+            : m_template(std::move(textTemplate))
+            , m_replacements(m_template->GetNumSlots())
         {
-            return iswalnum(ch) != 0 || ch == L'_';
         }
 
-        /// <summary>Constructs a new object by parsing the text and finding the placeholders.</summary>
-        /// <param name="placeholderMarker">
-        /// The character that marks the start of a placeholder.
-        /// Alphanumeric ASCII characters and '_' are the only allowed for a placeholder,
-        /// while being forbidden for a marker.
-        /// </param>
-        /// <param name="text">The text where the placeholders must be replaced.</param>
-        TextPlaceholderReplacementHelper(char_t placeholderMarker, string_view_t text)
-            : m_referenceText(text)
-            , m_placeholderMarker(placeholderMarker)
+        /// <summary>
+        /// Gets the template parsed from a string literal, which is parsed only once and
+        /// then looked up by address (lock-free). Because an array that is not a literal
+        /// might be reused with other contents, the text is compared on every hit, and
+        /// a template that no longer matches is replaced in the cache.
+        /// </summary>
+        static std::shared_ptr<const Template> GetTemplate(char_t placeholderMarker, string_view_t text)
         {
-            size_t offset(0);
-            do
+            struct Cache
             {
-                size_t tokenPos = text.find(placeholderMarker, offset);
-                if (tokenPos == string_t::npos)
-                    tokenPos = text.size();
-
-                // store text piece before token:
-                if (tokenPos > offset)
-                    m_pieces.push_back(string_view_t(text.data() + offset, tokenPos - offset));
-
-                // parse placeholder:
-                ptrdiff_t placeholderLength(0);
-                auto placeholderIterBegin = text.begin() + tokenPos;
-                if (text.end() != placeholderIterBegin)
-                {
-                    placeholderLength =
-                        std::find_if_not(placeholderIterBegin + 1,
-                                            text.end(),
-                                            [](char_t ch) { return IsCharAllowedInPlaceholderName(ch); }) -
-                        placeholderIterBegin;
-
-                    // store placeholder piece (with marker)
-                    m_pieces.push_back(string_view_t(text.data() + tokenPos, placeholderLength));
-                }
+                ConcurrentHashMap<const char_t *, std::shared_ptr<const Template>> index;
+                std::mutex mutex;
+            };
+
+            static Cache cache;
+
+            std::shared_ptr<const Template> textTemplate;
+            if (cache.index.Find(text.data(), textTemplate)
+                && textTemplate->Matches(placeholderMarker, text))
+            {
+                return textTemplate;
+            }
+
+            std::lock_guard<std::mutex> lock(cache.mutex);
 
-                offset = tokenPos + placeholderLength;
+            if (cache.index.Find(text.data(), textTemplate)
+                && textTemplate->Matches(placeholderMarker, text))
+            {
+                return textTemplate;
+            }
 
-            } while (offset < text.size());
+            // the stale template (if any) is released once no helper uses it anymore:
+            textTemplate.reset(dbg_new Template(placeholderMarker, text));
+            cache.index.InsertOrAssign(text.data(), textTemplate);
+            return textTemplate;
         }
 
     public:
+
         // this template guarantees that only string literals can be used
         template <size_t SizeLiteral>
         static TextPlaceholderReplacementHelper in(char_t placeholderMarker, const char_t (&text)[SizeLiteral])
         {
-            return TextPlaceholderReplacementHelper(placeholderMarker, string_view_t(text, SizeLiteral));
+            // without null terminator:
+            return TextPlaceholderReplacementHelper(
+                GetTemplate(placeholderMarker, string_view_t(text, SizeLiteral - 1))
+            );
         }
 
         /// <summary>Prepares a replacement of a placeholder by a serialized value.</summary>
@@ -157,8 +355,7 @@ namespace utils
         {
             std::array<char_t, 32> buffer;
             auto length = SerializeTo(buffer, toValue);
-            m_replacements[from] = string_view_t(buffer.data(), length);
-            return *this;
+            return Replace(from, string_view_t(buffer.data(), length));
         }
 
         /// <summary>Prepares a replacement of a placeholder by a string.</summary>
@@ -167,7 +364,10 @@ namespace utils
         /// <returns>A reference to this object (so the calls can be chained.)</returns>
         TextPlaceholderReplacementHelper &Replace(string_view_t from, string_view_t to)
         {
-            m_replacements[from] = to;
+            auto slot = m_template->FindSlot(from);
+            if (slot < m_replacements.size())
+                m_replacements[slot].assign(to.data(), to.size());
+
             return *this;
         }
 
@@ -175,29 +375,7 @@ namespace utils
         /// <returns>String of reference text but with placeholders replaced.</returns>
         string_t Emit() const
         {
-            typedef std::basic_ostringstream<char_t,
-                std::char_traits<char_t>,
-                std::allocator<char_t>> ostringstream;
-
-            ostringstream oss;
-
-            for (auto &piece : m_pieces)
-            {
-                _ASSERTE(!piece.empty());
-                if (piece[0] != m_placeholderMarker)
-                {
-                    oss << piece;
-                }
-                else
-                {
-                    // find placeholder (without marker) among replacements
-                    auto iter = m_replacements.find(string_view_t(piece.data() + 1, piece.size() - 1));
-                    if (m_replacements.end() != iter)
-                        oss << iter->second;
-                }
-            }
-
-            return oss.str();
+            return m_template->Emit(m_replacements);
         }
 
     }; // end of class TextPlaceholderReplacementHelper
@@ -247,7 +425,7 @@ namespace utils
         constexpr bool empty() const noexcept
         {
             _ASSERTE(data != nullptr);
-            return data[0] == 0;
+            return lenBytes == 0;
         }
 
         constexpr bool null_or_empty() const noexcept
@@ -286,6 +464,180 @@ namespace utils
         }
     };
 
+    /// <summary>
+    /// Iterates over the pieces of a string (UTF-8) separated by a delimiter,
+    /// without copying or changing the string. Consecutive delimiters produce
+    /// empty pieces, and a multi-character delimiter is a whole sequence.
+    /// </summary>
+    class SplitIterator
+    {
+    private:
+
+        const char *m_pieceBegin;
+        const char *m_pieceEnd;
+        const char *m_end;
+        const char *m_delimiter;
+        uint32_t m_delimLength;
+        char m_delimChar;
+
+        void FindPieceEnd() noexcept
+        {
+            if (m_delimLength == 1)
+            {
+                auto found = memchr(m_pieceBegin, m_delimChar, m_end - m_pieceBegin);
+                m_pieceEnd = (found != nullptr) ? static_cast<const char *> (found) : m_end;
+            }
+            else
+                m_pieceEnd = std::search(m_pieceBegin, m_end, m_delimiter, m_delimiter + m_delimLength);
+        }
+
+    public:
+
+        typedef std::forward_iterator_tag iterator_category;
+        typedef CStringViewUtf8 value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const CStringViewUtf8 *pointer;
+        typedef CStringViewUtf8 reference;
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="SplitIterator"/> class
+        /// that is past the last piece of any string.
+        /// </summary>
+        SplitIterator() noexcept
+            : m_pieceBegin(nullptr)
+            , m_pieceEnd(nullptr)
+            , m_end(nullptr)
+            , m_delimiter(nullptr)
+            , m_delimLength(0)
+            , m_delimChar(0)
+        {
+        }
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="SplitIterator"/> class.
+        /// </summary>
+        /// <param name="str">The string to split, which must outlive the iterator.</param>
+        /// <param name="delimiter">The delimiter, which must outlive the iterator.</param>
+        SplitIterator(CStringViewUtf8 str, std::string_view delimiter) noexcept
+            : SplitIterator()
+        {
+            _ASSERTE(!delimiter.empty());
+
+            if (str.null())
+                return;
+
+            m_pieceBegin = str.begin();
+            m_end = str.end();
+            m_delimiter = delimiter.data();
+            m_delimLength = static_cast<uint32_t> (delimiter.size());
+            m_delimChar = delimiter[0];
+            FindPieceEnd();
+        }
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="SplitIterator"/> class.
+        /// </summary>
+        /// <param name="str">The string to split, which must outlive the iterator.</param>
+        /// <param name="delimiter">The delimiter.</param>
+        SplitIterator(CStringViewUtf8 str, char delimiter) noexcept
+            : SplitIterator()
+        {
+            if (str.null())
+                return;
+
+            m_pieceBegin = str.begin();
+            m_end = str.end();
+            m_delimLength = 1;
+            m_delimChar = delimiter;
+            FindPieceEnd();
+        }
+
+        CStringViewUtf8 operator*() const noexcept
+        {
+            _ASSERTE(m_pieceBegin != nullptr); // cannot dereference iterator past the last piece
+            return CStringViewUtf8(m_pieceBegin, m_pieceEnd);
+        }
+
+        /// <summary>
+        /// Gets the rest of the string, from the current piece on.
+        /// </summary>
+        CStringViewUtf8 rest() const noexcept
+        {
+            return CStringViewUtf8(m_pieceBegin, m_end);
+        }
+
+        SplitIterator &operator++() noexcept
+        {
+            _ASSERTE(m_pieceBegin != nullptr); // cannot move iterator past the last piece
+
+            if (m_pieceEnd == m_end)
+            {
+                m_pieceBegin = m_pieceEnd = nullptr;
+                return *this;
+            }
+
+            m_pieceBegin = m_pieceEnd + m_delimLength;
+            FindPieceEnd();
+            return *this;
+        }
+
+        SplitIterator operator++(int) noexcept
+        {
+            SplitIterator prev(*this);
+            ++(*this);
+            return prev;
+        }
+
+        bool operator==(const SplitIterator &other) const noexcept
+        {
+            return m_pieceBegin == other.m_pieceBegin && m_pieceEnd == other.m_pieceEnd;
+        }
+
+        bool operator!=(const SplitIterator &other) const noexcept
+        {
+            return !(*this == other);
+        }
+    };
+
+    /// <summary>
+    /// The pieces of a split string, to iterate over in a range-based loop.
+    /// </summary>
+    class SplitRange
+    {
+    private:
+
+        SplitIterator m_begin;
+
+    public:
+
+        explicit SplitRange(SplitIterator begin) noexcept
+            : m_begin(begin) {}
+
+        SplitIterator begin() const noexcept { return m_begin; }
+
+        SplitIterator end() const noexcept { return SplitIterator(); }
+    };
+
+    inline SplitRange split(CStringViewUtf8 str, char delimiter) noexcept
+    {
+        return SplitRange(SplitIterator(str, delimiter));
+    }
+
+    inline SplitRange split(CStringViewUtf8 str, std::string_view delimiter) noexcept
+    {
+        return SplitRange(SplitIterator(str, delimiter));
+    }
+
+    inline SplitRange split(std::string_view str, char delimiter) noexcept
+    {
+        return split(CStringViewUtf8(str.data(), str.data() + str.size()), delimiter);
+    }
+
+    inline SplitRange split(std::string_view str, std::string_view delimiter) noexcept
+    {
+        return split(CStringViewUtf8(str.data(), str.data() + str.size()), delimiter);
+    }
+
     /// <summary>
     /// Functor "less" for C-style UTF-8 strings.
     /// </summary>
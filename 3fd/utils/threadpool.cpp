@@ -0,0 +1,353 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include "threadpool.h"
+#include <3fd/core/configuration.h>
+#include <3fd/core/exceptions.h>
+#include <3fd/core/logger.h>
+
+#include <cassert>
+#include <sstream>
+
+namespace _3fd
+{
+namespace utils
+{
+    // The pool (if any) that owns the current thread as one of its workers:
+    static thread_local ThreadPool *currentPool(nullptr);
+
+    // The index of the current thread among the workers of its pool:
+    static thread_local uint32_t currentWorkerIdx(0);
+
+    /// <summary>
+    /// Runs a task, logging any exception that escapes it.
+    /// </summary>
+    /// <param name="task">The task to run.</param>
+    static void RunTask(ThreadPool::Task &task) noexcept
+    {
+        try
+        {
+            task();
+        }
+        catch (core::IAppException &ex)
+        {
+            core::Logger::Write(ex, core::Logger::PRIO_ERROR);
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when executing task in thread pool: " << ex.what();
+            core::Logger::Write(oss.str(), core::Logger::PRIO_ERROR);
+        }
+        catch (...)
+        {
+            core::Logger::Write("Unexpected exception when executing task in thread pool", core::Logger::PRIO_ERROR);
+        }
+    }
+
+    /// <summary>
+    /// Takes the task at one of the ends of a deque.
+    /// </summary>
+    /// <param name="deque">The deque.</param>
+    /// <param name="fromBack">Whether the task must be taken from the back.</param>
+    /// <param name="task">Receives the task.</param>
+    /// <returns>'true' if a task was taken, otherwise, 'false' (deque was empty).</returns>
+    static bool TakeTask(std::deque<ThreadPool::Task> &deque, bool fromBack, ThreadPool::Task &task) noexcept
+    {
+        if (deque.empty())
+            return false;
+
+        if (fromBack)
+        {
+            task = std::move(deque.back());
+            deque.pop_back();
+        }
+        else
+        {
+            task = std::move(deque.front());
+            deque.pop_front();
+        }
+
+        return true;
+    }
+
+    ThreadPool * ThreadPool::uniqueObjectPtr(nullptr);
+
+    std::mutex ThreadPool::singleInstanceCreationMutex;
+
+    /// <summary>
+    /// Gets the unique instance of the framework thread pool, which is created on
+    /// the first call with as many workers as set in the configuration.
+    /// </summary>
+    /// <returns>A reference to the thread pool.</returns>
+    ThreadPool &ThreadPool::GetInstance()
+    {
+        if (uniqueObjectPtr != nullptr)
+            return *uniqueObjectPtr;
+
+        try
+        {
+            std::lock_guard<std::mutex> lock(singleInstanceCreationMutex);
+
+            if (uniqueObjectPtr == nullptr)
+            {
+                uint32_t numWorkers = core::AppConfig::GetSettings().framework.threadPool.numWorkers;
+
+                if (numWorkers == 0)
+                    numWorkers = std::thread::hardware_concurrency();
+
+                uniqueObjectPtr = dbg_new ThreadPool(numWorkers);
+            }
+
+            return *uniqueObjectPtr;
+        }
+        catch (core::IAppException &)
+        {
+            throw; // just forward exceptions regarding errors known to have been already handled
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to acquire lock when instantiating the thread pool: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::bad_alloc &xa)
+        {
+            throw core::AppException<std::runtime_error>(xa.what());
+        }
+    }
+
+    /// <summary>
+    /// Shuts down the thread pool, waiting for all pending tasks to finish.
+    /// This must not be called from a task running in the pool!
+    /// </summary>
+    void ThreadPool::Shutdown() noexcept
+    {
+        try
+        {
+            std::lock_guard<std::mutex> lock(singleInstanceCreationMutex);
+
+            if (uniqueObjectPtr != nullptr)
+            {
+                delete uniqueObjectPtr;
+                uniqueObjectPtr = nullptr;
+            }
+        }
+        catch (std::system_error &ex)
+        {/* DO NOTHING: SWALLOW EXCEPTION
+            This method cannot throw an exception because it could have been originally
+            invoked by a destructor. When that happens, memory leaks are expected. */
+            std::ostringstream oss;
+            oss << "System error when shutting down the thread pool: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            core::Logger::Write(oss.str(), core::Logger::PRIO_CRITICAL);
+        }
+    }
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="ThreadPool"/> class.
+    /// </summary>
+    /// <param name="numWorkers">The amount of worker threads. If zero, a single worker is used.</param>
+    ThreadPool::ThreadPool(uint32_t numWorkers)
+        : m_numWorkers(numWorkers > 0 ? numWorkers : 1)
+        , m_numPendingTasks(0)
+        , m_stopping(false)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            m_workers.reset(dbg_new Worker[m_numWorkers]);
+
+            for (uint32_t idx = 0; idx < m_numWorkers; ++idx)
+                m_workers[idx].thread = std::thread(&ThreadPool::WorkerThreadProc, this, idx);
+        }
+        catch (std::system_error &ex)
+        {
+            StopAndJoinWorkers();
+
+            std::ostringstream oss;
+            oss << "Failed to start worker threads of thread pool: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::bad_alloc &)
+        {
+            StopAndJoinWorkers();
+            throw core::AppException<std::runtime_error>("Failed to allocate memory for thread pool");
+        }
+    }
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="ThreadPool"/> class.
+    /// Pending tasks are executed before the workers are terminated.
+    /// </summary>
+    ThreadPool::~ThreadPool()
+    {
+        StopAndJoinWorkers();
+    }
+
+    /// <summary>
+    /// Signals the workers to stop once there are no pending tasks and waits them to terminate.
+    /// </summary>
+    void ThreadPool::StopAndJoinWorkers() noexcept
+    {
+        m_stopping.store(true, std::memory_order_seq_cst);
+        m_eventCount.Notify();
+
+        if (!m_workers)
+            return;
+
+        for (uint32_t idx = 0; idx < m_numWorkers; ++idx)
+        {
+            auto &thread = m_workers[idx].thread;
+            if (thread.joinable())
+                thread.join();
+        }
+
+        // Tasks submitted while the workers were terminating are executed right here:
+        Task task;
+        while (TryPop(0, task))
+            RunTask(task);
+    }
+
+    /// <summary>
+    /// Submits a task to run asynchronously in the pool.
+    /// When the caller is itself a worker of the pool, the task is
+    /// enqueued locally, otherwise it is injected into the pool.
+    /// </summary>
+    /// <param name="task">The task.</param>
+    /// <param name="priority">The task priority.</param>
+    void ThreadPool::Submit(Task task, TaskPriority priority)
+    {
+        CALL_STACK_TRACE;
+
+        _ASSERTE(static_cast<size_t> (priority) < numPriorities);
+
+        const bool isWorker = (currentPool == this);
+
+        if (!isWorker && m_stopping.load(std::memory_order_acquire))
+            throw core::AppException<std::logic_error>("Cannot submit task because thread pool is shutting down");
+
+        TaskDeques &target = isWorker ? static_cast<TaskDeques &> (m_workers[currentWorkerIdx]) : m_injectedTasks;
+
+        try
+        {
+            // counted in advance, so that no worker goes to sleep while the task is being enqueued
+            m_numPendingTasks.fetch_add(1, std::memory_order_seq_cst);
+
+            std::lock_guard<std::mutex> lock(target.mutex);
+            target.tasksByPriority[static_cast<size_t> (priority)].push_back(std::move(task));
+        }
+        catch (std::system_error &ex)
+        {
+            m_numPendingTasks.fetch_sub(1, std::memory_order_seq_cst);
+
+            std::ostringstream oss;
+            oss << "Failed to acquire lock when submitting task to thread pool: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::bad_alloc &)
+        {
+            m_numPendingTasks.fetch_sub(1, std::memory_order_seq_cst);
+            throw core::AppException<std::runtime_error>("Failed to allocate memory when submitting task to thread pool");
+        }
+
+        m_eventCount.NotifyOne();
+    }
+
+    /// <summary>
+    /// Attempts to take a task for a worker, searching from the highest priority to the lowest:
+    /// first in its own deques, then in the deques of injected tasks, and finally stealing from
+    /// the other workers. Deques of other workers which are currently locked are skipped.
+    /// </summary>
+    /// <param name="workerIdx">The index of the worker.</param>
+    /// <param name="task">Receives the task.</param>
+    /// <returns>'true' if a task was found, otherwise, 'false'.</returns>
+    bool ThreadPool::TryPop(uint32_t workerIdx, Task &task) noexcept
+    {
+        bool found(false);
+
+        try
+        {
+            for (size_t prio = 0; !found && prio < numPriorities; ++prio)
+            {
+                {// own deque:
+                    auto &worker = m_workers[workerIdx];
+                    std::lock_guard<std::mutex> lock(worker.mutex);
+                    found = TakeTask(worker.tasksByPriority[prio], true, task);
+                }
+
+                if (!found)
+                {// injected tasks:
+                    std::lock_guard<std::mutex> lock(m_injectedTasks.mutex);
+                    found = TakeTask(m_injectedTasks.tasksByPriority[prio], false, task);
+                }
+
+                // steal from the others:
+                for (uint32_t offset = 1; !found && offset < m_numWorkers; ++offset)
+                {
+                    auto &victim = m_workers[(workerIdx + offset) % m_numWorkers];
+                    std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+                    found = lock.owns_lock() && TakeTask(victim.tasksByPriority[prio], false, task);
+                }
+            }
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to acquire lock when looking for task in thread pool: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            core::Logger::Write(oss.str(), core::Logger::PRIO_CRITICAL);
+        }
+
+        if (found)
+            m_numPendingTasks.fetch_sub(1, std::memory_order_seq_cst);
+
+        return found;
+    }
+
+    /// <summary>
+    /// The procedure executed by each worker thread.
+    /// </summary>
+    /// <param name="workerIdx">The index of the worker.</param>
+    void ThreadPool::WorkerThreadProc(uint32_t workerIdx)
+    {
+        currentPool = this;
+        currentWorkerIdx = workerIdx;
+
+        Task task;
+
+        while (true)
+        {
+            if (TryPop(workerIdx, task))
+            {
+                RunTask(task);
+                task = nullptr; // release resources captured by the task
+                continue;
+            }
+
+            auto key = m_eventCount.PrepareWait();
+
+            // a task might be in a deque which was locked by another thread:
+            if (m_numPendingTasks.load(std::memory_order_seq_cst) != 0)
+            {
+                m_eventCount.CancelWait();
+                std::this_thread::yield();
+                continue;
+            }
+
+            if (m_stopping.load(std::memory_order_seq_cst))
+            {
+                m_eventCount.CancelWait();
+                break;
+            }
+
+            m_eventCount.Wait(key);
+        }
+
+        currentPool = nullptr;
+    }
+
+} // end of namespace utils
+} // end of namespace _3fd
@@ -0,0 +1,133 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#ifndef THREADPOOL_H // header guard
+#define THREADPOOL_H
+
+#include <3fd/utils/concurrency.h>
+
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace _3fd
+{
+namespace utils
+{
+    /// <summary>
+    /// Priorities for tasks in the thread pool.
+    /// Workers always look for tasks of higher priority first.
+    /// </summary>
+    enum class TaskPriority : uint8_t
+    {
+        High = 0, Normal, Low
+    };
+
+    /// <summary>
+    /// A pool of worker threads that execute tasks asynchronously, in which each
+    /// worker keeps its own deque of tasks and steals from the others when idle.
+    /// </summary>
+    class ThreadPool
+    {
+    public:
+
+        typedef std::function<void()> Task;
+
+    private:
+
+        static const size_t numPriorities = 3;
+
+        /// <summary>
+        /// Holds tasks separated by priority.
+        /// </summary>
+        struct alignas(cacheLineSize) TaskDeques
+        {
+            std::mutex mutex;
+            std::array<std::deque<Task>, numPriorities> tasksByPriority;
+        };
+
+        /// <summary>
+        /// The state owned by a worker thread. Tasks enqueued by
+        /// the worker itself are taken from the back of its deques
+        /// (LIFO), whereas the others steal from the front (FIFO).
+        /// </summary>
+        struct Worker : TaskDeques
+        {
+            std::thread thread;
+        };
+
+        std::unique_ptr<Worker[]> m_workers;
+        const uint32_t m_numWorkers;
+
+        // tasks submitted from outside the pool:
+        TaskDeques m_injectedTasks;
+
+        alignas(cacheLineSize) std::atomic<uint32_t> m_numPendingTasks;
+        std::atomic<bool> m_stopping;
+        EventCount m_eventCount;
+
+        static ThreadPool *uniqueObjectPtr;
+        static std::mutex singleInstanceCreationMutex;
+
+        bool TryPop(uint32_t workerIdx, Task &task) noexcept;
+
+        void WorkerThreadProc(uint32_t workerIdx);
+
+        void StopAndJoinWorkers() noexcept;
+
+    public:
+
+        explicit ThreadPool(uint32_t numWorkers);
+
+        ThreadPool(const ThreadPool &) = delete;
+
+        ~ThreadPool();
+
+        static ThreadPool &GetInstance();
+
+        static void Shutdown() noexcept;
+
+        /// <summary>
+        /// Gets the amount of worker threads in the pool.
+        /// </summary>
+        uint32_t GetNumWorkers() const noexcept { return m_numWorkers; }
+
+        void Submit(Task task, TaskPriority priority = TaskPriority::Normal);
+
+        /// <summary>
+        /// Submits a callable to the pool and provides a future for its outcome.
+        /// </summary>
+        /// <param name="callable">The callable object to execute asynchronously.</param>
+        /// <param name="priority">The task priority.</param>
+        /// <returns>A future for the result of the callable (or the exception it throws).</returns>
+        template <typename CallableType>
+        std::future<typename std::invoke_result<CallableType>::type>
+            Async(CallableType &&callable, TaskPriority priority = TaskPriority::Normal)
+        {
+            typedef typename std::invoke_result<CallableType>::type ResultType;
+
+            // std::function requires copyable targets, but the packaged task is move-only:
+            auto packagedTask = std::make_shared<std::packaged_task<ResultType()>>(
+                std::forward<CallableType>(callable)
+            );
+
+            auto future = packagedTask->get_future();
+            Submit([packagedTask]() { (*packagedTask)(); }, priority);
+            return future;
+        }
+    };
+
+} // end of namespace utils
+} // end of namespace _3fd
+
+#endif // end of header guard
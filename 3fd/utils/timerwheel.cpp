@@ -0,0 +1,487 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include "timerwheel.h"
+#include <3fd/core/exceptions.h>
+#include <3fd/core/logger.h>
+
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+namespace _3fd
+{
+namespace utils
+{
+    using namespace std::chrono;
+
+    /// <summary>
+    /// Makes a list sentinel point to itself (empty list).
+    /// </summary>
+    template <typename LinkType>
+    static void ResetList(LinkType &sentinel) noexcept
+    {
+        sentinel.prev = sentinel.next = &sentinel;
+    }
+
+    /// <summary>
+    /// Removes a link from the circular list it belongs to.
+    /// </summary>
+    template <typename LinkType>
+    static void Unlink(LinkType &link) noexcept
+    {
+        link.prev->next = link.next;
+        link.next->prev = link.prev;
+        link.prev = link.next = nullptr;
+    }
+
+    /// <summary>
+    /// Converts a duration to the amount of ticks it takes (rounded up, at least 1).
+    /// </summary>
+    static uint64_t ToTicks(milliseconds duration, milliseconds tickDuration) noexcept
+    {
+        auto ticks = (duration.count() + tickDuration.count() - 1) / tickDuration.count();
+        return ticks > 0 ? static_cast<uint64_t> (ticks) : 1;
+    }
+
+    TimerWheel * TimerWheel::uniqueObjectPtr(nullptr);
+
+    std::mutex TimerWheel::singleInstanceCreationMutex;
+
+    /// <summary>
+    /// Gets the unique instance of the framework timer wheel,
+    /// which dispatches callbacks to the framework thread pool.
+    /// </summary>
+    /// <returns>A reference to the timer wheel.</returns>
+    TimerWheel &TimerWheel::GetInstance()
+    {
+        if (uniqueObjectPtr != nullptr)
+            return *uniqueObjectPtr;
+
+        try
+        {
+            std::lock_guard<std::mutex> lock(singleInstanceCreationMutex);
+
+            if (uniqueObjectPtr == nullptr)
+            {
+                // resolution of 10 ms is enough for retries, expiration and periodic housekeeping
+                uniqueObjectPtr = dbg_new TimerWheel(milliseconds(10), ThreadPool::GetInstance());
+            }
+
+            return *uniqueObjectPtr;
+        }
+        catch (core::IAppException &)
+        {
+            throw; // just forward exceptions regarding errors known to have been already handled
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to acquire lock when instantiating the timer wheel: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::bad_alloc &xa)
+        {
+            throw core::AppException<std::runtime_error>(xa.what());
+        }
+    }
+
+    /// <summary>
+    /// Shuts down the timer wheel. Timers not yet expired are discarded.
+    /// This must be invoked before shutting down the thread pool!
+    /// </summary>
+    void TimerWheel::Shutdown() noexcept
+    {
+        try
+        {
+            std::lock_guard<std::mutex> lock(singleInstanceCreationMutex);
+
+            if (uniqueObjectPtr != nullptr)
+            {
+                delete uniqueObjectPtr;
+                uniqueObjectPtr = nullptr;
+            }
+        }
+        catch (std::system_error &ex)
+        {/* DO NOTHING: SWALLOW EXCEPTION
+            This method cannot throw an exception because it could have been originally
+            invoked by a destructor. When that happens, memory leaks are expected. */
+            std::ostringstream oss;
+            oss << "System error when shutting down the timer wheel: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            core::Logger::Write(oss.str(), core::Logger::PRIO_CRITICAL);
+        }
+    }
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="TimerWheel"/> class.
+    /// </summary>
+    /// <param name="tickDuration">The duration of a tick, which is the resolution of the timers.</param>
+    /// <param name="threadPool">The thread pool where the callbacks will run.</param>
+    TimerWheel::TimerWheel(milliseconds tickDuration, ThreadPool &threadPool)
+        : m_startTime(steady_clock::now())
+        , m_tickDuration(tickDuration.count() > 0 ? tickDuration : milliseconds(1))
+        , m_threadPool(threadPool)
+        , m_currentTick(0)
+        , m_numActiveTimers(0)
+        , m_stopping(false)
+    {
+        CALL_STACK_TRACE;
+
+        for (auto &level : m_slots)
+        {
+            for (auto &sentinel : level)
+                ResetList(sentinel);
+        }
+
+        try
+        {
+            m_driverThread = std::thread(&TimerWheel::DriverThreadProc, this);
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to start thread of timer wheel: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="TimerWheel"/> class.
+    /// </summary>
+    TimerWheel::~TimerWheel()
+    {
+        try
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+
+            m_condition.notify_all();
+
+            if (m_driverThread.joinable())
+                m_driverThread.join();
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "System error when stopping the timer wheel: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            core::Logger::Write(oss.str(), core::Logger::PRIO_CRITICAL);
+        }
+    }
+
+    /// <summary>
+    /// Gets the tick corresponding to the current time.
+    /// </summary>
+    uint64_t TimerWheel::GetNowTick() const
+    {
+        return static_cast<uint64_t> (
+            duration_cast<milliseconds>(steady_clock::now() - m_startTime) / m_tickDuration
+        );
+    }
+
+    /// <summary>
+    /// Places a timer in the wheel. The closer its expiration, the lower the
+    /// level, where slots are finer grained. Timers in the higher levels are
+    /// cascaded down as the wheel turns. (The lock must be held by the caller.)
+    /// </summary>
+    /// <param name="timer">The timer.</param>
+    void TimerWheel::Insert(Timer &timer) noexcept
+    {
+        uint64_t expiryTick = std::max(timer.expiryTick, m_currentTick);
+        uint64_t delta = expiryTick - m_currentTick;
+
+        uint32_t level(0);
+        while (level < numLevels - 1 && delta >= (1ULL << (slotBits * (level + 1))))
+            ++level;
+
+        // too far ahead? place it in the farthest slot, where it will be cascaded from:
+        const uint64_t horizon = 1ULL << (slotBits * numLevels);
+        if (delta >= horizon)
+            expiryTick = m_currentTick + horizon - 1;
+
+        auto &sentinel = m_slots[level][(expiryTick >> (slotBits * level)) & (numSlots - 1)];
+
+        timer.prev = sentinel.prev;
+        timer.next = &sentinel;
+        sentinel.prev->next = &timer;
+        sentinel.prev = &timer;
+    }
+
+    /// <summary>
+    /// Turns the wheel by one tick, collecting the callbacks of expired timers.
+    /// (The lock must be held by the caller.)
+    /// </summary>
+    /// <param name="expired">Receives the callbacks of the expired timers.</param>
+    void TimerWheel::AdvanceTick(ExpiredList &expired)
+    {
+        ++m_currentTick;
+
+        // whenever a lower level completes a turn, cascade the next slot of the higher level:
+        for (uint32_t level = 1; level < numLevels; ++level)
+        {
+            const uint32_t shift = slotBits * level;
+
+            if ((m_currentTick & ((1ULL << shift) - 1)) != 0)
+                break;
+
+            // (a timer never goes back to the slot it is cascaded from)
+            auto &sentinel = m_slots[level][(m_currentTick >> shift) & (numSlots - 1)];
+
+            while (sentinel.next != &sentinel)
+            {
+                auto &timer = static_cast<Timer &> (*sentinel.next);
+                Unlink(timer);
+                Insert(timer);
+            }
+        }
+
+        auto &sentinel = m_slots[0][m_currentTick & (numSlots - 1)];
+
+        while (sentinel.next != &sentinel)
+        {
+            auto &timer = static_cast<Timer &> (*sentinel.next);
+
+            _ASSERTE(timer.expiryTick <= m_currentTick);
+
+            if (timer.periodTicks > 0)
+            {
+                expired.emplace_back(timer.callback, timer.priority);
+                Unlink(timer);
+
+                // the next expiration does not drift because of delays in dispatching:
+                timer.expiryTick += timer.periodTicks;
+                if (timer.expiryTick <= m_currentTick)
+                    timer.expiryTick = m_currentTick + 1;
+
+                Insert(timer);
+            }
+            else
+            {
+                expired.emplace_back(std::move(timer.callback), timer.priority);
+                Unlink(timer);
+                Recycle(timer);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Makes a timer no longer in the wheel available for reuse.
+    /// (The lock must be held by the caller.)
+    /// </summary>
+    /// <param name="timer">The timer.</param>
+    void TimerWheel::Recycle(Timer &timer) noexcept
+    {
+        timer.callback = nullptr;
+        timer.active = false;
+
+        // invalidates the identifier given for the previous use:
+        if (++timer.generation == 0)
+            timer.generation = 1;
+
+        m_freeTimers.push_back(timer.index); // capacity is reserved in advance
+        --m_numActiveTimers;
+    }
+
+    /// <summary>
+    /// Implements scheduling of timers.
+    /// </summary>
+    /// <param name="delay">The delay until the first expiration.</param>
+    /// <param name="period">The period of the timer, or zero if it is not periodic.</param>
+    /// <param name="callback">The callback to invoke upon expiration.</param>
+    /// <param name="priority">The priority of the callback in the thread pool.</param>
+    /// <returns>The identifier of the timer, which can be used for cancellation.</returns>
+    TimerWheel::TimerId TimerWheel::ScheduleImpl(milliseconds delay,
+                                                 milliseconds period,
+                                                 Callback &&callback,
+                                                 TaskPriority priority)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            const uint64_t nowTick = GetNowTick();
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            if (m_stopping)
+                throw core::AppException<std::logic_error>("Cannot schedule timer because timer wheel is shutting down");
+
+            bool wasIdle = (m_numActiveTimers == 0);
+
+            // the wheel stands still while empty, so catch up:
+            if (wasIdle)
+                m_currentTick = std::max(m_currentTick, nowTick);
+
+            Timer *timer;
+            if (m_freeTimers.empty())
+            {
+                if (m_timers.size() >= UINT32_MAX)
+                    throw core::AppException<std::runtime_error>("Timer wheel has exhausted its capacity");
+
+                m_freeTimers.reserve(m_timers.size() + 1);
+                m_timers.emplace_back();
+                timer = &m_timers.back();
+                timer->index = static_cast<uint32_t> (m_timers.size() - 1);
+                timer->generation = 1;
+            }
+            else
+            {
+                timer = &m_timers[m_freeTimers.back()];
+                m_freeTimers.pop_back();
+            }
+
+            timer->callback = std::move(callback);
+            // the current tick has already begun, hence one more, so as never to expire early:
+            timer->expiryTick = nowTick + ToTicks(delay, m_tickDuration) + 1;
+            timer->periodTicks = (period.count() > 0) ? ToTicks(period, m_tickDuration) : 0;
+            timer->priority = priority;
+            timer->active = true;
+            ++m_numActiveTimers;
+
+            Insert(*timer);
+
+            auto timerId = (static_cast<TimerId> (timer->generation) << 32) | timer->index;
+
+            lock.unlock();
+
+            if (wasIdle)
+                m_condition.notify_one();
+
+            return timerId;
+        }
+        catch (core::IAppException &)
+        {
+            throw; // just forward exceptions regarding errors known to have been already handled
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to acquire lock when scheduling timer: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            throw core::AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::bad_alloc &)
+        {
+            throw core::AppException<std::runtime_error>("Failed to allocate memory when scheduling timer");
+        }
+    }
+
+    /// <summary>
+    /// Schedules a callback to run once in the thread pool after a delay.
+    /// </summary>
+    /// <param name="delay">The delay (rounded up to the tick resolution).</param>
+    /// <param name="callback">The callback.</param>
+    /// <param name="priority">The priority of the callback in the thread pool.</param>
+    /// <returns>The identifier of the timer, which can be used for cancellation.</returns>
+    TimerWheel::TimerId TimerWheel::Schedule(milliseconds delay, Callback callback, TaskPriority priority)
+    {
+        return ScheduleImpl(delay, milliseconds(0), std::move(callback), priority);
+    }
+
+    /// <summary>
+    /// Schedules a callback to run periodically in the thread pool, until cancelled.
+    /// The first execution happens after one period.
+    /// </summary>
+    /// <param name="period">The period (rounded up to the tick resolution).</param>
+    /// <param name="callback">The callback.</param>
+    /// <param name="priority">The priority of the callback in the thread pool.</param>
+    /// <returns>The identifier of the timer, which can be used for cancellation.</returns>
+    TimerWheel::TimerId TimerWheel::SchedulePeriodic(milliseconds period, Callback callback, TaskPriority priority)
+    {
+        return ScheduleImpl(period, period, std::move(callback), priority);
+    }
+
+    /// <summary>
+    /// Cancels a timer. Callbacks already dispatched to the thread pool are not affected.
+    /// </summary>
+    /// <param name="timerId">The identifier of the timer.</param>
+    /// <returns>'true' if the timer was cancelled, or 'false' if it had already expired or been cancelled.</returns>
+    bool TimerWheel::Cancel(TimerId timerId) noexcept
+    {
+        const auto index = static_cast<uint32_t> (timerId & UINT32_MAX);
+        const auto generation = static_cast<uint32_t> (timerId >> 32);
+
+        try
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (index >= m_timers.size())
+                return false;
+
+            auto &timer = m_timers[index];
+            if (!timer.active || timer.generation != generation)
+                return false;
+
+            Unlink(timer);
+            Recycle(timer);
+            return true;
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to acquire lock when cancelling timer: " << core::StdLibExt::GetDetailsFromSystemError(ex);
+            core::Logger::Write(oss.str(), core::Logger::PRIO_ERROR);
+            return false;
+        }
+    }
+
+    /// <summary>
+    /// The procedure executed by the thread that turns the wheel.
+    /// </summary>
+    void TimerWheel::DriverThreadProc()
+    {
+        try
+        {
+            ExpiredList expired;
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            while (!m_stopping)
+            {
+                if (m_numActiveTimers == 0)
+                {
+                    m_condition.wait(lock);
+                    continue;
+                }
+
+                const uint64_t nowTick = GetNowTick();
+                while (m_currentTick < nowTick)
+                    AdvanceTick(expired);
+
+                if (!expired.empty())
+                {
+                    lock.unlock();
+
+                    for (auto &entry : expired)
+                    {
+                        try
+                        {
+                            m_threadPool.Submit(std::move(entry.first), entry.second);
+                        }
+                        catch (core::IAppException &ex)
+                        {
+                            core::Logger::Write(ex, core::Logger::PRIO_ERROR);
+                        }
+                    }
+
+                    expired.clear();
+                    lock.lock();
+                    continue;
+                }
+
+                m_condition.wait_until(lock, m_startTime + m_tickDuration * (m_currentTick + 1));
+            }
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Timer wheel has stopped because of an unexpected failure: " << ex.what();
+            core::Logger::Write(oss.str(), core::Logger::PRIO_CRITICAL);
+        }
+    }
+
+} // end of namespace utils
+} // end of namespace _3fd
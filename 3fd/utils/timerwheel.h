@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#ifndef TIMERWHEEL_H // header guard
+#define TIMERWHEEL_H
+
+#include <3fd/utils/threadpool.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cinttypes>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace _3fd
+{
+namespace utils
+{
+    /// <summary>
+    /// Schedules delayed and periodic callbacks to run in a thread pool, using
+    /// a hierarchical timer wheel, so that scheduling and cancellation are O(1).
+    /// </summary>
+    class TimerWheel
+    {
+    public:
+
+        typedef std::function<void()> Callback;
+
+        /// <summary>
+        /// Identifies a scheduled timer. Zero is never a valid identifier.
+        /// </summary>
+        typedef uint64_t TimerId;
+
+    private:
+
+        static const uint32_t slotBits = 6;
+        static const uint32_t numSlots = 1U << slotBits;
+        static const uint32_t numLevels = 4;
+
+        /// <summary>
+        /// Links a timer into the circular list of a slot.
+        /// </summary>
+        struct Link
+        {
+            Link *prev;
+            Link *next;
+        };
+
+        struct Timer : Link
+        {
+            Callback callback;
+            uint64_t expiryTick;
+            uint64_t periodTicks; // zero when not periodic
+            uint32_t index;
+            uint32_t generation;
+            TaskPriority priority;
+            bool active;
+        };
+
+        typedef std::vector<std::pair<Callback, TaskPriority>> ExpiredList;
+
+        const std::chrono::steady_clock::time_point m_startTime;
+        const std::chrono::milliseconds m_tickDuration;
+        ThreadPool &m_threadPool;
+
+        // the sentinels of the slots:
+        Link m_slots[numLevels][numSlots];
+
+        // stable storage for timers, which are recycled:
+        std::deque<Timer> m_timers;
+        std::vector<uint32_t> m_freeTimers;
+
+        uint64_t m_currentTick;
+        uint32_t m_numActiveTimers;
+        bool m_stopping;
+
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::thread m_driverThread;
+
+        static TimerWheel *uniqueObjectPtr;
+        static std::mutex singleInstanceCreationMutex;
+
+        uint64_t GetNowTick() const;
+
+        void Insert(Timer &timer) noexcept;
+
+        void Recycle(Timer &timer) noexcept;
+
+        void AdvanceTick(ExpiredList &expired);
+
+        TimerId ScheduleImpl(std::chrono::milliseconds delay,
+                             std::chrono::milliseconds period,
+                             Callback &&callback,
+                             TaskPriority priority);
+
+        void DriverThreadProc();
+
+    public:
+
+        TimerWheel(std::chrono::milliseconds tickDuration, ThreadPool &threadPool);
+
+        TimerWheel(const TimerWheel &) = delete;
+
+        ~TimerWheel();
+
+        static TimerWheel &GetInstance();
+
+        static void Shutdown() noexcept;
+
+        TimerId Schedule(std::chrono::milliseconds delay,
+                         Callback callback,
+                         TaskPriority priority = TaskPriority::Normal);
+
+        TimerId SchedulePeriodic(std::chrono::milliseconds period,
+                                 Callback callback,
+                                 TaskPriority priority = TaskPriority::Normal);
+
+        bool Cancel(TimerId timerId) noexcept;
+    };
+
+} // end of namespace utils
+} // end of namespace _3fd
+
+#endif // end of header guard
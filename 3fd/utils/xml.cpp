@@ -418,11 +418,10 @@ namespace xml
     static std::string GetNormalized(std::string uri)
     {
         // get rid of final backslash:
-        if (uri.back() == '/')
+        if (!uri.empty() && uri.back() == '/')
             uri.pop_back();
 
-        for (char &ch : uri)
-            ch = tolower(ch);
+        utils::to_lower_in_place(&uri[0], uri.size());
 
         return uri;
     }
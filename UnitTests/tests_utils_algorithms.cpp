@@ -6,10 +6,12 @@
 #include "pch.h"
 #include <3fd/core/preprocessing.h>
 #include <3fd/utils/algorithms.h>
+#include <3fd/utils/retry.h>
 
 #include <ctime>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <vector>
 #include <algorithm>
 
@@ -134,5 +136,164 @@ namespace unit_tests
         }
     }
 
+    /// <summary>
+    /// Tests the branchless search for lower & upper bounds against the STL.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, BranchlessBounds_Test)
+    {
+        srand(time(nullptr));
+
+        for (uint32_t numEntries : { 0U, 1U, 2U, 3U, 7U, 8U, 100U, 1000U, 4099U })
+        {
+            std::vector<Object> list;
+            list.reserve(numEntries);
+
+            // sorted keys with duplicates:
+            for (uint32_t idx = 0; idx < numEntries; ++idx)
+                list.push_back(Object{ static_cast<int> (idx / 3) * 2, static_cast<int> (idx) });
+
+            auto getKey = [](const Object &x) noexcept { return x.key; };
+            auto lessThan = [](const Object &x, int key) { return x.key < key; };
+            auto greaterThan = [](int key, const Object &x) { return key < x.key; };
+
+            for (int key = -1; key <= static_cast<int> (numEntries); ++key)
+            {
+                EXPECT_EQ(std::lower_bound(list.cbegin(), list.cend(), key, lessThan),
+                          utils::BranchlessLowerBound(list.cbegin(), list.cend(), key, getKey, std::less<int>()));
+
+                EXPECT_EQ(std::upper_bound(list.cbegin(), list.cend(), key, greaterThan),
+                          utils::BranchlessUpperBound(list.cbegin(), list.cend(), key, getKey, std::less<int>()));
+            }
+        }
+    }
+
+    /// <summary>
+    /// Tests the static sorted array in Eytzinger layout against the STL.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, EytzingerArray_Test)
+    {
+        srand(time(nullptr));
+
+        for (uint32_t numEntries : { 0U, 1U, 2U, 3U, 15U, 16U, 17U, 1000U, 65537U })
+        {
+            std::vector<int> sorted;
+            sorted.reserve(numEntries);
+
+            for (uint32_t idx = 0; idx < numEntries; ++idx)
+                sorted.push_back(abs(rand()) % (3 * numEntries + 1));
+
+            std::sort(sorted.begin(), sorted.end());
+
+            utils::EytzingerArray<int> array(sorted.cbegin(), sorted.cend());
+            EXPECT_EQ(numEntries, array.GetSize());
+
+            for (int idx = 0; idx < 1000; ++idx)
+            {
+                int key = static_cast<int> (abs(rand()) % (3 * numEntries + 3)) - 1;
+
+                auto expected = std::lower_bound(sorted.cbegin(), sorted.cend(), key);
+                auto found = array.LowerBound(key);
+
+                if (expected == sorted.cend())
+                {
+                    EXPECT_EQ(nullptr, found);
+                    EXPECT_EQ(nullptr, array.Find(key));
+                }
+                else
+                {
+                    ASSERT_NE(nullptr, found);
+                    EXPECT_EQ(*expected, *found);
+                    EXPECT_EQ(*expected == key, array.Find(key) != nullptr);
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// Tests the delays and the limits of retries.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, Retry_Limits_Test)
+    {
+        using std::chrono::milliseconds;
+
+        const utils::RetryOptions options{ milliseconds(10), milliseconds(200), 8, milliseconds(0) };
+        utils::RetryPolicy policy("Retry_Limits_Test", options);
+
+        // a call that always fails runs out of attempts:
+        for (int idx = 0; idx < 100; ++idx)
+        {
+            utils::Retrier retrier(policy);
+            milliseconds delay;
+
+            while (retrier.NextDelay(delay))
+            {
+                EXPECT_LE(options.baseDelay.count(), delay.count());
+                EXPECT_GE(options.maxDelay.count(), delay.count());
+            }
+
+            EXPECT_EQ(options.maxAttempts, retrier.GetNumAttempts());
+        }
+
+        // a call that succeeds at first is not counted:
+        utils::Retrier retrier(policy);
+        EXPECT_EQ(1U, retrier.GetNumAttempts());
+
+        auto stats = policy.GetStats();
+        EXPECT_EQ(100U, stats.numRetriedCalls);
+        EXPECT_EQ(100 * (options.maxAttempts - 1), stats.numRetries);
+        EXPECT_EQ(100U, stats.numGiveUps);
+        EXPECT_EQ(0U, stats.numBudgetDenials);
+
+        // the policy is listed among all call sites:
+        auto allStats = utils::RetryPolicy::GetStatsOfAllCallSites();
+        EXPECT_TRUE(std::any_of(allStats.begin(), allStats.end(), [](const utils::RetryStats &x)
+        {
+            return strcmp(x.callSite, "Retry_Limits_Test") == 0 && x.numRetriedCalls == 100;
+        }));
+    }
+
+    /// <summary>
+    /// Tests whether a budget of retries stops a retry storm.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, Retry_Budget_Test)
+    {
+        using std::chrono::milliseconds;
+
+        const utils::RetryOptions options{ milliseconds(1), milliseconds(1), 0, milliseconds(0) };
+        utils::RetryBudget budget(0.001, 10);
+        utils::RetryPolicy policy("Retry_Budget_Test", options, &budget);
+
+        uint32_t numRetries(0);
+        for (int idx = 0; idx < 5; ++idx)
+        {
+            utils::Retrier retrier(policy);
+            milliseconds delay;
+
+            while (retrier.NextDelay(delay))
+                ++numRetries;
+        }
+
+        EXPECT_EQ(10U, numRetries);
+
+        auto stats = policy.GetStats();
+        EXPECT_EQ(5U, stats.numRetriedCalls);
+        EXPECT_EQ(10U, stats.numRetries);
+        EXPECT_EQ(0U, stats.numGiveUps);
+        EXPECT_EQ(5U, stats.numBudgetDenials);
+
+        // with a timeout, the retries stop before it expires:
+        const utils::RetryOptions optionsWithTimeout{ milliseconds(5), milliseconds(20), 0, milliseconds(100) };
+        utils::RetryPolicy policyWithTimeout("Retry_Budget_Test/timeout", optionsWithTimeout);
+        utils::Retrier retrier(policyWithTimeout);
+
+        auto startTime = std::chrono::steady_clock::now();
+        while (retrier.BackOff());
+        auto elapsed = std::chrono::duration_cast<milliseconds>(std::chrono::steady_clock::now() - startTime);
+
+        EXPECT_LE(100, elapsed.count());
+        EXPECT_GT(1000, elapsed.count());
+        EXPECT_EQ(1U, policyWithTimeout.GetStats().numGiveUps);
+    }
+
 }// end of namespace unit_tests
 }// end of namespace _3fd
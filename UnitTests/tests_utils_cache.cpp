@@ -5,8 +5,15 @@
 //
 #include "pch.h"
 #include <3fd/utils/concurrency.h>
+#include <3fd/utils/boundedcache.h>
+#include <3fd/utils/concurrenthashmap.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <future>
+#include <iostream>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
@@ -16,6 +23,10 @@ namespace _3fd
 namespace unit_tests
 {
     using utils::CacheForSharedResources;
+    using utils::BoundedCache;
+    using utils::BoundedCacheOptions;
+    using utils::EvictionPolicy;
+    using utils::ConcurrentHashMap;
 
     /// <summary>
     /// Test fixture for <see cref="utils::CacheForSharedResources"/>.
@@ -157,5 +168,482 @@ namespace unit_tests
         }
     }
 
+    TEST_F(CacheForSharedResourcesTest, Concurrent_SameKey_SameObject)
+    {
+        const uint32_t numThreads = std::max(std::thread::hardware_concurrency(), 4U);
+
+        for (int key = 0; key < 100; ++key)
+        {
+            std::vector<std::future<std::shared_ptr<std::string>>> futures;
+            futures.reserve(numThreads);
+            for (uint32_t count = 0; count < numThreads; ++count)
+            {
+                futures.push_back(std::async(std::launch::async, [this, key]()
+                {
+                    return cache->GetObject(key);
+                }));
+            }
+
+            // all concurrent requests for a key must share a single object:
+            auto object = futures[0].get();
+            for (uint32_t idx = 1; idx < numThreads; ++idx)
+                EXPECT_EQ(object, futures[idx].get());
+        }
+    }
+
+    TEST_F(CacheForSharedResourcesTest, SingleThread_ExpiredEntriesCleanedUp)
+    {
+        const int numRounds(100);
+        const int numKeysPerRound(1000);
+
+        for (int round = 0; round < numRounds; ++round)
+        {
+            Objects objects;
+            for (int idx = 0; idx < numKeysPerRound; ++idx)
+                objects.push_back(cache->GetObject(round * numKeysPerRound + idx));
+        }
+
+        // entries of expired objects do not accumulate:
+        EXPECT_LT(cache->GetNumEntries(), static_cast<size_t> (numRounds * numKeysPerRound / 4));
+    }
+
+    /// <summary>
+    /// Creates options for a single shard, so the bounds are exact.
+    /// </summary>
+    static BoundedCacheOptions MakeBoundedCacheOptions(EvictionPolicy policy, size_t maxNumEntries)
+    {
+        BoundedCacheOptions options;
+        options.maxNumEntries = maxNumEntries;
+        options.evictionPolicy = policy;
+        options.numShards = 1;
+        return options;
+    }
+
+    TEST(Framework_Utils_TestCase, BoundedCache_LRU_EvictsLeastRecentlyUsed)
+    {
+        int numLoads(0);
+        BoundedCache<int, int> cache(
+            MakeBoundedCacheOptions(EvictionPolicy::LRU, 3),
+            [&numLoads](const int &key) { ++numLoads; return key * 10; }
+        );
+
+        for (int key = 0; key < 3; ++key)
+            EXPECT_EQ(key * 10, cache.Get(key));
+
+        EXPECT_EQ(0, cache.Get(0)); // now key 1 is the least recently used
+        EXPECT_EQ(30, cache.Get(3));
+        EXPECT_EQ(3U, cache.GetNumEntries());
+
+        int value;
+        EXPECT_FALSE(cache.TryGet(1, value));
+        EXPECT_TRUE(cache.TryGet(0, value));
+        EXPECT_TRUE(cache.TryGet(2, value));
+        EXPECT_TRUE(cache.TryGet(3, value));
+        EXPECT_EQ(4, numLoads);
+
+        auto stats = cache.GetStats();
+        EXPECT_EQ(1U, stats.numEvictions);
+        EXPECT_EQ(4U, stats.numLoads);
+        EXPECT_EQ(4U, stats.numHits);
+        EXPECT_EQ(5U, stats.numMisses);
+
+        EXPECT_TRUE(cache.Invalidate(0));
+        EXPECT_FALSE(cache.TryGet(0, value));
+        cache.Clear();
+        EXPECT_EQ(0U, cache.GetNumEntries());
+    }
+
+    TEST(Framework_Utils_TestCase, BoundedCache_SegmentedLRU_ResistsScan)
+    {
+        for (auto policy : { EvictionPolicy::SegmentedLRU, EvictionPolicy::TinyLFU })
+        {
+            BoundedCache<int, int> cache(
+                MakeBoundedCacheOptions(policy, 100),
+                [](const int &key) { return key; }
+            );
+
+            // hot keys are used twice, hence protected:
+            for (int round = 0; round < 2; ++round)
+            {
+                for (int key = 0; key < 50; ++key)
+                    cache.Get(key);
+            }
+
+            // a scan of keys used only once:
+            for (int key = 1000; key < 2000; ++key)
+                cache.Get(key);
+
+            int value;
+            for (int key = 0; key < 50; ++key)
+                EXPECT_TRUE(cache.TryGet(key, value));
+
+            EXPECT_GE(100U, cache.GetNumEntries());
+        }
+    }
+
+    TEST(Framework_Utils_TestCase, BoundedCache_TinyLFU_AdmitsFrequentKeys)
+    {
+        BoundedCache<int, int> cache(
+            MakeBoundedCacheOptions(EvictionPolicy::TinyLFU, 10),
+            [](const int &key) { return key; }
+        );
+
+        for (int key = 0; key < 10; ++key)
+            cache.Get(key);
+
+        // a key seen once is not admitted in place of another seen just as often:
+        int value;
+        cache.Get(100);
+        EXPECT_FALSE(cache.TryGet(100, value));
+        EXPECT_EQ(1U, cache.GetStats().numRejections);
+
+        // but it is admitted once requested more often:
+        for (int count = 0; count < 3; ++count)
+            cache.Get(101);
+
+        EXPECT_TRUE(cache.TryGet(101, value));
+        EXPECT_EQ(10U, cache.GetNumEntries());
+    }
+
+    TEST(Framework_Utils_TestCase, BoundedCache_ByteBudget)
+    {
+        BoundedCacheOptions options;
+        options.maxNumEntries = 0;
+        options.maxNumBytes = 1000;
+        options.evictionPolicy = EvictionPolicy::LRU;
+        options.numShards = 1;
+
+        BoundedCache<int, std::string> cache(
+            options,
+            [](const int &key) { return std::string(100 + key, 'x'); },
+            [](const int &, const std::string &value) { return value.size(); }
+        );
+
+        for (int key = 0; key < 50; ++key)
+            EXPECT_EQ(static_cast<size_t> (100 + key), cache.Get(key).size());
+
+        // 6 entries of 144..149 bytes fit in the budget:
+        EXPECT_EQ(6U, cache.GetNumEntries());
+
+        // an entry larger than the budget is never cached:
+        cache.Put(-1, std::string(2000, 'y'));
+        std::string value;
+        EXPECT_FALSE(cache.TryGet(-1, value));
+        EXPECT_TRUE(cache.TryGet(49, value));
+    }
+
+    TEST(Framework_Utils_TestCase, BoundedCache_TimeToLive)
+    {
+        BoundedCacheOptions options = MakeBoundedCacheOptions(EvictionPolicy::SegmentedLRU, 10);
+        options.timeToLive = std::chrono::milliseconds(50);
+
+        int numLoads(0);
+        BoundedCache<int, int> cache(options, [&numLoads](const int &key) { ++numLoads; return key; });
+
+        cache.Get(1);
+        cache.Get(1);
+        EXPECT_EQ(1, numLoads);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+
+        // expired entry is loaded again:
+        cache.Get(1);
+        EXPECT_EQ(2, numLoads);
+        EXPECT_EQ(1U, cache.GetStats().numExpirations);
+    }
+
+    TEST(Framework_Utils_TestCase, BoundedCache_Concurrent_LoadsCoalesced)
+    {
+        const uint32_t numThreads = std::max(std::thread::hardware_concurrency(), 4U);
+
+        std::atomic<int> numLoads(0);
+        uint64_t numExpectedMisses(0);
+        BoundedCache<int, int> *cachePtr(nullptr);
+
+        BoundedCache<int, int> cache(
+            BoundedCacheOptions(),
+            [&numLoads, &numExpectedMisses, &cachePtr](const int &key)
+            {
+                ++numLoads;
+
+                // hold the load until all threads missed the key:
+                while (cachePtr->GetStats().numMisses < numExpectedMisses)
+                    std::this_thread::yield();
+
+                if (key < 0)
+                    throw std::runtime_error("cannot load negative key");
+                return key * 2;
+            }
+        );
+
+        cachePtr = &cache;
+
+        for (int key : { 7, -7 })
+        {
+            numExpectedMisses += numThreads;
+
+            std::vector<std::future<int>> futures;
+            for (uint32_t count = 0; count < numThreads; ++count)
+            {
+                futures.push_back(std::async(std::launch::async, [&cache, key]()
+                {
+                    return cache.Get(key);
+                }));
+            }
+
+            for (auto &future : futures)
+            {
+                if (key > 0)
+                    EXPECT_EQ(key * 2, future.get());
+                else
+                    EXPECT_THROW(future.get(), std::runtime_error);
+            }
+        }
+
+        // the slow loader was called only once per key:
+        EXPECT_EQ(2, numLoads.load());
+        EXPECT_EQ(2U * (numThreads - 1), cache.GetStats().numCoalescedLoads);
+
+        // failure is not cached:
+        int value;
+        EXPECT_FALSE(cache.TryGet(-7, value));
+    }
+
+    TEST(Framework_Utils_TestCase, BoundedCache_PutAndInvalidateDuringLoad)
+    {
+        BoundedCache<int, int> *cachePtr(nullptr);
+
+        BoundedCache<int, int> cache(
+            MakeBoundedCacheOptions(EvictionPolicy::LRU, 3),
+            [&cachePtr](const int &key)
+            {
+                // while the load is in flight, the key changes:
+                if (key == 1)
+                    cachePtr->Put(key, 100);
+                else if (key == 2)
+                    cachePtr->Invalidate(key);
+
+                return key * 10;
+            }
+        );
+
+        cachePtr = &cache;
+
+        // the caller still gets the loaded value, but the cache keeps the newer state:
+        EXPECT_EQ(10, cache.Get(1));
+        EXPECT_EQ(20, cache.Get(2));
+
+        int value;
+        EXPECT_TRUE(cache.TryGet(1, value));
+        EXPECT_EQ(100, value);
+        EXPECT_FALSE(cache.TryGet(2, value));
+        EXPECT_EQ(1U, cache.GetNumEntries());
+
+        // evictions keep the index consistent:
+        for (int key = 3; key < 6; ++key)
+            EXPECT_EQ(key * 10, cache.Get(key));
+
+        EXPECT_EQ(3U, cache.GetNumEntries());
+        EXPECT_FALSE(cache.TryGet(1, value));
+
+        for (int key = 3; key < 6; ++key)
+        {
+            EXPECT_TRUE(cache.TryGet(key, value));
+            EXPECT_EQ(key * 10, value);
+        }
+    }
+
+    TEST(Framework_Utils_TestCase, ConcurrentHashMap_SingleThread_InsertFindRemove)
+    {
+        ConcurrentHashMap<std::string, int> map(16);
+
+        const int numEntries(10000);
+        for (int idx = 0; idx < numEntries; ++idx)
+            EXPECT_TRUE(map.Insert(std::to_string(idx), idx));
+
+        EXPECT_FALSE(map.Insert("0", -1));
+        EXPECT_EQ(static_cast<size_t> (numEntries), map.GetSize());
+
+        int value;
+        for (int idx = 0; idx < numEntries; ++idx)
+        {
+            ASSERT_TRUE(map.Find(std::to_string(idx), value));
+            EXPECT_EQ(idx, value);
+        }
+
+        EXPECT_FALSE(map.Find("not there", value));
+
+        for (int idx = 0; idx < numEntries; idx += 2)
+            EXPECT_TRUE(map.Remove(std::to_string(idx)));
+
+        EXPECT_FALSE(map.Remove("0"));
+        EXPECT_EQ(static_cast<size_t> (numEntries / 2), map.GetSize());
+
+        for (int idx = 1; idx < numEntries; idx += 2)
+            map.InsertOrAssign(std::to_string(idx), -idx);
+
+        // reinsertion after many removals purges the tombstones:
+        for (int round = 0; round < 10; ++round)
+        {
+            for (int idx = 0; idx < numEntries; idx += 2)
+                EXPECT_TRUE(map.Insert(std::to_string(idx), idx));
+
+            for (int idx = 0; idx < numEntries; idx += 2)
+                EXPECT_TRUE(map.Remove(std::to_string(idx)));
+        }
+
+        for (int idx = 0; idx < numEntries; ++idx)
+        {
+            bool isOdd = (idx % 2 != 0);
+            ASSERT_EQ(isOdd, map.Find(std::to_string(idx), value));
+            if (isOdd)
+            {
+                EXPECT_EQ(-idx, value);
+            }
+        }
+    }
+
+    TEST(Framework_Utils_TestCase, ConcurrentHashMap_Concurrent_ReadWhileWriting)
+    {
+        const int numWriters(4);
+        const int numKeysPerWriter(20000);
+
+        ConcurrentHashMap<int, std::shared_ptr<std::string>> map(16);
+        std::atomic<bool> writing(true);
+
+        std::vector<std::future<void>> writers;
+        for (int writer = 0; writer < numWriters; ++writer)
+        {
+            writers.push_back(std::async(std::launch::async, [&map, writer]()
+            {
+                for (int idx = 0; idx < numKeysPerWriter; ++idx)
+                {
+                    int key = idx * numWriters + writer;
+                    map.Insert(key, std::make_shared<std::string>(std::to_string(key)));
+
+                    // keep some churn of removals and replacements:
+                    if (idx % 3 == 0)
+                        map.Remove(key);
+                    else if (idx % 3 == 1)
+                        map.InsertOrAssign(key, std::make_shared<std::string>(std::to_string(key)));
+                }
+            }));
+        }
+
+        std::vector<std::future<int>> readers;
+        for (int reader = 0; reader < 4; ++reader)
+        {
+            readers.push_back(std::async(std::launch::async, [&map, &writing]()
+            {
+                int numErrors(0);
+                std::shared_ptr<std::string> value;
+                do
+                {
+                    for (int key = 0; key < numWriters * numKeysPerWriter; key += 97)
+                    {
+                        if (map.Find(key, value) && *value != std::to_string(key))
+                            ++numErrors;
+                    }
+                } while (writing.load());
+
+                return numErrors;
+            }));
+        }
+
+        for (auto &future : writers)
+            future.get();
+
+        writing.store(false);
+
+        for (auto &future : readers)
+            EXPECT_EQ(0, future.get());
+
+        size_t numEntries(0);
+        std::shared_ptr<std::string> value;
+        for (int key = 0; key < numWriters * numKeysPerWriter; ++key)
+        {
+            bool isRemoved = ((key / numWriters) % 3 == 0);
+            ASSERT_EQ(!isRemoved, map.Find(key, value));
+            if (!isRemoved)
+            {
+                EXPECT_EQ(std::to_string(key), *value);
+                ++numEntries;
+            }
+        }
+
+        EXPECT_EQ(numEntries, map.GetSize());
+    }
+
+    /// <summary>
+    /// Measures the time for concurrent lookups of shared objects.
+    /// </summary>
+    template <typename GetterType>
+    static std::chrono::microseconds MeasureConcurrentLookups(int numKeys, GetterType getObject)
+    {
+        using namespace std::chrono;
+
+        const uint32_t numThreads = std::max(std::thread::hardware_concurrency(), 4U);
+
+        auto startTime = steady_clock::now();
+
+        std::vector<std::future<void>> futures;
+        for (uint32_t count = 0; count < numThreads; ++count)
+        {
+            futures.push_back(std::async(std::launch::async, [numKeys, &getObject]()
+            {
+                for (int round = 0; round < 20; ++round)
+                {
+                    for (int key = 0; key < numKeys; ++key)
+                        EXPECT_NE(nullptr, getObject(key));
+                }
+            }));
+        }
+
+        for (auto &future : futures)
+            future.get();
+
+        return duration_cast<microseconds>(steady_clock::now() - startTime);
+    }
+
+    /// <summary>
+    /// Compares concurrent lookups in <see cref="utils::ConcurrentHashMap"/>
+    /// and <see cref="utils::CacheForSharedResources"/>.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, ConcurrentHashMap_BenchmarkTest)
+    {
+        const int numKeys(10000);
+
+        std::vector<std::shared_ptr<std::string>> liveObjects;
+        liveObjects.reserve(numKeys);
+
+        CacheForSharedResources<int, std::string> cache([]() { return dbg_new std::string("foobar"); });
+        for (int key = 0; key < numKeys; ++key)
+            liveObjects.push_back(cache.GetObject(key));
+
+        ConcurrentHashMap<int, std::shared_ptr<std::string>> map;
+        for (int key = 0; key < numKeys; ++key)
+            map.Insert(key, liveObjects[key]);
+
+        auto cacheTime = MeasureConcurrentLookups(numKeys, [&cache](int key)
+        {
+            return cache.GetObject(key);
+        });
+
+        auto mapTime = MeasureConcurrentLookups(numKeys, [&map](int key)
+        {
+            std::shared_ptr<std::string> object;
+            map.Find(key, object);
+            return object;
+        });
+
+#   ifdef _3FD_CONSOLE_AVAILABLE
+        std::cout << "CacheForSharedResources: " << cacheTime.count() << " us\n"
+                  << "ConcurrentHashMap: " << mapTime.count() << " us\n";
+#   else
+        (void)cacheTime;
+        (void)mapTime;
+#   endif
+    }
+
 } // end of namespaces unit_tests
 } // end of namespace _3fd
\ No newline at end of file
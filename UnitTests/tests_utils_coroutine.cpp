@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include <3fd/core/preprocessing.h>
+
+#ifdef _3FD_HAS_COROUTINES
+
+#include <3fd/utils/concurrency.h>
+#include <3fd/utils/coroutine.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace _3fd
+{
+namespace unit_tests
+{
+    using namespace std::chrono;
+    using utils::Task;
+
+    Task<int> Square(int value)
+    {
+        co_return value * value;
+    }
+
+    Task<int> SumOfSquares(int count)
+    {
+        int sum(0);
+        for (int idx = 1; idx <= count; ++idx)
+            sum += co_await Square(idx);
+
+        co_return sum;
+    }
+
+    Task<void> Fail()
+    {
+        throw std::runtime_error("oops");
+        co_return;
+    }
+
+    /// <summary>
+    /// Tests composition of <see cref="utils::Task{}"/> coroutines.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, Coroutine_TaskCompositionTest)
+    {
+        EXPECT_EQ(385, utils::SyncWait(SumOfSquares(10)));
+        EXPECT_THROW(utils::SyncWait(Fail()), std::runtime_error);
+    }
+
+    /// <summary>
+    /// Tests coroutines that switch to the thread pool and await timers,
+    /// with far more coroutines in flight than threads to run them.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, Coroutine_ManyInFlightTest)
+    {
+        utils::ThreadPool pool(2);
+        utils::TimerWheel timerWheel(milliseconds(1), pool);
+
+        const int numCoroutines = 1000;
+        std::atomic<int> count(0);
+        utils::CompletionNotifier allDone;
+
+        auto coroutine = [&](int idx) -> Task<void>
+        {
+            co_await utils::ScheduleOn(pool);
+            co_await utils::ResumeAfter(timerWheel, milliseconds(1 + idx % 50));
+
+            if (count.fetch_add(1) + 1 == numCoroutines)
+                allDone.Notify();
+        };
+
+        auto startTime = steady_clock::now();
+
+        for (int idx = 0; idx < numCoroutines; ++idx)
+            utils::StartDetached(coroutine(idx), [](std::exception_ptr) { FAIL(); });
+
+        // await the notification from another coroutine:
+        utils::SyncWait([&]() -> Task<void>
+        {
+            co_await utils::AwaitCompletion([&allDone](const std::function<void()> &callback)
+            {
+                allDone.Subscribe(callback);
+            }, pool);
+        }());
+
+        EXPECT_EQ(numCoroutines, count.load());
+        EXPECT_LT(steady_clock::now() - startTime, seconds(10));
+    }
+
+}// end of namespace unit_tests
+}// end of namespace _3fd
+
+#endif // _3FD_HAS_COROUTINES
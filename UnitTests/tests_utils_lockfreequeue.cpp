@@ -98,6 +98,224 @@ namespace unit_tests
             producerThread.join();
     }
 
+    /// <summary>
+    /// Tests <see cref="utils::LockFreeQueue{}"/> with a consumer
+    /// that blocks while waiting for the producer.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, LockFreeQueue_InHouse_BlockingConsumerTest)
+    {
+        const unsigned long seqLen = 1UL << 16;
+
+        utils::LockFreeQueue<unsigned long> queue;
+
+        std::vector<unsigned long> seqOfNums(seqLen);
+
+        // Generate a sequence of increasing numbers:
+        unsigned long idx(0);
+        for (idx = 0; idx < seqLen; ++idx)
+            seqOfNums[idx] = idx;
+
+        // Launch a parallel thread to insert entries in the queue (in bursts):
+        std::thread producerThread(
+            [&queue, &seqOfNums]()
+            {
+                for (auto &num : seqOfNums)
+                {
+                    queue.Add(&num);
+
+                    if (num % 4096 == 0)
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        );
+
+        // Consume the entries, sleeping only when the queue is empty:
+
+        idx = 0;
+
+        do
+        {
+            ASSERT_TRUE(queue.WaitForEntries());
+
+            unsigned long *numPtr;
+            while ((numPtr = queue.Remove()) != nullptr)
+                ASSERT_EQ(idx++, *numPtr);
+
+        } while (idx < seqLen);
+
+        // wait for producer thread to finalize
+        if (producerThread.joinable())
+            producerThread.join();
+
+        EXPECT_TRUE(queue.IsEmpty());
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::LockFreeQueue{}"/> with a consumer that drains
+    /// the queue in batches limited in size.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, LockFreeQueue_InHouse_BatchDrainTest)
+    {
+        const unsigned long seqLen = 1UL << 18;
+        const size_t maxBatchSize = 1000;
+
+        utils::LockFreeQueue<unsigned long> queue;
+
+        std::vector<unsigned long> seqOfNums(seqLen);
+
+        // Generate a sequence of increasing numbers:
+        unsigned long idx(0);
+        for (idx = 0; idx < seqLen; ++idx)
+            seqOfNums[idx] = idx;
+
+        // Launch a parallel thread to insert entries in the queue:
+        std::thread producerThread(
+            [&queue, &seqOfNums]()
+            {
+                for (auto &num : seqOfNums)
+                    queue.Add(&num);
+            }
+        );
+
+        // Consume the entries being inserted asynchronously in the queue:
+
+        std::vector<unsigned long *> batch;
+        batch.reserve(maxBatchSize);
+        idx = 0;
+
+        do
+        {
+            ASSERT_TRUE(queue.WaitForEntries());
+
+            batch.clear();
+            auto count = queue.DrainTo(batch, maxBatchSize);
+            ASSERT_EQ(batch.size(), count);
+            ASSERT_LE(count, maxBatchSize);
+
+            for (auto numPtr : batch)
+                ASSERT_EQ(idx++, *numPtr);
+
+        } while (idx < seqLen);
+
+        // wait for producer thread to finalize
+        if (producerThread.joinable())
+            producerThread.join();
+
+        EXPECT_EQ(0U, queue.ForEachDrained([](unsigned long *) {}));
+        EXPECT_TRUE(queue.IsEmpty());
+    }
+
+    /// <summary>
+    /// Tests the interruption of a consumer of <see cref="utils::LockFreeQueue{}"/>
+    /// that is blocked waiting for entries.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, LockFreeQueue_InHouse_InterruptWaitTest)
+    {
+        utils::LockFreeQueue<unsigned long> queue;
+
+        std::thread interruptThread(
+            [&queue]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                queue.InterruptWait();
+            }
+        );
+
+        EXPECT_FALSE(queue.WaitForEntries());
+
+        if (interruptThread.joinable())
+            interruptThread.join();
+
+        // once interrupted, the consumer no longer blocks:
+        unsigned long num(0);
+        queue.Add(&num);
+        EXPECT_FALSE(queue.WaitForEntries());
+        EXPECT_EQ(&num, queue.Remove());
+    }
+
+    /// <summary>
+    /// Generic tests for <see cref="utils::SpscRingQueue{}"/> class.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, SpscRingQueue_ParallelProducerTest)
+    {
+        const unsigned long seqLen = 1UL << 18;
+
+        // small capacity, so as to have the producer blocked often:
+        utils::SingleConsumerQueue<unsigned long, utils::QueueProducers::Single> queue(64);
+        EXPECT_EQ(64U, queue.GetCapacity());
+
+        std::vector<unsigned long> seqOfNums(seqLen);
+
+        // Generate a sequence of increasing numbers:
+        unsigned long idx(0);
+        for (idx = 0; idx < seqLen; ++idx)
+            seqOfNums[idx] = idx;
+
+        // Launch a parallel thread to insert entries in the queue:
+        std::thread producerThread(
+            [&queue, &seqOfNums]()
+            {
+                for (auto &num : seqOfNums)
+                    queue.Add(&num);
+            }
+        );
+
+        // Consume the entries alternating single removals and batches:
+
+        std::vector<unsigned long *> batch;
+        idx = 0;
+
+        do
+        {
+            ASSERT_TRUE(queue.WaitForEntries());
+
+            auto numPtr = queue.Remove();
+            ASSERT_NE(nullptr, numPtr);
+            ASSERT_EQ(idx++, *numPtr);
+
+            batch.clear();
+            queue.DrainTo(batch);
+
+            for (auto numPtr : batch)
+                ASSERT_EQ(idx++, *numPtr);
+
+        } while (idx < seqLen);
+
+        // wait for producer thread to finalize
+        if (producerThread.joinable())
+            producerThread.join();
+
+        EXPECT_TRUE(queue.IsEmpty());
+        EXPECT_EQ(nullptr, queue.Remove());
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::SpscRingQueue{}"/> when full.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, SpscRingQueue_FullTest)
+    {
+        utils::SpscRingQueue<unsigned long> queue(5);
+        ASSERT_EQ(8U, queue.GetCapacity());
+
+        std::vector<unsigned long> seqOfNums(queue.GetCapacity() + 1);
+
+        for (size_t idx = 0; idx < queue.GetCapacity(); ++idx)
+            EXPECT_TRUE(queue.TryAdd(&seqOfNums[idx]));
+
+        EXPECT_FALSE(queue.TryAdd(&seqOfNums.back()));
+
+        EXPECT_EQ(&seqOfNums[0], queue.Remove());
+        EXPECT_TRUE(queue.TryAdd(&seqOfNums.back()));
+
+        size_t idx(1);
+        EXPECT_EQ(queue.GetCapacity(), queue.ForEachDrained([&idx, &seqOfNums](unsigned long *numPtr)
+        {
+            EXPECT_EQ(&seqOfNums[idx++], numPtr);
+        }));
+
+        EXPECT_TRUE(queue.IsEmpty());
+    }
+
 #   ifdef _WIN32
     /// <summary>
     /// Generic tests for <see cref="utils::Win32ApiWrappers::LockFreeQueue{}"/> class.
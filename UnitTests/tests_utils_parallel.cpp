@@ -0,0 +1,171 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include <3fd/utils/parallel.h>
+#include <3fd/utils/threadpool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace _3fd
+{
+namespace unit_tests
+{
+    using utils::ThreadPool;
+
+    /// <summary>
+    /// Tests <see cref="utils::ParallelFor"/>, including nested
+    /// loops and the forwarding of exceptions.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, ParallelFor_Test)
+    {
+        ThreadPool pool(4);
+
+        const size_t numItems(100000);
+        std::vector<std::atomic<int>> visits(numItems);
+        for (auto &count : visits)
+            count.store(0);
+
+        utils::ParallelFor(pool, 0, numItems, 1000, [&pool, &visits](size_t begin, size_t end)
+        {
+            // nested loop over the same chunk:
+            utils::ParallelFor(pool, begin, end, 100, [&visits](size_t begin, size_t end)
+            {
+                for (auto idx = begin; idx < end; ++idx)
+                    visits[idx].fetch_add(1);
+            });
+        });
+
+        for (auto &count : visits)
+            EXPECT_EQ(1, count.load());
+
+        EXPECT_THROW(
+            utils::ParallelFor(pool, 0, numItems, 10, [](size_t begin, size_t)
+            {
+                if (begin == 5000)
+                    throw std::runtime_error("oops");
+            }),
+            std::runtime_error
+        );
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::ParallelSort"/> against a stable sort.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, ParallelSort_Test)
+    {
+        ThreadPool pool(4);
+        std::mt19937 generator(42);
+
+        for (size_t numItems : { 0, 1, 1000, 100000, 250001 })
+        {
+            // pairs of key (with many duplicates) and original position:
+            std::vector<std::pair<int, size_t>> items;
+            items.reserve(numItems);
+            for (size_t idx = 0; idx < numItems; ++idx)
+                items.emplace_back(static_cast<int> (generator() % 1000), idx);
+
+            auto expected = items;
+            auto lessThan = [](const std::pair<int, size_t> &a, const std::pair<int, size_t> &b)
+            {
+                return a.first < b.first;
+            };
+
+            std::stable_sort(expected.begin(), expected.end(), lessThan);
+            utils::ParallelSort(pool, items.begin(), items.end(), lessThan, 4096);
+            EXPECT_EQ(expected, items);
+        }
+
+        std::vector<std::string> words;
+        for (int idx = 0; idx < 20000; ++idx)
+            words.push_back(std::to_string(generator()));
+
+        auto expected = words;
+        std::sort(expected.begin(), expected.end());
+        utils::ParallelSort(pool, words.begin(), words.end());
+        EXPECT_EQ(expected, words);
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::ParallelMergeRuns"/> with runs of different lengths.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, ParallelMergeRuns_Test)
+    {
+        ThreadPool pool(4);
+        std::mt19937 generator(7);
+
+        std::vector<int> items;
+        std::vector<size_t> runOffsets;
+
+        for (size_t numRuns = 0; numRuns < 7; ++numRuns)
+        {
+            runOffsets.push_back(items.size());
+
+            auto runLength = generator() % 30000;
+            for (size_t idx = 0; idx < runLength; ++idx)
+                items.push_back(static_cast<int> (generator() % 5000));
+
+            std::sort(items.begin() + runOffsets.back(), items.end());
+        }
+
+        auto expected = items;
+        std::sort(expected.begin(), expected.end());
+
+        utils::ParallelMergeRuns(pool, items.begin(), items.end(), runOffsets, std::less<int>(), 1000);
+        EXPECT_EQ(expected, items);
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::ParallelInclusiveScan"/>, whose result
+    /// must not depend on the amount of threads.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, ParallelInclusiveScan_Test)
+    {
+        for (size_t numItems : { 0, 1, 999, 1000, 1001, 123457 })
+        {
+            std::vector<long long> items(numItems);
+            std::iota(items.begin(), items.end(), 1);
+
+            std::vector<long long> expected(numItems);
+            std::partial_sum(items.begin(), items.end(), expected.begin());
+
+            ThreadPool pool(4);
+            std::vector<long long> output(numItems);
+            utils::ParallelInclusiveScan(pool, items.begin(), items.end(), output.begin(), std::plus<long long>(), 1000);
+            EXPECT_EQ(expected, output);
+
+            // in place:
+            utils::ParallelInclusiveScan(pool, items.begin(), items.end(), items.begin(), std::plus<long long>(), 1000);
+            EXPECT_EQ(expected, items);
+        }
+
+        // floating point results are the same with any amount of threads:
+        std::vector<double> values(100000);
+        std::mt19937 generator(1);
+        for (auto &value : values)
+            value = generator() / 1e6;
+
+        std::vector<double> output1(values.size()), output4(values.size());
+        {
+            ThreadPool pool(1);
+            utils::ParallelInclusiveScan(pool, values.begin(), values.end(), output1.begin(), std::plus<double>(), 1000);
+        }
+        {
+            ThreadPool pool(4);
+            utils::ParallelInclusiveScan(pool, values.begin(), values.end(), output4.begin(), std::plus<double>(), 1000);
+        }
+
+        EXPECT_EQ(output1, output4);
+    }
+
+}// end of namespace unit_tests
+}// end of namespace _3fd
@@ -6,8 +6,16 @@
 #include "pch.h"
 #include <3fd/utils/memory.h>
 
+#include <algorithm>
 #include <vector>
 #include <deque>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
 
 namespace _3fd
 {
@@ -116,5 +124,447 @@ namespace unit_tests
         myPool.Shrink();
     }
 
+    /// <summary>
+    /// Tests the statistics of <see cref="utils::DynamicMemPool"/>.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, DynamicMemPool_StatsTest)
+    {
+        utils::DynamicMemPool myPool(128, 32, 1.0F);
+
+        auto stats = myPool.GetStats();
+        EXPECT_EQ(0U, stats.numChunks);
+        EXPECT_EQ(0U, stats.numBytesReserved);
+        EXPECT_EQ(0.0, stats.GetFullyFreeChunksFraction());
+
+        std::vector<void *> blocks(1000);
+        for (auto &block : blocks)
+            block = myPool.GetFreeBlock();
+
+        for (size_t idx = 0; idx < blocks.size() / 2; ++idx)
+            myPool.ReturnBlock(blocks[idx]);
+
+        stats = myPool.GetStats();
+        EXPECT_GT(stats.numChunks, 1U);
+        EXPECT_GE(stats.numBytesReserved, 1000U * 32);
+        EXPECT_EQ(500U * 32, stats.numBytesInUse);
+        EXPECT_EQ(1000U * 32, stats.numBytesInUseHighWaterMark);
+        EXPECT_EQ(1000U, stats.numAllocations);
+        EXPECT_EQ(500U, stats.numDeallocations);
+        EXPECT_GT(stats.numFullyFreeChunks, 0U);
+        EXPECT_LT(stats.numFullyFreeChunks, stats.numChunks);
+
+        // shrinking releases the fully free chunks:
+        myPool.Shrink();
+        stats = myPool.GetStats();
+        EXPECT_EQ(0U, stats.numFullyFreeChunks);
+        EXPECT_EQ(500U * 32, stats.numBytesInUse);
+
+        for (size_t idx = blocks.size() / 2; idx < blocks.size(); ++idx)
+            myPool.ReturnBlock(blocks[idx]);
+
+        stats = myPool.GetStats();
+        EXPECT_EQ(0U, stats.numBytesInUse);
+        EXPECT_EQ(1000U * 32, stats.numBytesInUseHighWaterMark);
+        EXPECT_EQ(1.0, stats.GetFullyFreeChunksFraction());
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::DynamicMemPool"/> backed by virtual memory,
+    /// making it hand back the unused pages of partially used chunks.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, DynamicMemPool_VirtualMemoryTest)
+    {
+        for (auto backing : { utils::MemoryBacking::VirtualMemory, utils::MemoryBacking::HugePages })
+        {
+            const uint32_t numBlocks = 32768;
+
+            utils::DynamicMemPool myPool(4096, 64, 1.0F, backing);
+
+            std::vector<uint64_t *> blocks(numBlocks);
+            for (uint32_t idx = 0; idx < numBlocks; ++idx)
+            {
+                blocks[idx] = static_cast<uint64_t *> (myPool.GetFreeBlock());
+                *blocks[idx] = idx;
+            }
+
+            // keep only a few blocks in use, spread over the chunks:
+            for (uint32_t idx = 0; idx < numBlocks; ++idx)
+            {
+                if (idx % 1000 != 0)
+                    myPool.ReturnBlock(blocks[idx]);
+            }
+
+            myPool.Shrink();
+
+            // the blocks still in use must be intact:
+            for (uint32_t idx = 0; idx < numBlocks; idx += 1000)
+                EXPECT_EQ(idx, *blocks[idx]);
+
+            // get again the returned blocks, now in memory whose pages were handed back:
+            for (uint32_t idx = 0; idx < numBlocks; ++idx)
+            {
+                if (idx % 1000 != 0)
+                {
+                    blocks[idx] = static_cast<uint64_t *> (myPool.GetFreeBlock());
+                    *blocks[idx] = idx;
+                }
+            }
+
+            std::set<uint64_t *> uniqueBlocks(blocks.begin(), blocks.end());
+            EXPECT_EQ(numBlocks, uniqueBlocks.size());
+
+            for (uint32_t idx = 0; idx < numBlocks; ++idx)
+            {
+                EXPECT_EQ(idx, *blocks[idx]);
+                myPool.ReturnBlock(blocks[idx]);
+            }
+
+            myPool.Shrink();
+        }
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::MemoryPool"/> with blocks smaller than a pointer,
+    /// which must hold the links of the list of returned blocks.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, MemoryPool_SmallBlocksTest)
+    {
+        const uint16_t numBlocks = 100;
+
+        utils::MemoryPool myPool(numBlocks, 1);
+        EXPECT_TRUE(myPool.IsFull());
+        EXPECT_FALSE(myPool.IsEmpty());
+
+        std::vector<void *> blocks;
+        while (!myPool.IsEmpty())
+            blocks.push_back(myPool.GetFreeBlock());
+
+        EXPECT_EQ(numBlocks, blocks.size());
+        EXPECT_EQ(nullptr, myPool.GetFreeBlock());
+
+        std::set<void *> uniqueBlocks(blocks.begin(), blocks.end());
+        EXPECT_EQ(numBlocks, uniqueBlocks.size());
+
+        // return every other block, then get them back (in reverse order):
+        for (uint16_t idx = 0; idx < numBlocks; idx += 2)
+            myPool.ReturnBlock(blocks[idx]);
+
+        EXPECT_FALSE(myPool.IsFull());
+        EXPECT_FALSE(myPool.IsEmpty());
+
+        for (int idx = numBlocks - 2; idx >= 0; idx -= 2)
+            EXPECT_EQ(blocks[idx], myPool.GetFreeBlock());
+
+        EXPECT_TRUE(myPool.IsEmpty());
+
+        for (auto block : blocks)
+            myPool.ReturnBlock(block);
+
+        EXPECT_TRUE(myPool.IsFull());
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::ConcurrentDynamicMemPool"/> with several threads,
+    /// some of them returning blocks obtained by others.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, ConcurrentDynamicMemPool_MultiThreadTest)
+    {
+        const uint32_t numThreads = 4;
+        const uint32_t numBlocksPerThread = 4096;
+
+        utils::ConcurrentDynamicMemPool myPool(256, sizeof(uint64_t), 1.0F);
+
+        std::vector<std::vector<uint64_t *>> blocksByThread(numThreads);
+        std::vector<std::thread> threads;
+
+        // every thread obtains blocks, then some of them go back and are obtained again:
+        for (uint32_t idxThread = 0; idxThread < numThreads; ++idxThread)
+        {
+            threads.emplace_back([&myPool, &blocksByThread, idxThread, numBlocksPerThread]()
+            {
+                auto &blocks = blocksByThread[idxThread];
+
+                for (uint32_t idx = 0; idx < numBlocksPerThread; ++idx)
+                {
+                    blocks.push_back(static_cast<uint64_t *> (myPool.GetFreeBlock()));
+                    *blocks.back() = (static_cast<uint64_t>(idxThread) << 32) | idx;
+                }
+
+                for (uint32_t idx = 0; idx < numBlocksPerThread; idx += 2)
+                    myPool.ReturnBlock(blocks[idx]);
+
+                for (uint32_t idx = 0; idx < numBlocksPerThread; idx += 2)
+                {
+                    blocks[idx] = static_cast<uint64_t *> (myPool.GetFreeBlock());
+                    *blocks[idx] = (static_cast<uint64_t>(idxThread) << 32) | idx;
+                }
+            });
+        }
+
+        for (auto &thread : threads)
+            thread.join();
+
+        threads.clear();
+
+        // no block can have been handed out twice:
+        std::set<uint64_t *> uniqueBlocks;
+        for (uint32_t idxThread = 0; idxThread < numThreads; ++idxThread)
+        {
+            auto &blocks = blocksByThread[idxThread];
+            for (uint32_t idx = 0; idx < numBlocksPerThread; ++idx)
+            {
+                EXPECT_EQ((static_cast<uint64_t>(idxThread) << 32) | idx, *blocks[idx]);
+                uniqueBlocks.insert(blocks[idx]);
+            }
+        }
+
+        EXPECT_EQ(numThreads * numBlocksPerThread, uniqueBlocks.size());
+
+        // every thread returns the blocks obtained by its neighbour:
+        for (uint32_t idxThread = 0; idxThread < numThreads; ++idxThread)
+        {
+            threads.emplace_back([&myPool, &blocksByThread, idxThread, numThreads]()
+            {
+                for (auto block : blocksByThread[(idxThread + 1) % numThreads])
+                    myPool.ReturnBlock(block);
+            });
+        }
+
+        for (auto &thread : threads)
+            thread.join();
+
+        myPool.Shrink();
+
+        // after the threads are gone, their cached blocks must be available again:
+        for (uint32_t idx = 0; idx < numThreads * numBlocksPerThread; ++idx)
+            myPool.ReturnBlock(myPool.GetFreeBlock());
+    }
+
+    /// <summary>
+    /// Tests the size classes of <see cref="utils::SlabAllocator"/>.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, SlabAllocator_SizeClassesTest)
+    {
+        for (size_t size = 1; size <= utils::SlabAllocator::maxSlabBlockSize; ++size)
+        {
+            auto index = utils::SlabAllocator::GetSizeClassIndex(size);
+            ASSERT_LT(index, utils::SlabAllocator::numSizeClasses);
+
+            // the smallest class able to hold the request:
+            EXPECT_GE(utils::SlabAllocator::GetSizeClassBlockSize(index), size);
+
+            if (index > 0)
+            {
+                EXPECT_LT(utils::SlabAllocator::GetSizeClassBlockSize(index - 1), size);
+            }
+        }
+
+        EXPECT_EQ(utils::SlabAllocator::maxSlabBlockSize,
+                  utils::SlabAllocator::GetSizeClassBlockSize(utils::SlabAllocator::numSizeClasses - 1));
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::SlabAllocator"/> with requests of random sizes,
+    /// including those above the limit served by slabs.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, SlabAllocator_RandomSizesTest)
+    {
+        utils::SlabAllocator allocator;
+
+        std::mt19937 prng(42);
+        std::uniform_int_distribution<size_t> sizeDistribution(1, 2 * utils::SlabAllocator::maxSlabBlockSize);
+        std::uniform_int_distribution<int> coinDistribution(0, 1);
+
+        struct Allocation
+        {
+            uint8_t *ptr;
+            size_t size;
+        };
+
+        std::vector<Allocation> allocations;
+
+        for (int round = 0; round < 3; ++round)
+        {
+            for (int count = 0; count < 2000; ++count)
+            {
+                // favor small sizes:
+                auto size = sizeDistribution(prng) >> (coinDistribution(prng) * 8);
+                if (size == 0)
+                    size = 1;
+
+                auto ptr = static_cast<uint8_t *> (allocator.Allocate(size));
+                EXPECT_EQ(0U, reinterpret_cast<uintptr_t> (ptr) % alignof(std::max_align_t));
+
+                memset(ptr, static_cast<int> (size % 251), size);
+                allocations.push_back(Allocation{ ptr, size });
+            }
+
+            // release about half the allocations, checking their content:
+            std::shuffle(allocations.begin(), allocations.end(), prng);
+            auto half = allocations.size() / 2;
+
+            for (size_t idx = half; idx < allocations.size(); ++idx)
+            {
+                auto &allocation = allocations[idx];
+                EXPECT_EQ(static_cast<uint8_t> (allocation.size % 251), allocation.ptr[0]);
+                EXPECT_EQ(static_cast<uint8_t> (allocation.size % 251), allocation.ptr[allocation.size - 1]);
+                allocator.Deallocate(allocation.ptr, allocation.size);
+            }
+
+            allocations.resize(half);
+        }
+
+        for (auto &allocation : allocations)
+            allocator.Deallocate(allocation.ptr, allocation.size);
+
+        allocator.Shrink();
+    }
+
+#ifdef _3FD_HAS_STLOPTIMALLOC
+    /// <summary>
+    /// Tests <see cref="utils::SlabMemoryResource"/> serving STL containers.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, SlabAllocator_MemoryResourceTest)
+    {
+        utils::UnsyncSlabMemoryResource memoryResource;
+
+        std::pmr::map<int, std::pmr::string> dictionary(&memoryResource);
+        std::pmr::vector<int> numbers(&memoryResource);
+
+        for (int idx = 0; idx < 10000; ++idx)
+        {
+            dictionary.emplace(idx, std::pmr::string(static_cast<size_t> (idx % 100), 'x'));
+            numbers.push_back(idx);
+        }
+
+        for (int idx = 0; idx < 10000; ++idx)
+        {
+            EXPECT_EQ(static_cast<size_t> (idx % 100), dictionary[idx].size());
+            EXPECT_EQ(idx, numbers[idx]);
+        }
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::MonotonicArenaResource"/> serving containers
+    /// for several "requests", with the arena reset between them.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, MonotonicArenaResource_ResetTest)
+    {
+        utils::MonotonicArenaResource arena(1024);
+
+        for (int request = 0; request < 10; ++request)
+        {
+            {
+                std::pmr::map<std::pmr::string, int> dictionary(&arena);
+                std::pmr::vector<double> numbers(&arena);
+
+                for (int idx = 0; idx < 1000; ++idx)
+                {
+                    dictionary.emplace(std::pmr::string(std::to_string(idx) + " is a long enough key", &arena), idx);
+                    numbers.push_back(idx * 0.5);
+                }
+
+                EXPECT_EQ(1000U, dictionary.size());
+                EXPECT_EQ(500, dictionary.find(std::pmr::string("500 is a long enough key", &arena))->second);
+                EXPECT_EQ(0U, reinterpret_cast<uintptr_t> (numbers.data()) % alignof(double));
+                EXPECT_EQ(499.5, numbers.back());
+            }
+
+            arena.Reset();
+        }
+    }
+
+    /// <summary>
+    /// Measures the time to fill, search and empty a map.
+    /// </summary>
+    template <typename MapType, typename KeyMakerType>
+    static std::chrono::microseconds MeasureMapWorkload(MapType &map, KeyMakerType makeKey)
+    {
+        using namespace std::chrono;
+
+        const int numEntries = 50000;
+
+        auto startTime = steady_clock::now();
+
+        for (int idx = 0; idx < numEntries; ++idx)
+            map.emplace(makeKey(idx), typename MapType::mapped_type());
+
+        for (int idx = 0; idx < numEntries; ++idx)
+            EXPECT_NE(map.end(), map.find(makeKey(idx)));
+
+        for (int idx = 0; idx < numEntries; idx += 2)
+            map.erase(makeKey(idx));
+
+        map.clear();
+
+        return duration_cast<microseconds>(steady_clock::now() - startTime);
+    }
+
+    /// <summary>
+    /// Compares the performance of node based containers (with the key/value types of
+    /// the maps in sqlite::PrepStatement, opencl::CommandTracker and core::AppFlexSettings)
+    /// under std::allocator, <see cref="utils::StlOptimizedUnsafeAllocator"/>,
+    /// <see cref="utils::UnsyncSlabMemoryResource"/> and <see cref="utils::MonotonicArenaResource"/>.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, StlOptimizedAllocator_BenchmarkTest)
+    {
+        auto makeIntKey = [](int idx) { return idx * 7919; };
+        auto makeStrKey = [](int idx) { return "column_" + std::to_string(idx); };
+
+        std::map<std::string, std::chrono::microseconds> results;
+
+        {
+            std::map<int, void *> map;
+            results["int->ptr std::allocator"] = MeasureMapWorkload(map, makeIntKey);
+        }
+        {
+            std::map<int, void *, std::less<int>,
+                     utils::StlOptimizedUnsafeAllocator<std::pair<const int, void *>>> map;
+            results["int->ptr StlOptimizedUnsafeAllocator"] = MeasureMapWorkload(map, makeIntKey);
+        }
+        {
+            utils::UnsyncSlabMemoryResource memoryResource;
+            std::pmr::map<int, void *> map(&memoryResource);
+            results["int->ptr SlabMemoryResource"] = MeasureMapWorkload(map, makeIntKey);
+        }
+        {
+            utils::MonotonicArenaResource arena;
+            std::pmr::map<int, void *> map(&arena);
+            results["int->ptr MonotonicArenaResource"] = MeasureMapWorkload(map, makeIntKey);
+        }
+        {
+            std::map<std::string, int> map;
+            results["string->int std::allocator"] = MeasureMapWorkload(map, makeStrKey);
+        }
+        {
+            std::map<std::string, int, std::less<std::string>,
+                     utils::StlOptimizedUnsafeAllocator<std::pair<const std::string, int>>> map;
+            results["string->int StlOptimizedUnsafeAllocator"] = MeasureMapWorkload(map, makeStrKey);
+        }
+        {
+            utils::UnsyncSlabMemoryResource memoryResource;
+            std::pmr::map<std::pmr::string, int> map(&memoryResource);
+            results["string->int SlabMemoryResource"] = MeasureMapWorkload(map, [&memoryResource](int idx)
+            {
+                return std::pmr::string(("column_" + std::to_string(idx)).c_str(), &memoryResource);
+            });
+        }
+        {
+            utils::MonotonicArenaResource arena;
+            std::pmr::map<std::pmr::string, int> map(&arena);
+            results["string->int MonotonicArenaResource"] = MeasureMapWorkload(map, [&arena](int idx)
+            {
+                return std::pmr::string(("column_" + std::to_string(idx)).c_str(), &arena);
+            });
+        }
+
+#   ifdef _3FD_CONSOLE_AVAILABLE
+        for (auto &entry : results)
+            std::cout << entry.first << ": " << entry.second.count() << " us\n";
+#   endif
+    }
+
+#endif // _3FD_HAS_STLOPTIMALLOC
+
 }// end of namespace unit_tests
 }// end of namespace _3fd
@@ -5,10 +5,12 @@
 //
 #include "pch.h"
 #include <3fd/utils/serialization.h>
+#include <3fd/utils/binaryformat.h>
 #include <iostream>
 #include <sstream>
 #include <codecvt>
 #include <ctime>
+#include <limits>
 
 #define format utils::FormatArg
 
@@ -200,6 +202,207 @@ namespace unit_tests
         }
     }
 
+    /// <summary>
+    /// Checks whether a value is serialized like printf does.
+    /// </summary>
+    template <typename ValType>
+    void CheckSameAsPrintf(ValType value, const char *printfFormat, int width, int precision)
+    {
+        std::array<char, 128> expected;
+        if (width >= 0 && precision >= 0)
+            snprintf(expected.data(), expected.size(), printfFormat, width, precision, value);
+        else if (width >= 0 || precision >= 0)
+            snprintf(expected.data(), expected.size(), printfFormat, std::max(width, precision), value);
+        else
+            snprintf(expected.data(), expected.size(), printfFormat, value);
+
+        auto arg = utils::FormatArg(value);
+        if (width >= 0)
+            arg.width(width);
+        if (precision >= 0)
+            arg.precision(precision);
+
+        std::array<char, 128> buffer;
+        auto pcount = utils::SerializeTo(buffer, arg);
+        EXPECT_STREQ(expected.data(), buffer.data()) << "format \"" << printfFormat << '"';
+        EXPECT_EQ(strlen(expected.data()), pcount);
+
+        std::string str;
+        EXPECT_EQ(pcount, utils::SerializeTo(str, arg));
+        EXPECT_EQ(expected.data(), str);
+
+        std::wstring wstr;
+        EXPECT_EQ(pcount, utils::SerializeTo(wstr, arg));
+        EXPECT_EQ(std::wstring(expected.data(), expected.data() + pcount), wstr);
+    }
+
+    /// <summary>
+    /// Tests whether values formatted without printf come out the same as with it.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, Serialization_SameAsPrintf_Test)
+    {
+        for (int64_t value : std::initializer_list<int64_t>{ INT64_MIN, -4242LL, -1LL, 0LL, 7LL, 424242LL, INT64_MAX })
+        {
+            CheckSameAsPrintf(value, "%lld", -1, -1);
+            CheckSameAsPrintf(value, "%*lld", 12, -1);
+            CheckSameAsPrintf(value, "%.*lld", -1, 0);
+            CheckSameAsPrintf(value, "%.*lld", -1, 8);
+            CheckSameAsPrintf(value, "%*.*lld", 12, 8);
+            CheckSameAsPrintf(static_cast<int32_t> (value), "%d", -1, -1);
+        }
+
+        for (uint64_t value : std::initializer_list<uint64_t>{ 0ULL, 9ULL, 10ULL, 99999ULL, UINT64_MAX })
+        {
+            CheckSameAsPrintf(value, "%llu", -1, -1);
+            CheckSameAsPrintf(value, "%*llu", 3, -1);
+            CheckSameAsPrintf(static_cast<uint16_t> (value), "%hu", -1, -1);
+        }
+
+        for (double value : { 0.0, -0.0, 1.0, -42.4242, 0.000123456789, 1e-5, 123456.0, 1234567.0, 6.02e23, -1.7e308, 5e-324,
+                              std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+                              std::numeric_limits<double>::quiet_NaN() })
+        {
+            CheckSameAsPrintf(value, "%G", -1, -1);
+            CheckSameAsPrintf(value, "%*G", 14, -1);
+            CheckSameAsPrintf(value, "%.*G", -1, 0);
+            CheckSameAsPrintf(value, "%.*G", -1, 3);
+            CheckSameAsPrintf(value, "%.*G", -1, 17);
+            CheckSameAsPrintf(value, "%*.*G", 14, 4);
+        }
+
+        CheckSameAsPrintf(42.42F, "%.*G", -1, 4);
+        CheckSameAsPrintf("foobar", "%s", -1, -1);
+        CheckSameAsPrintf("foobar", "%*s", 10, -1);
+        CheckSameAsPrintf("foobar", "%.*s", -1, 3);
+        CheckSameAsPrintf("foobar", "%*.*s", 10, 3);
+        CheckSameAsPrintf("", "%*s", 2, -1);
+        CheckSameAsPrintf('x', "%c", -1, -1);
+
+        // printf behavior is undefined for null strings:
+        const char *nullStr(nullptr);
+        const wchar_t *nullWideStr(nullptr);
+
+        std::array<char, 32> buffer;
+        EXPECT_EQ(8U, utils::SerializeTo(buffer, utils::FormatArg(nullStr).width(8)));
+        EXPECT_STREQ("  (null)", buffer.data());
+
+        std::string str;
+        utils::SerializeTo(str, nullStr, ' ', nullWideStr);
+        EXPECT_EQ("(null) (null)", str);
+
+        std::wstring wstr;
+        utils::SerializeTo(wstr, nullStr, L' ', nullWideStr);
+        EXPECT_EQ(L"(null) (null)", wstr);
+    }
+
+    /// <summary>
+    /// Tests writing and reading values in binary format.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, BinaryFormat_RoundTrip_Test)
+    {
+        utils::BinaryWriter writer;
+
+        for (int round = 0; round < 2; ++round)
+        {
+            writer.Clear();
+            writer.Write(true);
+            writer.Write(0U);
+            writer.Write(UINT64_MAX);
+            writer.Write(-1);
+            writer.Write(INT64_MIN);
+            writer.Write(42.42);
+            writer.Write("UTF-8 text: Grüße");
+            writer.WriteNull();
+            const uint8_t blob[] = { 0, 1, 2, 255 };
+            writer.WriteBlob(blob, sizeof blob);
+
+            writer.BeginRecord();
+            writer.Write(std::string("nested"));
+            writer.BeginRecord();
+            writer.Write(7U);
+            writer.EndRecord();
+            writer.EndRecord();
+
+            writer.Write(false);
+
+            auto bytes = writer.GetBytes();
+            utils::BinaryReader reader(bytes);
+
+            EXPECT_TRUE(reader.ReadBool());
+            EXPECT_EQ(0, reader.ReadUInt());
+            EXPECT_EQ(UINT64_MAX, reader.ReadUInt());
+            EXPECT_EQ(-1, reader.ReadInt());
+            EXPECT_EQ(INT64_MIN, reader.ReadInt());
+            EXPECT_EQ(42.42, reader.ReadDouble());
+
+            // strings and blobs refer to the original bytes:
+            auto text = reader.ReadString();
+            EXPECT_EQ("UTF-8 text: Grüße", text);
+            EXPECT_TRUE(text.data() > reinterpret_cast<const char *> (bytes.data)
+                        && text.data() < reinterpret_cast<const char *> (bytes.data + bytes.size));
+
+            EXPECT_EQ(utils::BinaryType::Null, reader.PeekType());
+            reader.ReadNull();
+
+            auto readBlob = reader.ReadBlob();
+            ASSERT_EQ(sizeof blob, readBlob.size);
+            EXPECT_EQ(0, memcmp(blob, readBlob.data, sizeof blob));
+
+            auto record = reader.ReadRecord();
+            EXPECT_EQ("nested", record.ReadString());
+            auto nestedRecord = record.ReadRecord();
+            EXPECT_EQ(7, nestedRecord.ReadUInt());
+            EXPECT_TRUE(nestedRecord.AtEnd());
+            EXPECT_TRUE(record.AtEnd());
+
+            EXPECT_FALSE(reader.ReadBool());
+            EXPECT_TRUE(reader.AtEnd());
+        }
+    }
+
+    /// <summary>
+    /// Tests reading invalid data in binary format.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, BinaryFormat_InvalidData_Test)
+    {
+        utils::BinaryWriter writer;
+        writer.Write(-42);
+        writer.BeginRecord();
+        writer.Write("some text");
+        writer.Write(3.14);
+        writer.EndRecord();
+        writer.Write(1U);
+
+        auto bytes = writer.GetBytes();
+
+        // skip values, including whole records:
+        utils::BinaryReader reader(bytes);
+        reader.Skip();
+        reader.Skip();
+        EXPECT_EQ(1, reader.ReadUInt());
+        EXPECT_TRUE(reader.AtEnd());
+
+        // type mismatch:
+        utils::BinaryReader mismatch(bytes);
+        EXPECT_THROW(mismatch.ReadUInt(), core::IAppException);
+
+        // truncated at any point:
+        for (size_t size = 1; size < bytes.size; ++size)
+        {
+            utils::BinaryReader truncated(bytes.data, size);
+            EXPECT_THROW(
+                {
+                    truncated.ReadInt();
+                    auto record = truncated.ReadRecord();
+                    record.ReadString();
+                    record.ReadDouble();
+                    truncated.ReadUInt();
+                },
+                core::IAppException
+            ) << "for size " << size;
+        }
+    }
+
     /// <summary>
     /// Helps measuring elapsed time for the interval of execution inside a scope.
     /// </summary>
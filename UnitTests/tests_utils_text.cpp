@@ -4,8 +4,20 @@
 // and the observance that it should only be used for the benefit of mankind.
 //
 #include "pch.h"
+#include <3fd/utils/interning.h>
 #include <3fd/utils/text.h>
 
+#include <array>
+#include <chrono>
+#include <codecvt>
+#include <functional>
+#include <iostream>
+#include <locale>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+
 namespace _3fd
 {
 namespace unit_tests
@@ -210,5 +222,304 @@ namespace unit_tests
             << utils::to_utf8(expected) << '\"';
     }
 
+    /// <summary>
+    /// Tests <see cref="utils::TextPlaceholderReplacementHelper::Emit"/>.
+    /// The template is parsed once and reused, repeated placeholders share a replacement,
+    /// and the result has the exact length of the text (without null terminator).
+    /// </summary>
+    TEST(Framework_Utils_TextPlaceholderReplacementHelper, ReuseTemplate_Utf8)
+    {
+        for (int idx = 0; idx < 3; ++idx)
+        {
+            auto actual =
+                utils::TextUtf8::in('$', "$x + $x = $sum $")
+                .Use("x", idx)
+                .Use("sum", idx + idx)
+                .Emit();
+
+            std::ostringstream oss;
+            oss << idx << " + " << idx << " = " << (idx + idx) << ' ';
+
+            EXPECT_EQ(oss.str(), actual);
+        }
+
+        // the same array, but with other contents:
+        char text[] = "first $a";
+        EXPECT_EQ("first 1", utils::TextUtf8::in('$', text).Replace("a", "1").Emit());
+        auto first = utils::TextUtf8::in('$', text);
+        strcpy(text, "other $b");
+        EXPECT_EQ("other 2", utils::TextUtf8::in('$', text).Replace("b", "2").Emit());
+        strcpy(text, "third $c");
+        EXPECT_EQ("third 3", utils::TextUtf8::in('$', text).Replace("c", "3").Emit());
+
+        // a template replaced in the cache is still usable by whom holds it:
+        EXPECT_EQ("first 4", first.Replace("a", "4").Emit());
+    }
+
+    /// <summary>
+    /// Tests the conversions between UTF-8 and wide characters against the STL.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, UnicodeConversion_Test)
+    {
+        std::wstring_convert<std::codecvt_utf8<wchar_t>> transcoder;
+
+        const char *samples[] = {
+            "",
+            "a",
+            "plain ASCII text long enough to take the fast path of blocks, and a bit more",
+            "Grüße aus Köln, schöne Straße",
+            "Привет, мир! Это текст на русском языке",
+            "日本語のテキスト、中文文本",
+            "mostly ASCII text with one 'é' in the middle of it, then ASCII again for a while",
+        };
+
+        for (const char *sample : samples)
+        {
+            std::wstring expectedWide = transcoder.from_bytes(sample);
+            std::wstring actualWide = utils::to_ucs2(sample);
+            EXPECT_TRUE(expectedWide == actualWide) << "for \"" << sample << '"';
+            EXPECT_EQ(sample, utils::to_utf8(actualWide));
+        }
+
+        // beyond the basic multilingual plane (surrogate pair in UTF-16):
+        std::string emoji("emoji: \xF0\x9F\x98\x80!");
+        auto wideEmoji = utils::to_ucs2(emoji);
+        EXPECT_EQ(sizeof(wchar_t) == 2 ? 10U : 9U, wideEmoji.size());
+        EXPECT_EQ(emoji, utils::to_utf8(wideEmoji));
+
+        // into a buffer provided by the caller:
+        std::array<wchar_t, 64> wideBuffer;
+        EXPECT_EQ(5U, utils::to_ucs2("Hallo", wideBuffer.data(), wideBuffer.size()));
+        EXPECT_EQ(0, wcsncmp(L"Hallo", wideBuffer.data(), 5));
+
+        std::array<char, 64> buffer;
+        EXPECT_EQ(6U, utils::to_utf8(L"Grüß", buffer.data(), buffer.size()));
+        EXPECT_EQ(0, strncmp("Gr\xC3\xBC\xC3\x9F", buffer.data(), 6));
+        EXPECT_THROW(utils::to_utf8(std::wstring(32, L'x'), buffer.data(), buffer.size()), core::IAppException);
+
+        // invalid encodings:
+        const char *invalidSamples[] = {
+            "\x80",                         // unexpected continuation
+            "truncated \xC3",               // truncated sequence
+            "overlong \xC0\xAF",            // overlong form of '/'
+            "overlong \xE0\x80\xAF",        // overlong form of '/'
+            "surrogate \xED\xA0\x80",       // UTF-16 surrogate
+            "too big \xF4\x90\x80\x80",     // beyond U+10FFFF
+            "long enough to take the fast path first \xFF and fail",
+        };
+
+        for (const char *sample : invalidSamples)
+        {
+            EXPECT_THROW(utils::to_ucs2(sample), core::IAppException) << "for \"" << sample << '"';
+        }
+
+        EXPECT_THROW(utils::to_utf8(std::wstring(1, static_cast<wchar_t> (0xDC00))), core::IAppException);
+    }
+
+    /// <summary>
+    /// Compares the speed of conversions between UTF-8 and wide characters against the STL.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, UnicodeConversion_Speed_Test)
+    {
+        std::string ascii, multilingual;
+        for (int idx = 0; idx < 2000; ++idx)
+        {
+            ascii += "The quick brown fox jumps over the lazy dog. ";
+            multilingual += "Grüße! Привет, мир! 日本語のテキスト. ";
+        }
+
+        const int numIterations = 200;
+        std::wstring_convert<std::codecvt_utf8<wchar_t>> transcoder;
+
+        for (auto corpus : { &ascii, &multilingual })
+        {
+            std::cout << ((corpus == &ascii) ? "ASCII corpus:" : "multilingual corpus:") << std::endl;
+            std::wstring wide = utils::to_ucs2(*corpus);
+
+            auto measure = [numIterations](const char *label, const std::function<size_t()> &convert)
+            {
+                size_t length(0);
+                auto startTime = std::chrono::steady_clock::now();
+
+                for (int idx = 0; idx < numIterations; ++idx)
+                    length += convert();
+
+                auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+                std::cout << "  " << label << ": " << elapsed.count() << " ms" << std::endl;
+                return length;
+            };
+
+            auto expectedWideLength = measure("to_ucs2 (STL)", [&]() { return transcoder.from_bytes(*corpus).size(); });
+            auto actualWideLength = measure("to_ucs2", [&]() { return utils::to_ucs2(*corpus).size(); });
+            EXPECT_EQ(expectedWideLength, actualWideLength);
+
+            auto expectedLength = measure("to_utf8 (STL)", [&]() { return transcoder.to_bytes(wide).size(); });
+            auto actualLength = measure("to_utf8", [&]() { return utils::to_utf8(wide).size(); });
+            EXPECT_EQ(expectedLength, actualLength);
+        }
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::StringInterner"/>.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, StringInterning_Test)
+    {
+        std::string first("interned/string");
+        std::string second(first);
+
+        utils::InternedString a(first), b(second);
+        EXPECT_TRUE(a == b);
+        EXPECT_EQ(a.c_str(), b.c_str());
+        EXPECT_EQ(a.id(), b.id());
+        EXPECT_EQ(first, a.str());
+        EXPECT_EQ(first.size(), a.view().lenBytes);
+        EXPECT_EQ(0, a.c_str()[first.size()]);
+
+        utils::InternedString c("interned/string/other");
+        EXPECT_TRUE(a != c);
+        EXPECT_NE(a.id(), c.id());
+
+        utils::InternedString empty("");
+        EXPECT_FALSE(empty.null());
+        EXPECT_TRUE(empty.str().empty());
+
+        auto &interner = utils::StringInterner::GetInstance();
+        EXPECT_TRUE(interner.Find("never/interned/before").null());
+        EXPECT_TRUE(interner.Find(first) == a);
+
+        // larger than a chunk of the arena:
+        std::string large(100 * 1024, 'x');
+        utils::InternedString d(large);
+        EXPECT_EQ(large, d.str());
+        EXPECT_TRUE(utils::InternedString(large) == d);
+
+        // concurrent interning must yield the same strings:
+        const int numStrings = 1000;
+        std::vector<utils::InternedString> results[4];
+        std::vector<std::thread> threads;
+        for (auto &result : results)
+        {
+            threads.emplace_back([&result]()
+            {
+                for (int idx = 0; idx < numStrings; ++idx)
+                    result.emplace_back("concurrent/" + std::to_string(idx));
+            });
+        }
+
+        for (auto &thread : threads)
+            thread.join();
+
+        for (int idx = 0; idx < numStrings; ++idx)
+        {
+            EXPECT_TRUE(results[0][idx] == results[1][idx]);
+            EXPECT_TRUE(results[0][idx] == results[2][idx]);
+            EXPECT_TRUE(results[0][idx] == results[3][idx]);
+            EXPECT_EQ("concurrent/" + std::to_string(idx), results[0][idx].str());
+        }
+    }
+
+    /// <summary>
+    /// Tests the conversion of case in <see cref="utils"/>.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, CaseConversion_Test)
+    {
+        // all bytes, at every length and misalignment covering whole blocks and remainders:
+        std::string allBytes;
+        for (int ch = 1; ch < 256; ++ch)
+            allBytes.push_back(static_cast<char> (ch));
+
+        for (size_t offset = 0; offset < 33; ++offset)
+        {
+            for (size_t length = 0; offset + length <= allBytes.size(); length += 7)
+            {
+                std::string input = allBytes.substr(offset, length);
+
+                std::string expectedLower(input), expectedUpper(input);
+                for (char &ch : expectedLower)
+                    ch = (ch >= 'A' && ch <= 'Z') ? ch + ('a' - 'A') : ch;
+                for (char &ch : expectedUpper)
+                    ch = (ch >= 'a' && ch <= 'z') ? ch - ('a' - 'A') : ch;
+
+                EXPECT_EQ(expectedLower, utils::to_lower(input));
+                EXPECT_EQ(expectedUpper, utils::to_upper(input));
+
+                std::string inPlace(input);
+                utils::to_lower_in_place(&inPlace[0], inPlace.size());
+                EXPECT_EQ(expectedLower, inPlace);
+                utils::to_upper_in_place(&inPlace[0], inPlace.size());
+                EXPECT_EQ(expectedUpper, inPlace);
+
+                std::array<char, 256> buffer;
+                EXPECT_EQ(input.size(), utils::to_lower(input, buffer.data(), buffer.size()));
+                EXPECT_EQ(expectedLower, std::string(buffer.data(), input.size()));
+                EXPECT_EQ(input.size(), utils::to_upper(input, buffer.data(), buffer.size()));
+                EXPECT_EQ(expectedUpper, std::string(buffer.data(), input.size()));
+
+                EXPECT_TRUE(utils::equals_ignore_case(expectedLower, expectedUpper));
+                EXPECT_EQ(0, utils::compare_ignore_case(expectedLower, expectedUpper));
+                EXPECT_EQ(utils::hash_ignore_case(expectedLower), utils::hash_ignore_case(expectedUpper));
+            }
+        }
+
+        std::array<char, 4> small;
+        EXPECT_THROW(utils::to_lower("too long", small.data(), small.size()), core::IAppException);
+
+        // only ASCII letters change:
+        EXPECT_EQ("straße über ÄÖÜ", utils::to_lower("STRAßE über ÄÖÜ"));
+
+        const std::string longText("The Quick Brown Fox Jumps Over The Lazy Dog");
+        EXPECT_FALSE(utils::equals_ignore_case(longText, longText + "!"));
+        EXPECT_FALSE(utils::equals_ignore_case(longText, "THE QUICK BROWN FOX JUMPS OVER THE LAZY COG"));
+        EXPECT_TRUE(utils::equals_ignore_case(longText, "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG"));
+        EXPECT_GT(0, utils::compare_ignore_case(longText, "the quick brown fox jumps over the lazy eel"));
+        EXPECT_LT(0, utils::compare_ignore_case(longText, "the quick brown fox jumps over the lazy cat"));
+        EXPECT_GT(0, utils::compare_ignore_case("abc", "ABCD"));
+        EXPECT_GT(0, utils::compare_ignore_case("[", "A")); // as in 'strcasecmp', letters are compared in lower case
+
+        std::map<std::string, int, utils::IgnoreCaseFunctorLess> dictionary{ { "Eins", 1 }, { "zwei", 2 } };
+        EXPECT_EQ(1, dictionary["EINS"]);
+        EXPECT_EQ(2, dictionary["Zwei"]);
+        EXPECT_EQ(2U, dictionary.size());
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::split"/>.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, SplitIterator_Test)
+    {
+        auto toVector = [](utils::SplitRange pieces)
+        {
+            std::vector<std::string> result;
+            for (auto piece : pieces)
+                result.push_back(piece.to_string());
+            return result;
+        };
+
+        typedef std::vector<std::string> Pieces;
+
+        EXPECT_EQ(Pieces({ "a", "bc", "", "def", "" }), toVector(utils::split("a,bc,,def,", ',')));
+        EXPECT_EQ(Pieces({ "no delimiter" }), toVector(utils::split("no delimiter", ',')));
+        EXPECT_EQ(Pieces({ "" }), toVector(utils::split("", ',')));
+        EXPECT_EQ(Pieces(), toVector(utils::split(utils::CStringViewUtf8(nullptr), ',')));
+
+        EXPECT_EQ(Pieces({ "line 1", "line\r2", "", "line 3" }),
+                  toVector(utils::split("line 1\r\nline\r2\r\n\r\nline 3", "\r\n")));
+
+        EXPECT_EQ(Pieces({ "", ":x", "", ":" }), toVector(utils::split(":::x:::::", "::")));
+
+        // the string is not changed:
+        const std::string config("section.key=value");
+        auto iter = utils::split(utils::CStringViewUtf8(config), '=').begin();
+        EXPECT_EQ("section.key", (*iter).to_string());
+        EXPECT_EQ(config.data(), (*iter).data);
+        EXPECT_EQ("value", (*++iter).to_string());
+        EXPECT_EQ(config.data() + config.size(), (*iter).end());
+        EXPECT_TRUE(++iter == utils::split(config, '=').end());
+        EXPECT_EQ("section.key=value", config);
+
+        auto dotIter = utils::split(config, '.').begin();
+        EXPECT_EQ("key=value", (++dotIter).rest().to_string());
+    }
+
 }// end of namespace unit_tests
 }// end of namespace _3fd
@@ -0,0 +1,231 @@
+//
+// Copyright (c) 2020 Part of 3FD project (https://github.com/faburaya/3fd)
+// It is FREELY distributed by the author under the Microsoft Public License
+// and the observance that it should only be used for the benefit of mankind.
+//
+#include "pch.h"
+#include <3fd/core/runtime.h>
+#include <3fd/utils/threadpool.h>
+#include <3fd/utils/timerwheel.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace _3fd
+{
+namespace unit_tests
+{
+    using utils::ThreadPool;
+    using utils::TaskPriority;
+    using utils::TimerWheel;
+
+    /// <summary>
+    /// Tests <see cref="utils::ThreadPool"/> running a large amount of tasks,
+    /// some of which spawn more tasks (so as to exercise work stealing).
+    /// </summary>
+    TEST(Framework_Utils_TestCase, ThreadPool_ManyTasksTest)
+    {
+        const uint32_t numTasks = 10000;
+        const uint32_t numSubtasks = 4;
+
+        std::atomic<uint32_t> count(0);
+
+        {// pool is destroyed upon scope exit:
+            ThreadPool pool(4);
+            EXPECT_EQ(4U, pool.GetNumWorkers());
+
+            for (uint32_t idx = 0; idx < numTasks; ++idx)
+            {
+                pool.Submit([&pool, &count]()
+                {
+                    for (uint32_t jdx = 0; jdx < numSubtasks; ++jdx)
+                        pool.Submit([&count]() { count.fetch_add(1); }, TaskPriority::Low);
+
+                    count.fetch_add(1);
+                });
+            }
+        }
+
+        // graceful shutdown must have run all pending tasks:
+        EXPECT_EQ(numTasks * (1 + numSubtasks), count.load());
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::ThreadPool::Async"/>.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, ThreadPool_AsyncTest)
+    {
+        ThreadPool pool(2);
+
+        std::vector<std::future<int>> futures;
+
+        for (int idx = 0; idx < 100; ++idx)
+            futures.push_back(pool.Async([idx]() { return idx * idx; }));
+
+        for (int idx = 0; idx < 100; ++idx)
+            EXPECT_EQ(idx * idx, futures[idx].get());
+
+        // exceptions are transported by the future:
+        auto future = pool.Async([]() -> int { throw std::logic_error("oops"); });
+        EXPECT_THROW(future.get(), std::logic_error);
+
+        // exceptions escaping a plain task do not bring down the worker:
+        pool.Submit([]() { throw std::runtime_error("oops"); });
+        EXPECT_EQ(42, pool.Async([]() { return 42; }).get());
+    }
+
+    /// <summary>
+    /// Tests whether <see cref="utils::ThreadPool"/> runs
+    /// the pending tasks in the order of their priorities.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, ThreadPool_PriorityTest)
+    {
+        ThreadPool pool(1);
+
+        std::mutex mutex;
+        std::vector<TaskPriority> executed;
+
+        // block the single worker while the other tasks are submitted:
+        std::promise<void> unblock;
+        auto blocker = unblock.get_future().share();
+        auto started = pool.Async([blocker]() { blocker.wait(); });
+
+        for (auto priority : { TaskPriority::Low, TaskPriority::Normal, TaskPriority::High })
+        {
+            for (int idx = 0; idx < 3; ++idx)
+            {
+                pool.Submit([priority, &mutex, &executed]()
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    executed.push_back(priority);
+                }, priority);
+            }
+        }
+
+        unblock.set_value();
+        started.get();
+
+        pool.Async([]() {}, TaskPriority::Low).get();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ASSERT_EQ(9U, executed.size());
+
+        for (size_t idx = 1; idx < executed.size(); ++idx)
+            EXPECT_LE(executed[idx - 1], executed[idx]);
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::TimerWheel"/> with timers expiring
+    /// in different levels of the wheel, some of them cancelled.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, TimerWheel_ScheduleAndCancelTest)
+    {
+        using namespace std::chrono;
+
+        ThreadPool pool(2);
+        TimerWheel timerWheel(milliseconds(1), pool);
+
+        const int numTimers = 8;
+        std::array<steady_clock::time_point, numTimers> expirationTimes;
+        std::array<std::promise<void>, numTimers> promises;
+        std::vector<TimerWheel::TimerId> timerIds;
+
+        auto startTime = steady_clock::now();
+
+        for (int idx = 0; idx < numTimers; ++idx)
+        {
+            // delays from 5 to 320 ms cover the 2 lower levels of the wheel:
+            timerIds.push_back(timerWheel.Schedule(milliseconds(5 << (idx % 7)),
+                [idx, &expirationTimes, &promises]()
+                {
+                    expirationTimes[idx] = steady_clock::now();
+                    promises[idx].set_value();
+                }));
+        }
+
+        // cancel the timers with odd index:
+        for (int idx = 1; idx < numTimers; idx += 2)
+            EXPECT_TRUE(timerWheel.Cancel(timerIds[idx]));
+
+        EXPECT_FALSE(timerWheel.Cancel(timerIds[1])); // already cancelled
+        EXPECT_FALSE(timerWheel.Cancel(0)); // never valid
+
+        for (int idx = 0; idx < numTimers; idx += 2)
+        {
+            auto future = promises[idx].get_future();
+            ASSERT_EQ(std::future_status::ready, future.wait_for(seconds(10)));
+
+            auto elapsed = duration_cast<milliseconds>(expirationTimes[idx] - startTime);
+            EXPECT_GE(elapsed.count(), 5 << (idx % 7));
+
+            // expired timers can no longer be cancelled:
+            EXPECT_FALSE(timerWheel.Cancel(timerIds[idx]));
+        }
+
+        for (int idx = 1; idx < numTimers; idx += 2)
+        {
+            auto future = promises[idx].get_future();
+            EXPECT_EQ(std::future_status::timeout, future.wait_for(milliseconds(0)));
+        }
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::TimerWheel"/> with a periodic timer.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, TimerWheel_PeriodicTest)
+    {
+        using namespace std::chrono;
+
+        ThreadPool pool(2);
+        TimerWheel timerWheel(milliseconds(1), pool);
+
+        std::atomic<int> count(0);
+        std::promise<void> promise;
+
+        TimerWheel::TimerId timerId = timerWheel.SchedulePeriodic(milliseconds(2),
+            [&count, &promise]()
+            {
+                if (count.fetch_add(1) + 1 == 10)
+                    promise.set_value();
+            });
+
+        ASSERT_EQ(std::future_status::ready, promise.get_future().wait_for(seconds(10)));
+        EXPECT_TRUE(timerWheel.Cancel(timerId));
+
+        // callbacks already dispatched may still run, but not many:
+        std::this_thread::sleep_for(milliseconds(50));
+        auto countAfterCancel = count.load();
+        std::this_thread::sleep_for(milliseconds(50));
+        EXPECT_EQ(countAfterCancel, count.load());
+    }
+
+    /// <summary>
+    /// Tests <see cref="utils::Asynchronous::InvokeAndLeave"/>,
+    /// which runs in the framework thread pool.
+    /// </summary>
+    TEST(Framework_Utils_TestCase, ThreadPool_InvokeAndLeaveTest)
+    {
+        // Ensures proper initialization/finalization of the framework
+#   ifdef _3FD_PLATFORM_WINRT
+        core::FrameworkInstance _framework("UnitTestsApp.WinRT.UWP");
+#   else
+        core::FrameworkInstance _framework;
+#   endif
+
+        std::promise<void> promise;
+        auto future = promise.get_future();
+
+        utils::Asynchronous::InvokeAndLeave([&promise]() { promise.set_value(); });
+
+        EXPECT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(10)));
+        EXPECT_GT(ThreadPool::GetInstance().GetNumWorkers(), 0U);
+    }
+
+}// end of namespace unit_tests
+}// end of namespace _3fd